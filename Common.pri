@@ -7,7 +7,29 @@ HEADERS += \
     $$PWD/Headers/Common/sql.h \
     $$PWD/Headers/Common/tdbloger.h \
     $$PWD/Headers/Common/tdbconfig.h \
-    $$PWD/Headers/Common/httpsslquery.h
+    $$PWD/Headers/Common/httpsslquery.h \
+    $$PWD/Headers/Common/mpscqueue.h \
+    $$PWD/Headers/Common/log.h \
+    $$PWD/Headers/Common/logsink.h \
+    $$PWD/Headers/Common/filelogsink.h \
+    $$PWD/Headers/Common/logpipeline.h \
+    $$PWD/Headers/Common/logmaintenance.h \
+    $$PWD/Headers/Common/logfilereader.h \
+    $$PWD/Headers/Common/logsuppressor.h \
+    $$PWD/Headers/Common/logcrashbuffer.h \
+    $$PWD/Headers/Common/dblogsink.h \
+    $$PWD/Headers/Common/dbflushcontroller.h \
+    $$PWD/Headers/Common/dblogspool.h \
+    $$PWD/Headers/Common/dbconnectionsupervisor.h \
+    $$PWD/Headers/Common/dbbulkloader.h \
+    $$PWD/Headers/Common/dblogretention.h \
+    $$PWD/Headers/Common/dblogschema.h \
+    $$PWD/Headers/Common/dbloglocalstore.h \
+    $$PWD/Headers/Common/dblogreader.h \
+    $$PWD/Headers/Common/dblogstats.h \
+    $$PWD/Headers/Common/dblogcollector.h \
+    $$PWD/Headers/Common/dbconnectionpool.h \
+    $$PWD/Headers/Common/dbstatementcache.h
 
 SOURCES += \
     $$PWD/Src/common.cpp \
@@ -15,5 +37,25 @@ SOURCES += \
     $$PWD/Src/sql.cpp \
     $$PWD/Src/tdbloger.cpp \
     $$PWD/Src/tdbconfig.cpp \
-    $$PWD/Src/httpsslquery.cpp
+    $$PWD/Src/httpsslquery.cpp \
+    $$PWD/Src/logsink.cpp \
+    $$PWD/Src/filelogsink.cpp \
+    $$PWD/Src/logpipeline.cpp \
+    $$PWD/Src/logmaintenance.cpp \
+    $$PWD/Src/logfilereader.cpp \
+    $$PWD/Src/logsuppressor.cpp \
+    $$PWD/Src/logcrashbuffer.cpp \
+    $$PWD/Src/dblogsink.cpp \
+    $$PWD/Src/dbflushcontroller.cpp \
+    $$PWD/Src/dblogspool.cpp \
+    $$PWD/Src/dbconnectionsupervisor.cpp \
+    $$PWD/Src/dbbulkloader.cpp \
+    $$PWD/Src/dblogretention.cpp \
+    $$PWD/Src/dblogschema.cpp \
+    $$PWD/Src/dbloglocalstore.cpp \
+    $$PWD/Src/dblogreader.cpp \
+    $$PWD/Src/dblogstats.cpp \
+    $$PWD/Src/dblogcollector.cpp \
+    $$PWD/Src/dbconnectionpool.cpp \
+    $$PWD/Src/dbstatementcache.cpp
 
@@ -2,6 +2,7 @@
 
 //STL
 #include <stdexcept>
+#include <atomic>
 
 
 //Qt
@@ -85,28 +86,84 @@ static const QString DATETIME_FORMAT("yyyy-MM-dd hh:mm:ss.zzz");   ///< Осно
 static const QString SIMPLY_DATETIME_FORMAT("yyyy-MM-dd hh:mm:ss");///< Дата/время упрощенный
 
 
-static bool DEBUG_MODE = false;
+///////////////////////////////////////////////////////////////////////////////
+///     Формат файла лога
+///
+enum class LogFileFormat: quint8
+{
+    TEXT = 0,   ///< Текстовый формат "[DATETIME_FORMAT] [prefix] [msg]"
+    BINARY = 1  ///< Двоичный формат без форматирования времени и префикса. Для чтения используется LogFileReader или утилита LogDecoder
+};
+
 /*!
-    Функция перенаправления отладочных сообщений
+    Режим отладки. В DEBUG сборке при включенном режиме отладочные сообщения выводятся в консоль. Переменная общая
+        для всей программы, чтение и изменение потокобезопасны
+*/
+inline std::atomic_bool DEBUG_MODE = false;
+
+/*!
+    Функция перенаправления отладочных сообщений. Сообщение один раз передается в конвейер логирования (см. LogPipeline),
+        который доставляет его в консоль, файл лога и другие подключенные приемники. Лавина одинаковых сообщений
+        подавляется (см. setLogSuppression(...))
 */
 void messageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg);
 
+/*!
+    Передает сообщение в конвейер логирования так же как messageOutput(...), но без контекста. Эта функция потокобезопасна
+    @param type - тип сообщения
+    @param msg - сообщение
+*/
+void writeLogMessage(QtMsgType type, const QString& msg);
+
 /*!
     Т.к. QFile.errorString() возращает крикозябры - переопределяем эту функцию
 */
 QString fileErrorToString(QFileDevice::FileError error);
 
 /*!
-    Записывает сообщение в файл в формате "[SIMPLY_TIME_FORMAT] [prefix] [msg]". Имя файла лога определяется как [расположение exe файла]/Log/[название приложения].log
-        Если файл или папка не существуют - они будут созданы при первом вызове этой функции. При превышении
-        размера файла максимального - файл будет переименован в [название приложения].log_yyyy_MM_dd_hh_mm_ss
+    Записывает сообщение в файл в формате "[DATETIME_FORMAT] [prefix] [msg]". Имя файла лога определяется как [расположение exe файла]/Log/[название приложения].log
+        Если файл или папка не существуют - они будут созданы при первой записи. При превышении
+        размера файла максимального - файл будет переименован в [название приложения].log_yyyy_MM_dd_hh_mm_ss_zzz
+        и сжат в фоне (см. compressLogFile(...), LogFileReader). Сообщение только помещается в очередь, запись выполняется фоновым потоком (см. FileLogSink). Эта функция потокобезопасна
     @param prefix - префикс сообщения
     @param msg - сообщение
 */
 void writeLogFile(const QString& prefix, const QString& msg);
 
 /*!
-    Делает тоже самое что и writeLogFile(...), но только в случае сборки DEBUG
+    Ожидает обработки всеми приемниками конвейера логирования сообщений, переданных в writeLogFile(...) и messageOutput(...)
+        до вызова этой функции. Время ожидания ограничено. Эта функция потокобезопасна
+*/
+void flushLogFile();
+
+/*!
+    Устанавливает формат файла лога. В двоичном формате (LogFileFormat::BINARY) каждое сообщение сохраняется как время (int64),
+        уровень (1 байт, LogLevel), ИД префикса (префиксы сохраняются в файл однократно) и текст сообщения в UTF-8.
+        Текст сообщения сохраняется уже отформатированным, отложенное форматирование не выполняется: logMessage(...)
+        и макросы LOG_XXX(...) формируют текст в месте вызова (formatLogMessage(...)), а qDebug()/QMessageLogger и
+        writeLogFile(...) передают готовые строки, поэтому строки формата и аргументы в файл не записываются. На ИД
+        заменяется только повторяющийся префикс, а поток записи не форматирует время.
+        Файл в двоичном формате имеет имя [название приложения].blog. По умолчанию используется текстовый формат.
+        Эта функция потокобезопасна
+    @param format - формат файла лога
+*/
+void setLogFileFormat(LogFileFormat format);
+
+/*!
+    Устанавливает параметры подавления лавины одинаковых сообщений в messageOutput(...) и writeLogMessage(...).
+        Сообщения считаются одинаковыми если совпадают тип, место вызова и текст. В течение окна выводятся
+        первые burstLimit одинаковых сообщений, остальные только подсчитываются, по окончании окна выводится
+        сообщение "Previous message repeated X more times". По умолчанию выводится 20 сообщений в 1с.
+        Фатальные сообщения не подавляются. Эта функция потокобезопасна
+    @param burstLimit - количество одинаковых сообщений, выводимых в течение окна. 0 - подавление отключено
+    @param window - длительность окна, мс
+*/
+void setLogSuppression(quint32 burstLimit, qint64 window);
+
+/*!
+    Делает тоже самое что и writeLogFile(...), но только если отладочные сообщения включены в сборку
+        (см. COMMON_LOG_MIN_LEVEL) и во время работы (см. setLogLevel(...)). Для исключения вычисления аргументов
+        используйте макрос LOG_DBG_FILE(...)
     @param prefix - префикс сообщения
     @param msg - сообщение
 */
@@ -0,0 +1,117 @@
+#pragma once
+
+//STL
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QByteArray>
+#include <QtSql/QSqlDatabase>
+
+//My
+#include "Common/sql.h"
+#include "Common/logsink.h"
+#include "Common/dblogschema.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBBulkLoader class - массовая загрузка сообщений лога в таблицу лога средствами сервера БД. Пачка сообщений
+///         записывается во временный файл и загружается одним запросом:
+///         - QMYSQL: LOAD DATA LOCAL INFILE из файла в формате TSV. В параметрах подключения должна быть разрешена
+///             опция MYSQL_OPT_LOCAL_INFILE=1, на сервере - local_infile;
+///         - QODBC (MS SQL): BULK INSERT из файла в формате CSV (SQL Server 2017 и выше). Поля файла сопоставляются
+///             со столбцами таблицы по имени XML файлом форматирования, поэтому таблица может содержать и другие столбцы
+///             (например, столбец IDENTITY). Файлы читаются сервером, поэтому папка временных файлов должна быть
+///             доступна серверу по тому же пути (например, общая папка UNC);
+///         - QSQLITE: массовая загрузка не нужна - подготовленный запрос в транзакции уже является самым быстрым
+///             способом записи (см. DBLogSink), isSupported() возвращает false.
+///         Столбцы файла соответствуют схеме хранения таблицы лога (см. DBLogSchema::columnNames())
+///
+class DBBulkLoader final
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Параметры массовой загрузки
+    ///
+    struct Params
+    {
+        bool isEnabled = true;          ///< Разрешить массовую загрузку
+        qint64 rateThreshold = 2000;    ///< Поток сообщений, начиная с которого используется массовая загрузка, сообщений/с
+        qint64 minRows = 1000;          ///< Минимальный размер пачки для массовой загрузки, строк
+        QString tempDirName;            ///< Папка временных файлов. Пустая - системная папка временных файлов
+        QString tableName;              ///< Таблица (или представление) для загрузки. Пустая - таблица записи схемы хранения
+    };
+
+public:
+    /*!
+        Возвращает true если для драйвера БД поддерживается массовая загрузка
+        @param driverName - название драйвера
+        @return true - если массовая загрузка поддерживается
+    */
+    static bool isSupported(const QString& driverName);
+
+public:
+    /*!
+        Конструктор
+        @param params - параметры массовой загрузки
+        @param schema - схема хранения таблицы лога. Должна существовать все время жизни объекта
+        @param sender - название сервиса отправителя логов
+    */
+    DBBulkLoader(const Params& params, const DBLogSchema& schema, const QString& sender);
+
+    /*!
+        Деструктор
+    */
+    ~DBBulkLoader() = default;
+
+    /*!
+        Загружает сообщения в таблицу. Должна вызываться внутри транзакции. Если возникнет ошибка - будет
+            сгенерированно исключение SQLException
+        @param db - подключение к БД. Драйвер должен поддерживаться (см. isSupported(...))
+        @param records - сообщения
+    */
+    void load(QSqlDatabase& db, const std::vector<LogRecord>& records) const;
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBBulkLoader() = delete;
+    Q_DISABLE_COPY_MOVE(DBBulkLoader);
+
+    /*!
+        Формирует содержимое файла загрузки в формате LOAD DATA (TSV, спецсимволы экранируются '\')
+        @param records - сообщения
+        @return содержимое файла в UTF-8
+    */
+    QByteArray makeMySqlData(const std::vector<LogRecord>& records) const;
+
+    /*!
+        Формирует XML файл форматирования BULK INSERT, сопоставляющий поля файла загрузки столбцам схемы хранения
+            (см. DBLogSchema::columnNames()). Типы столбцов определяются сервером по таблице
+        @return содержимое файла в UTF-8
+    */
+    QByteArray makeMsSqlFormat() const;
+
+    /*!
+        Формирует содержимое файла загрузки в формате CSV (RFC 4180)
+        @param records - сообщения
+        @return содержимое файла в UTF-8
+    */
+    QByteArray makeCsvData(const std::vector<LogRecord>& records) const;
+
+    /*!
+        Формирует значение поля времени сообщения в формате схемы хранения
+        @param record - сообщение
+        @return значение поля в UTF-8
+    */
+    QByteArray makeTimeField(const LogRecord& record) const;
+
+private:
+    const Params _params;       ///< Параметры массовой загрузки
+    const DBLogSchema& _schema; ///< Схема хранения таблицы лога
+    const QByteArray _sender;   ///< Название сервиса отправителя логов в UTF-8
+
+};
+
+} //namespace Common
@@ -0,0 +1,254 @@
+#pragma once
+
+//STL
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QtSql/QSqlDatabase>
+
+//My
+#include "Common/sql.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBConnectionPool class - пул подключений к БД. Подключение QSqlDatabase можно использовать только в потоке,
+///         который его открыл, поэтому свободные подключения хранятся отдельно для каждого потока, а общим для всех
+///         потоков является только ограничение их общего количества (maxSize). Подключение выдается в аренду
+///         (Lease) и возвращается в пул при удалении аренды. Свободное подключение, простаивавшее дольше
+///         validateInterval, перед выдачей проверяется запросом validationQuery. Свободные подключения, простаивающие
+///         дольше idleTimeout, закрываются при обращениях потока к пулу (acquire(), возврат аренды, evictIdle())
+///         и при завершении потока. Если все подключения заняты, acquire() ждет возврата подключения; пока есть
+///         ожидающие, возвращаемые подключения закрываются, а потоки при обращении к любому пулу закрывают свои
+///         свободные подключения этого пула (включая minIdle), освобождая место для ожидающих потоков.
+///         Подключение закрывает только поток-владелец, поэтому свободные подключения потока, который больше
+///         не обращается к пулам, освобождают место только при его завершении.
+///         Пул может быть удален раньше аренд и потоков: оставшиеся подключения закрываются при возврате аренды,
+///         при обращении потока-владельца к любому пулу или при завершении потока-владельца
+///
+class DBConnectionPool final
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Параметры пула
+    ///
+    struct Params
+    {
+        qsizetype maxSize = 16;                 ///< Максимальное количество подключений пула во всех потоках
+        qsizetype minIdle = 1;                  ///< Количество свободных подключений потока, которые не закрываются по простою
+        qint64 idleTimeout = 5 * 60 * 1000;     ///< 5 мин. Время простоя, после которого свободное подключение закрывается, мс
+        qint64 validateInterval = 30 * 1000;    ///< 30 с. Время простоя, после которого подключение проверяется при выдаче, мс. 0 - проверять всегда
+        qint64 acquireTimeout = 10 * 1000;      ///< 10 с. Максимальное время ожидания свободного места в пуле, мс
+        QString validationQuery = "SELECT 1";   ///< Запрос проверки подключения
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Статистика пула
+    ///
+    struct State
+    {
+        qsizetype totalCount = 0;   ///< Количество открытых подключений во всех потоках
+        qsizetype leasedCount = 0;  ///< Количество подключений, выданных в аренду
+        qsizetype idleCount = 0;    ///< Количество свободных подключений во всех потоках
+        qint64 createdCount = 0;    ///< Количество попыток открытия подключений за все время
+        qint64 closedCount = 0;     ///< Количество закрытых за все время подключений (простой, ошибка проверки, аренда с ошибкой)
+        qint64 waitCount = 0;       ///< Количество ожиданий свободного места в пуле
+        qint64 timeoutCount = 0;    ///< Количество отказов в выдаче подключения по таймауту ожидания
+    };
+
+private:
+    struct Core;
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Подключение пула
+    ///
+    struct Connection
+    {
+        QSqlDatabase db;                ///< Подключение
+        qint64 lastUsedTime = 0;        ///< Время последнего возврата в пул (QDeadlineTimer::current().deadline())
+        Qt::HANDLE threadId = nullptr;  ///< Поток-владелец подключения
+    };
+
+public:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     The Lease class - аренда подключения пула. Возвращает подключение в пул при удалении. Аренда должна
+    ///         использоваться и удаляться в том же потоке, в котором была получена
+    ///
+    class Lease final
+    {
+    public:
+        /*!
+            Конструктор перемещения
+            @param other - аренда. После перемещения пуста
+        */
+        Lease(Lease&& other) noexcept;
+
+        /*!
+            Оператор перемещения. Текущее подключение возвращается в пул
+            @param other - аренда. После перемещения пуста
+            @return ссылка на эту аренду
+        */
+        Lease& operator=(Lease&& other) noexcept;
+
+        /*!
+            Деструктор. Возвращает подключение в пул
+        */
+        ~Lease();
+
+        /*!
+            Возвращает подключение
+            @return подключение. Аренда не должна быть пустой
+        */
+        QSqlDatabase& db() noexcept;
+
+        /*!
+            Отмечает подключение как неисправное (например после ошибки связи). При возврате оно будет закрыто,
+                а не помещено в пул
+        */
+        void invalidate() noexcept;
+
+        /*!
+            Досрочно возвращает подключение в пул. После вызова аренда пуста
+        */
+        void release();
+
+    private:
+        friend class DBConnectionPool;
+
+        // Удаляем неиспользуемые конструкторы
+        Lease() = delete;
+        Q_DISABLE_COPY(Lease);
+
+        /*!
+            Конструктор
+            @param core - общие данные пула
+            @param connection - подключение
+        */
+        Lease(const std::shared_ptr<Core>& core, Connection&& connection);
+
+    private:
+        std::shared_ptr<Core> _core;    ///< Общие данные пула. nullptr - аренда пуста
+        Connection _connection;         ///< Подключение
+        bool _isValid = true;           ///< Подключение исправно
+
+    };
+
+public:
+    /*!
+        Конструктор. Подключения открываются по требованию
+        @param connectionInfo - параметры подключения к БД
+        @param name - название пула. Подключения получают имена [name]_[номер]
+        @param params - параметры пула
+    */
+    DBConnectionPool(const DBConnectionInfo& connectionInfo, const QString& name, const Params& params);
+
+    /*!
+        Деструктор. Закрывает свободные подключения текущего потока
+    */
+    ~DBConnectionPool();
+
+    /*!
+        Выдает подключение в аренду. Сначала используются свободные подключения текущего потока, если их нет
+            и общее количество подключений меньше максимального - открывается новое. Если возникнет ошибка
+            подключения или истечет время ожидания - будет сгенерированно исключение SQLException. Этот метод потокобезопасный
+        @return аренда подключения
+    */
+    Lease acquire();
+
+    /*!
+        Закрывает свободные подключения текущего потока, простаивающие дольше idleTimeout. Этот метод потокобезопасный
+    */
+    void evictIdle();
+
+    /*!
+        Возвращает статистику пула. Этот метод потокобезопасный
+        @return статистика
+    */
+    State state() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Свободные подключения пула в одном потоке. Используется только потоком-владельцем
+    ///
+    struct ThreadSlot
+    {
+        /*!
+            Конструктор
+            @param core - общие данные пула
+        */
+        explicit ThreadSlot(const std::shared_ptr<Core>& core);
+
+        /*!
+            Деструктор. Закрывает свободные подключения (вызывается в потоке-владельце)
+        */
+        ~ThreadSlot();
+
+        std::shared_ptr<Core> core;     ///< Общие данные пула
+        std::vector<Connection> idle;   ///< Свободные подключения в порядке возврата
+    };
+
+    using ThreadSlots = std::unordered_map<quint64, std::unique_ptr<ThreadSlot>>; ///< Свободные подключения потока по ИД пула
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBConnectionPool() = delete;
+    Q_DISABLE_COPY_MOVE(DBConnectionPool);
+
+    /*!
+        Возвращает свободные подключения пулов в текущем потоке
+        @return свободные подключения текущего потока по ИД пула
+    */
+    static ThreadSlots& threadSlots();
+
+    /*!
+        Возвращает свободные подключения пула в текущем потоке. При первом вызове в потоке создает их список.
+            Закрывает простаивающие подключения других пулов текущего потока (см. evictIdle(ThreadSlot&, qint64))
+            и удаляет списки удаленных пулов
+        @param core - общие данные пула
+        @return свободные подключения
+    */
+    static ThreadSlot& threadSlot(const std::shared_ptr<Core>& core);
+
+    /*!
+        Возвращает подключение в пул текущего потока или закрывает его, если есть ожидающие потоки или пул удален
+        @param core - общие данные пула
+        @param connection - подключение
+        @param isValid - подключение исправно
+    */
+    static void release(const std::shared_ptr<Core>& core, Connection&& connection, bool isValid);
+
+    /*!
+        Закрывает простаивающие подключения потока сверх minIdle. Если пул удален или другие потоки ждут места
+            в пуле - закрывает все свободные подключения
+        @param slot - свободные подключения потока
+        @param now - текущее время (QDeadlineTimer::current().deadline())
+    */
+    static void evictIdle(ThreadSlot& slot, qint64 now);
+
+    /*!
+        Проверяет подключение запросом validationQuery, если оно простаивало дольше validateInterval
+        @param core - общие данные пула
+        @param connection - подключение
+        @param now - текущее время (QDeadlineTimer::current().deadline())
+        @return true - если подключение исправно
+    */
+    static bool validate(const Core& core, Connection& connection, qint64 now);
+
+    /*!
+        Закрывает подключение и освобождает место в пуле
+        @param core - общие данные пула
+        @param connection - подключение
+        @param isIdle - подключение было свободным (учтено в Core::idleCount)
+    */
+    static void close(Core& core, Connection& connection, bool isIdle);
+
+private:
+    std::shared_ptr<Core> _core;    ///< Общие данные пула. Разделяются с арендами и свободными подключениями потоков
+
+};
+
+} //namespace Common
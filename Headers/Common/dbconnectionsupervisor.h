@@ -0,0 +1,109 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <memory>
+
+//Qt
+#include <QString>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+//My
+#include "Common/sql.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBConnectionSupervisor class - наблюдатель за доступностью БД. Владелец подключения сообщает об ошибке
+///         работы с БД (reportFailure(...)), после чего наблюдатель переходит в состояние DEGRADED и в своем потоке
+///         периодически пробует подключиться к БД отдельным пробным подключением, увеличивая интервал попыток
+///         экспоненциально (со случайным разбросом, чтобы клиенты не переподключались одновременно). После успешной
+///         попытки наблюдатель переходит в состояние CONNECTED и владелец может переоткрыть свое подключение.
+///         В состоянии DEGRADED владельцы подключений не должны обращаться к БД, чтобы не ждать таймаутов подключения.
+///         Все методы потокобезопасные
+///
+class DBConnectionSupervisor final
+{
+public:
+    /*!
+        Состояние подключения к БД
+     */
+    enum class State: quint8
+    {
+        CONNECTED = 0,  ///< БД доступна
+        DEGRADED = 1    ///< БД недоступна, выполняются попытки переподключения
+    };
+
+public:
+    /*!
+        Конструктор. Запускает поток попыток переподключения. Начальное состояние - CONNECTED
+        @param connectionInfo - параметры подключения к БД
+        @param connectionName - название подключения владельца. Пробное подключение получает имя [connectionName]_Probe
+    */
+    DBConnectionSupervisor(const DBConnectionInfo& connectionInfo, const QString& connectionName);
+
+    /*!
+        Деструктор. Останавливает поток попыток переподключения
+    */
+    ~DBConnectionSupervisor();
+
+    /*!
+        Возвращает текущее состояние подключения
+        @return состояние
+    */
+    State state() const noexcept { return _state.load(std::memory_order_acquire); }
+
+    /*!
+        Возвращает true если БД доступна (состояние CONNECTED)
+        @return true - если БД доступна
+    */
+    bool isAvailable() const noexcept { return state() == State::CONNECTED; }
+
+    /*!
+        Возвращает количество переходов в состояние DEGRADED
+        @return количество отказов БД
+    */
+    qint64 failureCount() const noexcept { return _failureCount.load(std::memory_order_relaxed); }
+
+    /*!
+        Сообщает об ошибке работы с БД. Переводит наблюдатель в состояние DEGRADED и запускает попытки переподключения
+        @param errorString - текст ошибки
+    */
+    void reportFailure(const QString& errorString);
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBConnectionSupervisor() = delete;
+    Q_DISABLE_COPY_MOVE(DBConnectionSupervisor);
+
+    /*!
+        Основной цикл потока попыток переподключения
+    */
+    void run();
+
+    /*!
+        Выполняет пробное подключение к БД
+        @param errorString - сюда будет помещен текст ошибки
+        @return true - если подключение успешно
+    */
+    bool probe(QString& errorString) const;
+
+private:
+    const DBConnectionInfo _connectionInfo;         ///< Параметры подключения к БД
+    const QString _connectionName;                  ///< Название подключения владельца
+
+    std::atomic<State> _state = State::CONNECTED;   ///< Текущее состояние
+    std::atomic<qint64> _failureCount = 0;          ///< Количество переходов в состояние DEGRADED
+
+    QMutex _wakeUpMutex;                            ///< Мьютекс пробуждения потока
+    QWaitCondition _wakeUpCondition;                ///< Пробуждение потока
+    bool _isStopped = false;                        ///< Флаг остановки потока
+
+    std::unique_ptr<QThread> _thread;               ///< Поток попыток переподключения
+
+};
+
+} //namespace Common
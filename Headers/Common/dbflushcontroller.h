@@ -0,0 +1,123 @@
+#pragma once
+
+//STL
+#include <atomic>
+
+//Qt
+#include <QtGlobal>
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBFlushController class - политика записи пачек сообщений лога в БД (см. DBLogSink). Пачка записывается
+///         когда набрано целевое количество строк, превышен бюджет по объему или самое старое сообщение пачки ждет
+///         дольше максимальной задержки. Целевой размер пачки подстраивается под время коммита: при медленной БД
+///         пачки увеличиваются (больше строк на коммит), при быстрой - уменьшаются (меньше задержка). Методы изменения
+///         состояния вызываются только из потока записи, state() - из любого потока
+///
+class DBFlushController final
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Параметры политики записи
+    ///
+    struct Params
+    {
+        qint64 maxLatency = 1000;               ///< Максимальное время ожидания сообщения в пачке, мс
+        qint64 maxBytes = 4 * 1024 * 1024;      ///< Максимальный объем пачки, байт
+        qint64 minBatchSize = 10;               ///< Минимальный целевой размер пачки, строк
+        qint64 maxBatchSize = 5000;             ///< Максимальный целевой размер пачки, строк
+        qint64 targetCommitTime = 50;           ///< Время коммита, выше которого БД считается медленной, мс. Ниже половины этого времени - быстрой
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Текущее состояние политики записи (для мониторинга)
+    ///
+    struct State
+    {
+        qint64 batchSize = 0;                   ///< Текущий целевой размер пачки, строк
+        qint64 pendingRows = 0;                 ///< Строк в накопленной пачке
+        qint64 pendingBytes = 0;                ///< Объем накопленной пачки, байт
+        qint64 commitTime = 0;                  ///< Сглаженное время коммита, мс
+        qint64 commitCount = 0;                 ///< Количество успешных коммитов
+        qint64 rowCount = 0;                    ///< Количество записанных строк
+        qint64 failCount = 0;                   ///< Количество неудачных попыток записи
+    };
+
+public:
+    /*!
+        Конструктор. Используются параметры по умолчанию (см. setParams(...))
+    */
+    DBFlushController();
+
+    /*!
+        Деструктор
+    */
+    ~DBFlushController() = default;
+
+    /*!
+        Устанавливает параметры политики записи. Целевой размер пачки сбрасывается на минимальный
+        @param params - параметры
+    */
+    void setParams(const Params& params);
+
+    /*!
+        Возвращает параметры политики записи
+        @return параметры
+    */
+    const Params& params() const noexcept { return _params; }
+
+    /*!
+        Учитывает сообщение, добавленное в пачку
+        @param bytes - объем сообщения, байт
+        @param now - текущее время (QDeadlineTimer::current().deadline())
+    */
+    void add(qint64 bytes, qint64 now);
+
+    /*!
+        Возвращает true если накопленную пачку пора записать
+        @param now - текущее время (QDeadlineTimer::current().deadline())
+        @return true - если пачку пора записать
+    */
+    bool isFlushNeeded(qint64 now) const;
+
+    /*!
+        Учитывает результат записи пачки и подстраивает целевой размер пачки. Накопленная пачка считается пустой
+        @param commitTime - время записи пачки, мс
+        @param isSuccess - true - пачка успешно записана
+    */
+    void flushed(qint64 commitTime, bool isSuccess);
+
+    /*!
+        Сбрасывает накопленную пачку без записи в БД (например, когда пачка сохранена в дисковую очередь).
+            Статистика коммитов и целевой размер пачки не изменяются
+    */
+    void reset();
+
+    /*!
+        Возвращает текущее состояние. Этот метод потокобезопасный
+        @return состояние
+    */
+    State state() const;
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(DBFlushController);
+
+private:
+    Params _params;                             ///< Параметры политики записи
+
+    qint64 _firstPendingTime = 0;               ///< Время добавления первого сообщения накопленной пачки
+
+    std::atomic<qint64> _batchSize = 0;         ///< Текущий целевой размер пачки
+    std::atomic<qint64> _pendingRows = 0;       ///< Строк в накопленной пачке
+    std::atomic<qint64> _pendingBytes = 0;      ///< Объем накопленной пачки
+    std::atomic<qint64> _commitTime = 0;        ///< Сглаженное время коммита
+    std::atomic<qint64> _commitCount = 0;       ///< Количество успешных коммитов
+    std::atomic<qint64> _rowCount = 0;          ///< Количество записанных строк
+    std::atomic<qint64> _failCount = 0;         ///< Количество неудачных попыток записи
+
+};
+
+} //namespace Common
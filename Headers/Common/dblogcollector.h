@@ -0,0 +1,89 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//Qt
+#include <QMutex>
+
+//My
+#include "Common/logsink.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogCollector class - сборщик сообщений из буферов потоков. Каждый поток-отправитель пишет в собственный
+///         буфер (вектор сообщений под собственным мьютексом, который захватывается без конкуренции, кроме момента
+///         сбора), поэтому добавление сообщения - это добавление в конец вектора без выделения памяти на каждое
+///         сообщение. Поток-сборщик периодически забирает содержимое всех буферов целиком. Порядок сообщений
+///         сохраняется в пределах одного потока-отправителя. Буфер завершившегося потока удаляется после сбора
+///         его сообщений
+///
+class DBLogCollector final
+{
+public:
+    /*!
+        Конструктор
+    */
+    DBLogCollector();
+
+    /*!
+        Деструктор. Сообщения, не забранные сборщиком, теряются
+    */
+    ~DBLogCollector();
+
+    /*!
+        Добавляет сообщение в буфер текущего потока. Этот метод потокобезопасный
+        @param record - сообщение
+        @return количество сообщений в буфере текущего потока после добавления. 0 - сборщик закрыт, сообщение отброшено
+    */
+    qsizetype append(LogRecord&& record);
+
+    /*!
+        Забирает сообщения из буферов всех потоков. Вызывается только из потока-сборщика
+        @param records - сюда будут добавлены сообщения
+    */
+    void drain(std::vector<LogRecord>& records);
+
+    /*!
+        Закрывает сборщик. После закрытия сообщения не принимаются. Этот метод потокобезопасный
+    */
+    void close();
+
+private:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Буфер сообщений потока-отправителя
+    ///
+    struct ThreadBuffer
+    {
+        QMutex mutex;                   ///< Мьютекс буфера
+        std::vector<LogRecord> records; ///< Сообщения
+        bool isClosed = false;          ///< Сборщик закрыт
+    };
+
+    using PThreadBuffer = std::shared_ptr<ThreadBuffer>;
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(DBLogCollector);
+
+    /*!
+        Возвращает буфер текущего потока. При первом вызове в потоке создает и регистрирует буфер
+        @return буфер текущего потока
+    */
+    ThreadBuffer& threadBuffer();
+
+private:
+    const quint64 _id;                      ///< Уникальный идентификатор сборщика (ключ буферов потока)
+
+    QMutex _buffersMutex;                   ///< Мьютекс списка буферов
+    std::vector<PThreadBuffer> _buffers;    ///< Буферы потоков-отправителей
+    std::vector<LogRecord> _spare;          ///< Пустой вектор для обмена с буфером при сборе. Используется только потоком-сборщиком
+    std::atomic<bool> _isClosed = false;    ///< Сборщик закрыт
+
+};
+
+} //namespace Common
@@ -0,0 +1,152 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtSql/QSqlDatabase>
+
+//My
+#include "Common/sql.h"
+#include "Common/logsink.h"
+#include "Common/dblogschema.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogLocalStore class - локальное хранилище лога в файле SQLite для площадок с ненадежной связью с центральной
+///         БД. Сообщения записываются пачками в локальную БД (режим WAL, synchronous=NORMAL), поэтому запись идет
+///         со скоростью локального диска и не зависит от связи. Фоновый поток пересылки читает сообщения после
+///         отметки последнего пересланного сообщения (high-water mark) большими порциями, записывает их в центральную
+///         БД одной транзакцией и после подтверждения сдвигает отметку и удаляет пересланные строки. Если центральная
+///         БД недоступна, попытки повторяются с экспоненциально растущим интервалом.
+///         Доставка "не менее одного раза": при аварийном завершении между подтверждением транзакции в центральной БД
+///         и сдвигом отметки последняя порция будет переслана повторно.
+///         insert(...) вызывается только из потока, вызвавшего open(...)
+///
+class DBLogLocalStore final
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Параметры локального хранилища
+    ///
+    struct Params
+    {
+        bool isEnabled = false;             ///< Записывать сообщения в локальное хранилище вместо центральной БД
+        QString fileName;                   ///< Файл БД. Пустой - [расположение exe файла]/Log/[название приложения]_[таблица лога].db
+        qint64 shipBatchSize = 10000;       ///< Количество сообщений, пересылаемых одной транзакцией
+        qint64 shipInterval = 1000;         ///< Интервал проверки новых сообщений для пересылки, мс
+        qint64 cacheSize = 8 * 1024;        ///< Размер кеша страниц SQLite, КБ
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Статистика локального хранилища
+    ///
+    struct State
+    {
+        qint64 storedRows = 0;      ///< Количество сообщений, записанных в локальное хранилище
+        qint64 shippedRows = 0;     ///< Количество сообщений, пересланных в центральную БД
+        qint64 highWaterMark = 0;   ///< ИД последнего пересланного сообщения
+        qint64 failCount = 0;       ///< Количество неудачных попыток пересылки
+    };
+
+public:
+    /*!
+        Конструктор
+        @param params - параметры локального хранилища
+        @param connectionInfo - параметры подключения к центральной БД
+        @param schema - схема хранения таблицы лога в центральной БД
+        @param sender - название сервиса отправителя логов
+    */
+    DBLogLocalStore(const Params& params, const DBConnectionInfo& connectionInfo, const DBLogSchema& schema, const QString& sender);
+
+    /*!
+        Деструктор. Останавливает поток пересылки и закрывает локальную БД. Не пересланные сообщения остаются
+            в локальной БД и будут пересланы после следующего запуска
+    */
+    ~DBLogLocalStore();
+
+    /*!
+        Открывает (создает) локальную БД и запускает поток пересылки
+        @param errorString - сюда будет помещен текст ошибки
+        @return true - в случае успеха
+    */
+    bool open(QString& errorString);
+
+    /*!
+        Записывает сообщения в локальную БД одной транзакцией
+        @param records - сообщения
+        @param errorString - сюда будет помещен текст ошибки
+        @return true - в случае успеха
+    */
+    bool insert(const std::vector<LogRecord>& records, QString& errorString);
+
+    /*!
+        Возвращает статистику локального хранилища. Этот метод потокобезопасный
+        @return статистика
+    */
+    State state() const;
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBLogLocalStore() = delete;
+    Q_DISABLE_COPY_MOVE(DBLogLocalStore);
+
+    /*!
+        Основной цикл потока пересылки
+    */
+    void run();
+
+    /*!
+        Пересылает одну порцию сообщений в центральную БД. Если возникнет ошибка - будет сгенерированно исключение SQLException
+        @param localDB - подключение к локальной БД
+        @param centralDB - подключение к центральной БД. Если закрыто - будет открыто
+        @param schema - схема хранения центральной БД
+        @return количество пересланных сообщений
+    */
+    qint64 ship(QSqlDatabase& localDB, QSqlDatabase& centralDB, DBLogSchema& schema);
+
+    /*!
+        Подключается к локальной БД и настраивает ее. Если возникнет ошибка - будет сгенерированно исключение SQLException
+        @param db - подключение
+        @param connectionName - название подключения
+    */
+    void connectToLocalDB(QSqlDatabase& db, const QString& connectionName) const;
+
+    /*!
+        Ожидает истечения интервала или остановки потока
+        @param interval - интервал ожидания, мс
+        @return true - если интервал истек, false - если поток остановлен
+    */
+    bool waitFor(qint64 interval);
+
+private:
+    const Params _params;                       ///< Параметры локального хранилища
+    const DBConnectionInfo _connectionInfo;     ///< Параметры подключения к центральной БД
+    const DBLogSchema _schema;                  ///< Схема хранения таблицы лога в центральной БД
+    const QString _sender;                      ///< Название сервиса отправителя логов
+    QString _fileName;                          ///< Файл локальной БД
+
+    QSqlDatabase _db;                           ///< Подключение к локальной БД для записи
+
+    std::atomic<qint64> _storedRows = 0;        ///< Количество сообщений, записанных в локальное хранилище
+    std::atomic<qint64> _shippedRows = 0;       ///< Количество сообщений, пересланных в центральную БД
+    std::atomic<qint64> _highWaterMark = 0;     ///< ИД последнего пересланного сообщения
+    std::atomic<qint64> _failCount = 0;         ///< Количество неудачных попыток пересылки
+
+    QMutex _wakeUpMutex;                        ///< Мьютекс пробуждения потока
+    QWaitCondition _wakeUpCondition;            ///< Пробуждение потока
+    bool _isStopped = false;                    ///< Флаг остановки потока
+
+    std::unique_ptr<QThread> _thread;           ///< Поток пересылки
+
+};
+
+} //namespace Common
@@ -0,0 +1,176 @@
+#pragma once
+
+//STL
+#include <limits>
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QList>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+//My
+#include "Common/sql.h"
+#include "Common/dblogschema.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     Условия отбора сообщений таблицы лога
+///
+struct DBLogFilter
+{
+    qint64 from = 0;                                ///< Начало интервала времени включительно, мс от начала эпохи
+    qint64 to = std::numeric_limits<qint64>::max(); ///< Конец интервала времени не включительно, мс от начала эпохи. Максимум - без ограничения
+    QList<quint8> categories;                       ///< Категории (TDBLoger::MSG_CODE). Пустой - все категории
+    QString sender;                                 ///< Отправитель. Пустой - все отправители
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     Сообщение таблицы лога
+///
+struct DBLogRow
+{
+    qint64 id = 0;          ///< Идентификатор строки (DBLogSchema::idColumnName(...))
+    qint64 dateTime = 0;    ///< Время сообщения, мс от начала эпохи
+    quint8 category = 0;    ///< Категория (TDBLoger::MSG_CODE)
+    QString sender;         ///< Отправитель
+    QString msg;            ///< Сообщение
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogCursor class - потоковое чтение сообщений таблицы лога в порядке времени. Запрос выполняется
+///         без подготовки и в режиме "только вперед", поэтому драйвер не загружает результат целиком (QMYSQL читает
+///         строки с сервера по мере вызова next(...)). Подключение к БД должно существовать все время жизни курсора
+///         и не использоваться для других запросов до его удаления
+///
+class DBLogCursor final
+{
+public:
+    /*!
+        Конструктор. Выполняет запрос. Если возникнет ошибка - будет сгенерированно исключение SQLException
+        @param db - подключение к БД
+        @param schema - схема хранения таблицы лога
+        @param filter - условия отбора
+    */
+    DBLogCursor(QSqlDatabase& db, const DBLogSchema& schema, const DBLogFilter& filter);
+
+    /*!
+        Деструктор. Освобождает результат запроса
+    */
+    ~DBLogCursor();
+
+    /*!
+        Считывает очередное сообщение
+        @param row - сюда будет помещено сообщение
+        @return true - если сообщение считано, false - если сообщения закончились
+    */
+    bool next(DBLogRow& row);
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBLogCursor() = delete;
+    Q_DISABLE_COPY_MOVE(DBLogCursor);
+
+private:
+    const DBLogSchema _schema;  ///< Схема хранения таблицы лога
+    QSqlQuery _query;           ///< Запрос
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogReader class - постраничное чтение сообщений таблицы лога, записанной TDBLoger. Страницы выбираются
+///         по ключу (keyset): сообщения упорядочены по времени и уникальному идентификатору строки, следующая
+///         страница начинается сразу после пары (время, идентификатор) последнего сообщения предыдущей. Каждый
+///         запрос - просмотр диапазона индекса, а не пропуск всех предыдущих строк, и сообщения с одинаковым временем
+///         не теряются и не повторяются на границе страниц, в том числе при вставке новых сообщений между запросами.
+///         Индексы под условия отбора создает createIndexes(...)
+///
+class DBLogReader final
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Позиция начала страницы
+    ///
+    struct PageKey
+    {
+        qint64 time = -1;   ///< Значение столбца времени последнего сообщения предыдущей страницы (мс от начала эпохи для CLASSIC, мкс для COMPACT)
+        qint64 id = -1;     ///< Идентификатор последнего сообщения предыдущей страницы. -1 - первая страница
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Страница сообщений
+    ///
+    struct Page
+    {
+        std::vector<DBLogRow> rows; ///< Сообщения в порядке времени
+        PageKey next;               ///< Позиция следующей страницы
+        bool isLast = true;         ///< true - это последняя страница
+    };
+
+public:
+    /*!
+        Конструктор
+        @param db - подключение к БД. Должно существовать все время жизни объекта
+        @param schema - схема хранения таблицы лога
+    */
+    DBLogReader(QSqlDatabase& db, const DBLogSchema& schema);
+
+    /*!
+        Деструктор
+    */
+    ~DBLogReader() = default;
+
+    /*!
+        Считывает страницу сообщений. Если возникнет ошибка - будет сгенерированно исключение SQLException
+        @param filter - условия отбора
+        @param key - позиция начала страницы (Page::next предыдущей страницы)
+        @param pageSize - максимальное количество сообщений на странице
+        @return страница
+    */
+    Page readPage(const DBLogFilter& filter, const PageKey& key, qint64 pageSize);
+
+public:
+    /*!
+        Создает индексы таблицы лога под условия отбора DBLogFilter: по времени, по категории и времени, по отправителю
+            и времени. Индексы дополнены идентификатором строки, задающим порядок страниц (в SQLite rowid входит в любой
+            индекс). Существующие индексы не изменяются. Если возникнет ошибка - будет сгенерированно исключение SQLException
+        @param db - подключение к БД
+        @param schema - схема хранения таблицы лога
+    */
+    static void createIndexes(QSqlDatabase& db, const DBLogSchema& schema);
+
+    /*!
+        Формирует текст запроса на выборку сообщений в порядке времени и идентификатора строки. Значения условий вставляются в текст
+            запроса (строки экранируются драйвером), чтобы запрос можно было выполнить без подготовки
+        @param db - подключение к БД
+        @param schema - схема хранения таблицы лога
+        @param filter - условия отбора
+        @param key - позиция начала выборки
+        @param limit - максимальное количество строк. -1 - без ограничения
+        @return текст запроса
+    */
+    static QString makeSelectQuery(const QSqlDatabase& db, const DBLogSchema& schema, const DBLogFilter& filter, const PageKey& key, qint64 limit);
+
+    /*!
+        Считывает сообщение из текущей строки результата запроса makeSelectQuery(...)
+        @param query - запрос
+        @param schema - схема хранения таблицы лога
+        @return сообщение
+    */
+    static DBLogRow readRow(const QSqlQuery& query, const DBLogSchema& schema);
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBLogReader() = delete;
+    Q_DISABLE_COPY_MOVE(DBLogReader);
+
+private:
+    QSqlDatabase& _db;          ///< Подключение к БД
+    const DBLogSchema _schema;  ///< Схема хранения таблицы лога
+
+};
+
+} //namespace Common
@@ -0,0 +1,165 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <memory>
+
+//Qt
+#include <QString>
+#include <QDate>
+#include <QMap>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtSql/QSqlDatabase>
+
+//My
+#include "Common/sql.h"
+#include "Common/dblogschema.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogRetention class - удаление устаревших логов из таблицы лога в фоновом потоке. Поток использует отдельное
+///         подключение к БД и запускается с задержкой, поэтому запуск логера не ждет удаления. Поддерживаются стратегии:
+///         - PARTITIONS: таблица MySQL секционирована по дням (PARTITION BY RANGE (TO_DAYS(`DateTime`))). Устаревшие
+///             секции удаляются целиком (DROP PARTITION), секции на несколько дней вперед создаются заранее выделением
+///             из секции MAXVALUE;
+///         - CHUNKS: устаревшие строки удаляются небольшими порциями по индексу времени, начиная с самых старых. Каждая
+///             порция удаляется отдельной транзакцией, между порциями выдерживается пауза не меньше времени удаления
+///             порции, чтобы удаление занимало не больше половины времени работы БД.
+///         Стратегия AUTO выбирает PARTITIONS если таблица схемы CLASSIC секционирована по дням, иначе - CHUNKS
+///
+class DBLogRetention final
+{
+public:
+    /*!
+        Стратегия удаления устаревших логов
+     */
+    enum class Strategy: quint8
+    {
+        AUTO = 0,       ///< Определить по таблице
+        PARTITIONS = 1, ///< Удаление секций по дням (только MySQL)
+        CHUNKS = 2      ///< Удаление порциями
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Параметры удаления устаревших логов
+    ///
+    struct Params
+    {
+        Strategy strategy = Strategy::AUTO;     ///< Стратегия удаления
+        qint64 maxAge = 60 * 60 * 24 * 30;      ///< 30 дней. Время хранения логов в БД, с
+        qint64 startDelay = 60 * 1000;          ///< 1 мин. Задержка первого удаления после запуска, мс
+        qint64 checkInterval = 60 * 60 * 1000;  ///< 1 ч. Интервал проверки наличия устаревших логов, мс
+        qint64 chunkSize = 5000;                ///< Количество строк, удаляемых одной транзакцией
+        qint64 chunkPause = 200;                ///< Минимальная пауза между порциями, мс
+        qint64 partitionsAhead = 3;             ///< Количество секций, создаваемых заранее, дней
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Статистика удаления устаревших логов
+    ///
+    struct State
+    {
+        qint64 deletedRows = 0;         ///< Количество удаленных строк (стратегия CHUNKS)
+        qint64 droppedPartitions = 0;   ///< Количество удаленных секций (стратегия PARTITIONS)
+        qint64 lastRunTime = 0;         ///< Время завершения последнего удаления, мс от начала эпохи. 0 - удаление не выполнялось
+        qint64 errorCount = 0;          ///< Количество неудачных попыток удаления
+    };
+
+public:
+    /*!
+        Конструктор. Запускает поток удаления
+        @param connectionInfo - параметры подключения к БД
+        @param schema - схема хранения таблицы лога. Подключение к БД получает имя [название таблицы]_Retention
+        @param params - параметры удаления
+    */
+    DBLogRetention(const DBConnectionInfo& connectionInfo, const DBLogSchema& schema, const Params& params);
+
+    /*!
+        Деструктор. Останавливает поток удаления. Выполняемый в этот момент запрос к БД не прерывается
+    */
+    ~DBLogRetention();
+
+    /*!
+        Возвращает статистику удаления. Этот метод потокобезопасный
+        @return статистика
+    */
+    State state() const;
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBLogRetention() = delete;
+    Q_DISABLE_COPY_MOVE(DBLogRetention);
+
+    /*!
+        Основной цикл потока удаления
+    */
+    void run();
+
+    /*!
+        Удаляет устаревшие логи выбранной стратегией. Если возникнет ошибка - будет сгенерированно исключение SQLException
+        @param db - подключение к БД
+    */
+    void clearOldLog(QSqlDatabase& db);
+
+    /*!
+        Удаляет устаревшие секции и создает секции на дни вперед. Если возникнет ошибка - будет сгенерированно
+            исключение SQLException
+        @param db - подключение к БД
+        @param partitions - секции таблицы: номер дня TO_DAYS() верхней границы -> название секции. Секция MAXVALUE
+            имеет ключ -1
+    */
+    void clearPartitions(QSqlDatabase& db, const QMap<qint64, QString>& partitions);
+
+    /*!
+        Удаляет устаревшие строки порциями. Прерывается при остановке потока. Если возникнет ошибка - будет
+            сгенерированно исключение SQLException
+        @param db - подключение к БД
+    */
+    void clearChunks(QSqlDatabase& db);
+
+    /*!
+        Возвращает секции таблицы лога, если она секционирована по дням. Если возникнет ошибка - будет
+            сгенерированно исключение SQLException
+        @param db - подключение к БД
+        @return секции (см. clearPartitions(...)). Пустой список - таблица не секционирована по дням
+    */
+    QMap<qint64, QString> loadPartitions(QSqlDatabase& db) const;
+
+    /*!
+        Ожидает истечения интервала или остановки потока
+        @param interval - интервал ожидания, мс
+        @return true - если интервал истек, false - если поток остановлен
+    */
+    bool waitFor(qint64 interval);
+
+    /*!
+        Возвращает номер дня в формате функции MySQL TO_DAYS()
+        @param date - дата
+        @return номер дня
+    */
+    static qint64 toDays(const QDate& date);
+
+private:
+    const DBConnectionInfo _connectionInfo;     ///< Параметры подключения к БД
+    const DBLogSchema _schema;                  ///< Схема хранения таблицы лога
+    const QString _tableName;                   ///< Название таблицы, из которой удаляются логи
+    const Params _params;                       ///< Параметры удаления
+
+    std::atomic<qint64> _deletedRows = 0;       ///< Количество удаленных строк
+    std::atomic<qint64> _droppedPartitions = 0; ///< Количество удаленных секций
+    std::atomic<qint64> _lastRunTime = 0;       ///< Время завершения последнего удаления, мс от начала эпохи
+    std::atomic<qint64> _errorCount = 0;        ///< Количество неудачных попыток удаления
+
+    QMutex _wakeUpMutex;                        ///< Мьютекс пробуждения потока
+    QWaitCondition _wakeUpCondition;            ///< Пробуждение потока
+    bool _isStopped = false;                    ///< Флаг остановки потока
+
+    std::unique_ptr<QThread> _thread;           ///< Поток удаления
+
+};
+
+} //namespace Common
@@ -0,0 +1,210 @@
+#pragma once
+
+//STL
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QStringList>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+//My
+#include "Common/sql.h"
+#include "Common/logsink.h"
+#include "Common/dbstatementcache.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogSchema class - схема хранения таблицы лога. Определяет таблицы, тексты запросов и формат значений
+///         для поддерживаемых драйверов (QMYSQL, QSQLITE, остальные - синтаксис MS SQL). Схемы:
+///         - CLASSIC: таблица [Log] (Id, DateTime, Category, Sender, Msg), время хранится как DATETIME, отправитель - строкой,
+///             Id - IDENTITY/AUTO_INCREMENT (в SQLite вместо него используется rowid);
+///         - COMPACT: таблица данных [Log_Data] (Id, TimeUs, Category, SenderId, Msg), где время - целое число микросекунд
+///             от начала эпохи (UTC), категория - TINYINT, отправитель - идентификатор из словаря [Log_Sender] (Id, Name).
+///             Представление [Log] с прежним набором столбцов создается при миграции (см. migrateToCompact(...)).
+///         Объект используется только в одном потоке
+///
+class DBLogSchema final
+{
+public:
+    /*!
+        Схема хранения
+     */
+    enum class Type: quint8
+    {
+        CLASSIC = 0,    ///< Одна таблица, время и отправитель хранятся как есть
+        COMPACT = 1     ///< Таблица данных с целочисленными полями и словарь отправителей
+    };
+
+public:
+    /*!
+        Конструктор
+        @param type - схема хранения
+        @param logName - название таблицы лога. В схеме COMPACT - префикс названий таблиц и название представления
+    */
+    DBLogSchema(Type type, const QString& logName);
+
+    /*!
+        Возвращает схему хранения
+        @return схема
+    */
+    Type type() const noexcept { return _type; }
+
+    /*!
+        Возвращает название таблицы, в которую записываются сообщения
+        @return название таблицы
+    */
+    QString tableName() const;
+
+    /*!
+        Возвращает название таблицы словаря отправителей (только схема COMPACT)
+        @return название таблицы
+    */
+    QString senderTableName() const;
+
+    /*!
+        Подготавливает схему к записи после подключения к БД. В схеме COMPACT создает таблицы, если их нет,
+            и получает идентификатор отправителя из словаря (добавляя его при необходимости). Если возникнет ошибка -
+            будет сгенерированно исключение SQLException
+        @param db - подключение к БД
+        @param sender - название сервиса отправителя логов
+    */
+    void prepare(QSqlDatabase& db, const QString& sender);
+
+    /*!
+        Формирует текст подготавливаемого запроса на добавление сообщений INSERT ... VALUES (...), (...).
+            Параметры каждой строки: время, категория, отправитель, сообщение
+        @param driverName - название драйвера БД
+        @param rowCount - количество строк запроса
+        @return текст запроса
+    */
+    QString makeInsertQuery(const QString& driverName, qsizetype rowCount = 1) const;
+
+    /*!
+        Добавляет сообщения в таблицу лога. Если драйвер выполняет пакет запросов за одно обращение к серверу
+            (QSqlDriver::BatchOperations) - используется однострочный запрос и execBatch(). Иначе (например QMYSQL,
+            где execBatch() выполняет запрос отдельно для каждой строки) сообщения добавляются многострочными
+            запросами порциями до MAX_INSERT_ROW_COUNT строк. Подготовленные запросы берутся из кеша. Вызывается
+            внутри транзакции. Если возникнет ошибка - будет сгенерированно исключение SQLException
+        @param db - подключение к БД
+        @param statements - кеш подготовленных запросов подключения db
+        @param records - сообщения
+        @param sender - название сервиса отправителя логов
+    */
+    void insertRecords(QSqlDatabase& db, DBStatementCache& statements, const std::vector<LogRecord>& records,
+                       const QString& sender) const;
+
+    /*!
+        Формирует текст запроса на удаление одной порции сообщений старше lastLog, начиная с самых старых
+        @param driverName - название драйвера БД
+        @param lastLog - время самого старого сохраняемого сообщения, мс от начала эпохи
+        @param chunkSize - максимальное количество удаляемых строк
+        @return текст запроса
+    */
+    QString makeDeleteOldQuery(const QString& driverName, qint64 lastLog, qint64 chunkSize) const;
+
+    /*!
+        Возвращает список названий столбцов таблицы для массовой загрузки в порядке полей файла
+        @return названия столбцов
+    */
+    QStringList columnNames() const;
+
+    /*!
+        Возвращает название столбца времени сообщения в таблице записи
+        @return название столбца
+    */
+    QString timeColumnName() const;
+
+    /*!
+        Возвращает название уникального возрастающего столбца строки таблицы записи, упорядочивающего сообщения
+            с одинаковым временем. В SQLite - rowid, в остальных БД - Id (IDENTITY/AUTO_INCREMENT). Таблица схемы
+            CLASSIC должна содержать такой столбец, таблица данных COMPACT создается с ним
+        @param driverName - название драйвера БД
+        @return название столбца
+    */
+    QString idColumnName(const QString& driverName) const;
+
+    /*!
+        Формирует значение времени для вставки в текст запроса в формате столбца времени (см. timeColumnName())
+        @param driverName - название драйвера БД
+        @param dateTime - время, мс от начала эпохи
+        @return значение
+    */
+    QString makeTimeLiteral(const QString& driverName, qint64 dateTime) const;
+
+    /*!
+        Возвращает идентификатор отправителя в словаре (только схема COMPACT, после prepare(...))
+        @return идентификатор. -1 - не получен
+    */
+    qint64 senderId() const noexcept { return _senderId; }
+
+public:
+    /*!
+        Заключает название объекта БД в кавычки, принятые для драйвера
+        @param driverName - название драйвера БД
+        @param name - название объекта
+        @return название в кавычках
+    */
+    static QString quoteName(const QString& driverName, const QString& name);
+
+    /*!
+        Создает таблицы схемы COMPACT, если их нет. Если возникнет ошибка - будет сгенерированно исключение SQLException
+        @param db - подключение к БД
+        @param logName - название таблицы лога
+    */
+    static void createCompact(QSqlDatabase& db, const QString& logName);
+
+    /*!
+        Переносит таблицу лога схемы CLASSIC в схему COMPACT: создает таблицы COMPACT, копирует в них отправителей
+            и сообщения, переименовывает исходную таблицу в [Log_Classic] и создает на ее месте представление [Log]
+            с прежними столбцами. Копирование выполняется одним запросом, поэтому миграцию больших таблиц следует
+            выполнять в период обслуживания при остановленных сервисах. Если возникнет ошибка - будет сгенерированно
+            исключение SQLException
+        @param db - подключение к БД
+        @param logName - название таблицы лога
+    */
+    static void migrateToCompact(QSqlDatabase& db, const QString& logName);
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBLogSchema() = delete;
+
+    /*!
+        Получает идентификатор отправителя из словаря, добавляя отправителя при необходимости. Если возникнет ошибка -
+            будет сгенерированно исключение SQLException
+        @param db - подключение к БД
+        @param sender - название сервиса отправителя логов
+        @return идентификатор
+    */
+    qint64 loadSenderId(QSqlDatabase& db, const QString& sender) const;
+
+    /*!
+        Привязывает к подготовленному однострочному запросу (см. makeInsertQuery(...)) значения сообщений столбцами для execBatch()
+        @param query - запрос
+        @param records - сообщения
+        @param sender - название сервиса отправителя логов
+    */
+    void bindRecords(QSqlQuery& query, const std::vector<LogRecord>& records, const QString& sender) const;
+
+    /*!
+        Привязывает к подготовленному многострочному запросу (см. makeInsertQuery(...)) значения сообщений построчно
+        @param query - запрос на count строк
+        @param records - сообщения
+        @param first - индекс первого сообщения
+        @param count - количество сообщений
+        @param sender - название сервиса отправителя логов
+    */
+    void bindRows(QSqlQuery& query, const std::vector<LogRecord>& records, qsizetype first, qsizetype count,
+                  const QString& sender) const;
+
+private:
+    Type _type = Type::CLASSIC;     ///< Схема хранения
+    QString _logName;               ///< Название таблицы лога
+    qint64 _senderId = -1;          ///< Идентификатор отправителя в словаре. -1 - не получен
+
+};
+
+} //namespace Common
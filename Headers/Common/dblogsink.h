@@ -0,0 +1,322 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QDeadlineTimer>
+#include <QtSql/QSqlDatabase>
+
+//My
+#include "Common/sql.h"
+#include "Common/logsink.h"
+#include "Common/dbflushcontroller.h"
+#include "Common/dblogspool.h"
+#include "Common/dbconnectionsupervisor.h"
+#include "Common/dbbulkloader.h"
+#include "Common/dblogretention.h"
+#include "Common/dblogschema.h"
+#include "Common/dbloglocalstore.h"
+#include "Common/dblogstats.h"
+#include "Common/dblogcollector.h"
+#include "Common/dbstatementcache.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogSink class - приемник сообщений лога, записывающий их в таблицу лога в БД (см. TDBLoger). Подключение
+///         к БД создается и используется только в потоке обработки приемника, сообщения записываются пачками
+///         (одна транзакция и один подготовленный запрос с пакетной привязкой параметров на пачку). Момент записи
+///         и размер пачки определяет DBFlushController. Пока БД недоступна, сообщения сохраняются в дисковую очередь
+///         DBLogSpool, которая после восстановления связи записывается в БД большими пачками. Если дисковую очередь
+///         открыть не удалось, не записанные в БД сообщения сохраняются в файл лога. Доступность БД отслеживает
+///         DBConnectionSupervisor: пока БД недоступна, приемник не обращается к ней и не ждет таймаутов подключения.
+///         Если поток сообщений превышает порог, пачки загружаются средствами массовой загрузки сервера (DBBulkLoader).
+///         Если включено локальное хранилище (DBLogLocalStore), пачки записываются в него, а в центральную БД сообщения
+///         пересылает его фоновый поток. Помимо общей очереди сообщения могут поступать через буферы потоков-отправителей
+///         (см. append(...), DBLogCollector), которые поток обработки забирает целиком при каждом пробуждении
+///
+class DBLogSink final
+    : public LogSink
+{
+public:
+    using ErrorHandler = std::function<void(const QString& errorString)>; ///< Обработчик ошибки записи в БД
+
+public:
+    /*!
+        Конструктор
+        @param connectionInfo - конфигурация подключения к БД
+        @param logDBName - название таблицы с логами. Используется также как название подключения к БД
+        @param sender - название сервиса отправителя логов
+    */
+    DBLogSink(const DBConnectionInfo& connectionInfo, const QString& logDBName, const QString& sender);
+
+    /*!
+        Деструктор. Записывает все оставшиеся в очереди сообщения и закрывает подключение к БД
+    */
+    ~DBLogSink() override;
+
+    /*!
+        Возвращает результат первого подключения к БД, которое выполняется в потоке обработки после start().
+            При ошибке приемник продолжает работу, подключение восстанавливается в фоне. Метод должен вызываться один раз до start()
+        @return пустая строка в случае успешного подключения, иначе - текст ошибки
+    */
+    std::future<QString> connectResult();
+
+    /*!
+        Устанавливает обработчик ошибки записи в БД. Обработчик вызывается в потоке обработки.
+            Метод должен вызываться до start()
+        @param handler - обработчик
+    */
+    void setErrorHandler(ErrorHandler&& handler);
+
+    /*!
+        Устанавливает политику записи пачек. Метод должен вызываться до start()
+        @param params - параметры политики записи
+    */
+    void setFlushParams(const DBFlushController::Params& params);
+
+    /*!
+        Устанавливает параметры дисковой очереди. Метод должен вызываться до start()
+        @param params - параметры дисковой очереди
+    */
+    void setSpoolParams(const DBLogSpool::Params& params);
+
+    /*!
+        Устанавливает параметры массовой загрузки. Метод должен вызываться до start()
+        @param params - параметры массовой загрузки
+    */
+    void setBulkParams(const DBBulkLoader::Params& params);
+
+    /*!
+        Устанавливает параметры удаления устаревших логов. Метод должен вызываться до start()
+        @param params - параметры удаления
+    */
+    void setRetentionParams(const DBLogRetention::Params& params);
+
+    /*!
+        Устанавливает схему хранения таблицы лога. Метод должен вызываться до start()
+        @param type - схема хранения
+    */
+    void setSchemaType(DBLogSchema::Type type);
+
+    /*!
+        Устанавливает параметры локального хранилища. Если оно включено, сообщения записываются в локальную БД SQLite
+            и пересылаются в центральную БД в фоне. Метод должен вызываться до start()
+        @param params - параметры локального хранилища
+    */
+    void setLocalStoreParams(const DBLogLocalStore::Params& params);
+
+    /*!
+        Помещает сообщение в буфер текущего потока. Буферы всех потоков забираются потоком обработки при каждом
+            пробуждении; поток обработки будится досрочно, когда в буфере набирается пачка. В отличие от post(...)
+            не выделяет память на каждое сообщение. Этот метод потокобезопасный
+        @param record - сообщение
+    */
+    void append(LogRecord&& record);
+
+    /*!
+        Устанавливает параметры статистики (интервал вывода отчета в лог). Метод должен вызываться до start()
+        @param params - параметры статистики
+    */
+    void setStatsParams(const DBLogStats::Params& params);
+
+    /*!
+        Возвращает снимок счетчиков работы приемника. Этот метод потокобезопасный и не использует блокировок
+        @return снимок счетчиков
+    */
+    DBLogStats::Snapshot stats() const noexcept;
+
+    /*!
+        Учитывает сообщение, обрезанное отправителем из-за превышения максимальной длины. Этот метод потокобезопасный
+    */
+    void addTruncated() noexcept;
+
+    /*!
+        Возвращает текущее состояние подключения к БД. Этот метод потокобезопасный
+        @return состояние подключения
+    */
+    DBConnectionSupervisor::State connectionState() const noexcept;
+
+    /*!
+        Возвращает текущее состояние политики записи. Этот метод потокобезопасный
+        @return состояние
+    */
+    DBFlushController::State flushState() const;
+
+    using LogSink::stop;
+
+    /*!
+        Останавливает поток обработки. Сообщения, оставшиеся в очереди после наступления крайнего срока, сохраняются
+            в дисковую очередь без записи в БД. Выполняемый в этот момент запрос к БД не прерывается
+        @param deadline - крайний срок записи сообщений в БД
+    */
+    void stop(const QDeadlineTimer& deadline);
+
+protected:
+    void started() override;
+    void stopped() override;
+    void writeRecord(const LogRecord& record) override;
+    void flushRecords() override;
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(DBLogSink);
+
+    /*!
+        Забирает сообщения из буферов потоков-отправителей и обрабатывает их
+    */
+    void collectRecords();
+
+    /*!
+        Записывает накопленную пачку сообщений в БД. Сообщения, которые не удалось записать, сохраняются в дисковую очередь
+    */
+    void writeBatch();
+
+    /*!
+        Сохраняет накопленную пачку сообщений в дисковую очередь без записи в БД
+    */
+    void spillBatch();
+
+    /*!
+        Сохраняет сообщение в дисковую очередь или, если она не открыта, в файл лога
+        @param record - сообщение
+    */
+    void spill(const LogRecord& record);
+
+    /*!
+        Проверяет превышение количества сообщений в памяти (очередь приемника и пачка) над
+            DBLogSpool::Params::maxMemoryQueueSize. При превышении пачка сохраняется в дисковую очередь. Признак
+            переполнения снимается, когда количество сообщений снижается до половины максимального. Проверка
+            выполняется только в потоке обработки, поэтому ограничение не жесткое: пока поток ждет записи пачки в БД,
+            очередь приемника и буферы потоков-отправителей продолжают расти
+        @return true - если очередь переполнена и новые сообщения нужно сохранять в дисковую очередь
+    */
+    bool checkMemoryQueue();
+
+    /*!
+        Записывает сообщения из дисковой очереди в БД. Время работы за один вызов ограничено, после ошибки
+            следующая попытка выполняется через интервал ожидания
+    */
+    void replaySpool();
+
+    /*!
+        Записывает сообщения в БД одной транзакцией. Большие пачки при высоком потоке сообщений записываются массовой
+            загрузкой. Если массовая загрузка не удалась, а обычная запись успешна - массовая загрузка отключается
+        @param records - сообщения
+        @param isHighVolume - true - сообщения поступают с высокой скоростью (поток выше порога или запись дисковой очереди)
+        @param errorString - сюда будет помещен текст ошибки
+        @return true - в случае успеха
+    */
+    bool insertRecords(const std::vector<LogRecord>& records, bool isHighVolume, QString& errorString);
+
+    /*!
+        Записывает сообщения в БД одной транзакцией подготовленным запросом с пакетной привязкой параметров.
+            Подключение должно быть открыто. При ошибке закрывает подключение и сообщает о ней наблюдателю
+        @param records - сообщения
+        @param errorString - сюда будет помещен текст ошибки
+        @return true - в случае успеха
+    */
+    bool executeInsert(const std::vector<LogRecord>& records, QString& errorString);
+
+    /*!
+        Записывает сообщения в БД одной транзакцией массовой загрузкой. Подключение должно быть открыто.
+            При ошибке подключение остается открытым
+        @param records - сообщения
+        @param errorString - сюда будет помещен текст ошибки
+        @return true - в случае успеха
+    */
+    bool executeBulkLoad(const std::vector<LogRecord>& records, QString& errorString);
+
+    /*!
+        Учитывает поступившие сообщения в оценке скорости потока сообщений
+        @param count - количество поступивших сообщений
+        @param now - текущее время (QDeadlineTimer::current().deadline())
+    */
+    void updateIncomingRate(qint64 count, qint64 now);
+
+    /*!
+        Выводит в лог отчет со статистикой, если истек интервал вывода
+        @param now - текущее время (QDeadlineTimer::current().deadline())
+    */
+    void reportStats(qint64 now);
+
+    /*!
+        Открывает подключение к БД, если оно закрыто и наблюдатель считает БД доступной. При ошибке сообщает
+            о ней наблюдателю
+        @param errorString - сюда будет помещен текст ошибки
+        @return true - если подключение открыто
+    */
+    bool ensureConnected(QString& errorString);
+
+    /*!
+        Отмечает БД как недоступную. Об ошибке сообщается только при переходе из доступного состояния
+        @param errorString - текст ошибки
+    */
+    void setDBUnavailable(const QString& errorString);
+
+    /*!
+        Возвращает true если наступил крайний срок записи сообщений в БД при остановке
+        @return true - если крайний срок наступил
+    */
+    bool isDrainExpired() const noexcept;
+
+    /*!
+        Сохраняет сообщение, не записанное в БД, в файл лога
+        @param record - сообщение
+    */
+    void saveToFile(const LogRecord& record);
+
+private:
+    const DBConnectionInfo _dbConnectionInfo;   ///< Параметры подключения к БД
+    const QString _logDBName;                   ///< Название таблицы лога
+    const QString _sender;                      ///< Название приложение отправителя логов
+
+    QSqlDatabase _db;                           ///< БД. Используется только в потоке обработки
+    std::unique_ptr<DBConnectionSupervisor> _supervisor; ///< Наблюдатель за доступностью БД
+    DBLogSchema _schema;                        ///< Схема хранения таблицы лога
+    std::unique_ptr<DBStatementCache> _statements; ///< Подготовленные запросы подключения. Существует пока открыто подключение
+
+    std::promise<QString> _connectPromise;      ///< Результат подключения к БД
+    ErrorHandler _errorHandler;                 ///< Обработчик ошибки записи в БД
+
+    std::atomic<qint64> _drainDeadline;         ///< Крайний срок записи сообщений в БД (QDeadlineTimer::deadline())
+
+    std::vector<LogRecord> _batch;              ///< Пачка сообщений для записи в БД
+    DBLogCollector _collector;                  ///< Буферы сообщений потоков-отправителей
+    std::vector<LogRecord> _collected;          ///< Сообщения, забранные из буферов потоков-отправителей
+    DBFlushController _flushController;         ///< Политика записи пачек
+
+    DBLogSpool::Params _spoolParams;            ///< Параметры дисковой очереди
+    std::unique_ptr<DBLogSpool> _spool;         ///< Дисковая очередь. nullptr - не открыта
+    bool _isDBAvailable = true;                 ///< Флаг доступности БД (последняя запись была успешной)
+    bool _isMemoryQueueFull = false;            ///< Флаг переполнения очереди в памяти (см. checkMemoryQueue())
+    qint64 _nextReplayTime = 0;                 ///< Время следующей попытки чтения дисковой очереди после ошибки (QDeadlineTimer::current().deadline())
+    qint64 _savedToFileCount = 0;               ///< Количество сообщений, сохраненных в файл вместо БД
+
+    DBBulkLoader::Params _bulkParams;           ///< Параметры массовой загрузки
+    std::unique_ptr<DBBulkLoader> _bulkLoader;  ///< Массовая загрузка. nullptr - не поддерживается драйвером или отключена
+    qint64 _incomingRate = 0;                   ///< Скорость потока сообщений за последний интервал измерения, сообщений/с
+    qint64 _rateWindowStart = 0;                ///< Начало интервала измерения скорости потока (QDeadlineTimer::current().deadline())
+    qint64 _rateWindowCount = 0;                ///< Количество сообщений, поступивших за интервал измерения
+
+    DBLogRetention::Params _retentionParams;    ///< Параметры удаления устаревших логов
+    std::unique_ptr<DBLogRetention> _retention; ///< Удаление устаревших логов. Существует пока работает поток обработки
+
+    DBLogLocalStore::Params _localStoreParams;  ///< Параметры локального хранилища
+    std::unique_ptr<DBLogLocalStore> _localStore; ///< Локальное хранилище. nullptr - сообщения записываются в центральную БД
+
+    DBLogStats _stats;                          ///< Счетчики работы приемника
+    DBLogStats::Params _statsParams;            ///< Параметры статистики
+    DBLogStats::Snapshot _lastReport;           ///< Снимок счетчиков на момент предыдущего отчета
+    qint64 _lastReportTime = 0;                 ///< Время предыдущего отчета (QDeadlineTimer::current().deadline())
+
+};
+
+} //namespace Common
@@ -0,0 +1,185 @@
+#pragma once
+
+//STL
+#include <deque>
+#include <memory>
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+
+//My
+#include "Common/logsink.h"
+
+namespace Common
+{
+
+static const QString DB_LOG_SPOOL_SEGMENT_SUFFIX(".seg");           ///< Расширение файлов сегментов дисковой очереди лога БД
+static const QString DB_LOG_SPOOL_POSITION_FILE("replay.pos");      ///< Файл позиции чтения дисковой очереди лога БД
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogSpool class - дисковая очередь сообщений лога, не записанных в БД (см. DBLogSink). Сообщения
+///         дописываются в конец файлов-сегментов [ИД].seg фиксированного максимального размера. Каждая запись имеет
+///         вид [размер данных:4][CRC32 данных:4][время:8][уровень:1][сообщение UTF-16LE], поэтому оборванная
+///         или поврежденная запись обнаруживается при чтении. Сообщения читаются с самого старого сегмента,
+///         позиция чтения сохраняется в файле replay.pos после подтверждения записи прочитанного в БД, поэтому
+///         очередь переживает перезапуск процесса. Полностью прочитанные сегменты удаляются. Класс не потокобезопасный
+///
+class DBLogSpool final
+{
+public:
+    /*!
+        Политика сброса данных очереди на диск (fsync)
+     */
+    enum class SyncPolicy: quint8
+    {
+        NONE = 0,       ///< Сброс выполняет ОС
+        SEGMENT = 1,    ///< При закрытии каждого сегмента
+        FLUSH = 2       ///< При каждом вызове flush()
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Параметры очереди
+    ///
+    struct Params
+    {
+        QString dirName;                                ///< Папка очереди. Пустая - [расположение exe файла]/Log/[название приложения].dbspool
+        SyncPolicy syncPolicy = SyncPolicy::SEGMENT;    ///< Политика сброса данных на диск
+        qint64 maxSegmentSize = 16 * 1024 * 1024;       ///< Максимальный размер сегмента, байт
+        qint64 maxSize = 1024 * 1024 * 1024;            ///< Максимальный размер очереди, байт. При превышении удаляются самые старые сегменты
+        qint64 maxMemoryQueueSize = 100000;             ///< Максимальное количество сообщений в памяти приемника (DBLogSink). При превышении
+                                                        ///< новые сообщения записываются в дисковую очередь, даже если БД доступна. 0 - не ограничено.
+                                                        ///< Ограничение не жесткое: отправители не блокируются и сообщения не отбрасываются,
+                                                        ///< поэтому пока поток приемника занят записью в БД, очередь может превысить этот размер
+    };
+
+public:
+    /*!
+        Конструктор
+        @param params - параметры очереди
+    */
+    explicit DBLogSpool(const Params& params);
+
+    /*!
+        Деструктор. Записывает буфер и закрывает файлы
+    */
+    ~DBLogSpool();
+
+    /*!
+        Открывает очередь: создает папку и находит сегменты, оставшиеся от предыдущих запусков
+        @return true - в случае успеха. В случае ошибки см. errorString()
+    */
+    bool open();
+
+    /*!
+        Возвращает true если в очереди нет непрочитанных сообщений (с учетом буфера)
+        @return true - если очередь пуста
+    */
+    bool isEmpty() const noexcept;
+
+    /*!
+        Возвращает объем очереди на диске
+        @return объем, байт
+    */
+    qint64 size() const noexcept { return _size; }
+
+    /*!
+        Добавляет сообщение в буфер очереди. Буфер записывается в файл при вызове flush() или при его переполнении
+        @param record - сообщение
+        @return true - в случае успеха. В случае ошибки см. errorString()
+    */
+    bool append(const LogRecord& record);
+
+    /*!
+        Записывает буфер в текущий сегмент и, если задано политикой, сбрасывает его на диск
+        @return true - в случае успеха. В случае ошибки см. errorString()
+    */
+    bool flush();
+
+    /*!
+        Читает сообщения с позиции чтения. Позиция сохраняется только после вызова commitRead()
+        @param records - сюда будут добавлены прочитанные сообщения
+        @param maxCount - максимальное количество сообщений
+        @return true - если прочитано хотя бы одно сообщение
+    */
+    bool read(std::vector<LogRecord>& records, qsizetype maxCount);
+
+    /*!
+        Подтверждает обработку сообщений, прочитанных последним вызовом read(...): сохраняет позицию чтения
+            и удаляет полностью прочитанные сегменты
+    */
+    void commitRead();
+
+    /*!
+        Возвращает true если при выполнении последнего действия произошла ошибка
+        @return true - если есть ошибка
+     */
+    bool isError() const noexcept;
+
+    /*!
+        Возвращает тектовое описание ошибки и сбразывает ее
+        @return - текст ошибки
+    */
+    [[nodiscard]] QString errorString();
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBLogSpool() = delete;
+    Q_DISABLE_COPY_MOVE(DBLogSpool);
+
+    /*!
+        Возвращает имя файла сегмента
+        @param id - ИД сегмента
+        @return имя файла
+    */
+    QString segmentFileName(quint64 id) const;
+
+    /*!
+        Открывает новый сегмент для записи
+        @return true - в случае успеха
+    */
+    bool openWriteSegment();
+
+    /*!
+        Закрывает сегмент, открытый для записи
+    */
+    void closeWriteSegment();
+
+    /*!
+        Возвращает true если самый старый сегмент открыт для записи (в очереди один сегмент)
+        @return true - если читается сегмент, открытый для записи
+    */
+    bool isReadingWriteSegment() const noexcept;
+
+    /*!
+        Удаляет самый старый сегмент
+    */
+    void removeFirstSegment();
+
+    /*!
+        Сохраняет позицию чтения в файл
+    */
+    void savePosition();
+
+private:
+    const Params _params;                   ///< Параметры очереди
+    QString _dirName;                       ///< Папка очереди
+
+    std::deque<quint64> _segments;          ///< ИД сегментов, от старых к новым
+    qint64 _size = 0;                       ///< Объем очереди на диске
+
+    std::unique_ptr<QFile> _writeFile;      ///< Сегмент, открытый для записи (всегда последний в _segments)
+    qint64 _writeOffset = 0;                ///< Размер сегмента, открытого для записи
+    QByteArray _writeBuffer;                ///< Буфер записи
+
+    std::unique_ptr<QFile> _readFile;       ///< Сегмент, открытый для чтения (всегда первый в _segments)
+    qint64 _readOffset = 0;                 ///< Подтвержденная позиция чтения
+    qint64 _pendingReadOffset = 0;          ///< Позиция после последнего чтения
+
+    QString _errorString;                   ///< Текст последней ошибки
+
+};
+
+} //namespace Common
@@ -0,0 +1,190 @@
+#pragma once
+
+//STL
+#include <array>
+#include <atomic>
+
+//Qt
+#include <QString>
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogLatencyHistogram class - гистограмма длительностей с логарифмическими корзинами (корзина i содержит
+///         значения от 2^(i-1) до 2^i мкс). Добавление значения не использует блокировок и может выполняться из любого
+///         потока. Снимок не атомарен в целом: счетчики корзин считываются по отдельности, поэтому при одновременной
+///         записи сумма корзин может немного отличаться от количества значений
+///
+class DBLogLatencyHistogram final
+{
+public:
+    static constexpr qsizetype BUCKET_COUNT = 32;   ///< Количество корзин. Последняя корзина содержит все значения от 2^30 мкс
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Снимок гистограммы
+    ///
+    struct Snapshot
+    {
+        qint64 count = 0;                               ///< Количество значений
+        qint64 sum = 0;                                 ///< Сумма значений, мкс
+        qint64 max = 0;                                 ///< Максимальное значение, мкс
+        std::array<qint64, BUCKET_COUNT> buckets = {};  ///< Количество значений в корзинах
+
+        /*!
+            Возвращает среднее значение
+            @return среднее значение, мкс. 0 - если значений нет
+        */
+        qint64 average() const noexcept;
+
+        /*!
+            Возвращает оценку процентиля: верхнюю границу корзины, в которую попадает процентиль, но не больше максимума
+            @param percent - процентиль (0..100)
+            @return значение процентиля, мкс. 0 - если значений нет
+        */
+        qint64 percentile(double percent) const noexcept;
+    };
+
+public:
+    /*!
+        Конструктор
+    */
+    DBLogLatencyHistogram() = default;
+
+    /*!
+        Добавляет значение. Этот метод потокобезопасный и не использует блокировок
+        @param usec - длительность, мкс
+    */
+    void add(qint64 usec) noexcept;
+
+    /*!
+        Возвращает снимок гистограммы. Этот метод потокобезопасный
+        @return снимок
+    */
+    Snapshot snapshot() const noexcept;
+
+private:
+    Q_DISABLE_COPY_MOVE(DBLogLatencyHistogram);
+
+private:
+    std::array<std::atomic<qint64>, BUCKET_COUNT> _buckets = {}; ///< Количество значений в корзинах
+    std::atomic<qint64> _count = 0;                 ///< Количество значений
+    std::atomic<qint64> _sum = 0;                   ///< Сумма значений, мкс
+    std::atomic<qint64> _max = 0;                   ///< Максимальное значение, мкс
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogStats class - счетчики работы логера БД (см. TDBLoger, DBLogSink). Счетчики увеличиваются без блокировок
+///         в потоках отправителей и в потоке записи, снимок может быть получен из любого потока. Все счетчики
+///         накопительные с момента запуска логера: скорость вычисляется по разности двух снимков
+///
+class DBLogStats final
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Параметры статистики
+    ///
+    struct Params
+    {
+        qint64 reportInterval = 60 * 1000;  ///< 1 мин. Интервал вывода статистики в лог, мс. 0 - не выводить
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Снимок счетчиков
+    ///
+    struct Snapshot
+    {
+        qint64 queueSize = 0;           ///< Количество сообщений в очереди потока записи
+        qint64 incomingRate = 0;        ///< Скорость потока сообщений за последний интервал измерения, сообщений/с
+        qint64 receivedCount = 0;       ///< Количество сообщений, полученных потоком записи
+        qint64 writtenCount = 0;        ///< Количество сообщений, записанных в БД (или в локальное хранилище)
+        qint64 flushCount = 0;          ///< Количество успешных транзакций записи
+        qint64 failedFlushCount = 0;    ///< Количество неудачных транзакций записи
+        qint64 spilledCount = 0;        ///< Количество сообщений, сохраненных в дисковую очередь
+        qint64 savedToFileCount = 0;    ///< Количество сообщений, сохраненных в файл лога вместо БД
+        qint64 truncatedCount = 0;      ///< Количество сообщений, обрезанных из-за превышения максимальной длины
+        DBLogLatencyHistogram::Snapshot commitLatency; ///< Длительность успешных транзакций записи
+    };
+
+public:
+    /*!
+        Конструктор
+    */
+    DBLogStats() = default;
+
+    /*!
+        Учитывает сообщения, полученные потоком записи
+        @param count - количество сообщений
+    */
+    void addReceived(qint64 count) noexcept;
+
+    /*!
+        Учитывает успешную транзакцию записи
+        @param count - количество записанных сообщений
+        @param usec - длительность транзакции, мкс
+    */
+    void addFlush(qint64 count, qint64 usec) noexcept;
+
+    /*!
+        Учитывает неудачную транзакцию записи
+    */
+    void addFailedFlush() noexcept;
+
+    /*!
+        Учитывает сообщения, сохраненные в дисковую очередь
+        @param count - количество сообщений
+    */
+    void addSpilled(qint64 count) noexcept;
+
+    /*!
+        Учитывает сообщения, сохраненные в файл лога вместо БД
+        @param count - количество сообщений
+    */
+    void addSavedToFile(qint64 count) noexcept;
+
+    /*!
+        Учитывает сообщение, обрезанное из-за превышения максимальной длины
+    */
+    void addTruncated() noexcept;
+
+    /*!
+        Сохраняет текущую скорость потока сообщений
+        @param rate - скорость, сообщений/с
+    */
+    void setIncomingRate(qint64 rate) noexcept;
+
+    /*!
+        Возвращает снимок счетчиков. Этот метод потокобезопасный
+        @param queueSize - текущее количество сообщений в очереди потока записи
+        @return снимок
+    */
+    Snapshot snapshot(qint64 queueSize) const noexcept;
+
+    /*!
+        Формирует строку отчета для вывода в лог
+        @param current - текущий снимок
+        @param previous - снимок на момент предыдущего отчета. Используется для вычисления скорости записи
+        @param interval - время между снимками, мс
+        @return строка отчета
+    */
+    static QString makeReport(const Snapshot& current, const Snapshot& previous, qint64 interval);
+
+private:
+    Q_DISABLE_COPY_MOVE(DBLogStats);
+
+private:
+    std::atomic<qint64> _incomingRate = 0;      ///< Скорость потока сообщений, сообщений/с
+    std::atomic<qint64> _receivedCount = 0;     ///< Количество сообщений, полученных потоком записи
+    std::atomic<qint64> _writtenCount = 0;      ///< Количество записанных сообщений
+    std::atomic<qint64> _flushCount = 0;        ///< Количество успешных транзакций записи
+    std::atomic<qint64> _failedFlushCount = 0;  ///< Количество неудачных транзакций записи
+    std::atomic<qint64> _spilledCount = 0;      ///< Количество сообщений, сохраненных в дисковую очередь
+    std::atomic<qint64> _savedToFileCount = 0;  ///< Количество сообщений, сохраненных в файл лога
+    std::atomic<qint64> _truncatedCount = 0;    ///< Количество обрезанных сообщений
+
+    DBLogLatencyHistogram _commitLatency;       ///< Длительность успешных транзакций записи
+
+};
+
+} //namespace Common
@@ -0,0 +1,113 @@
+#pragma once
+
+//STL
+#include <list>
+
+//Qt
+#include <QString>
+#include <QHash>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+//My
+#include "Common/sql.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBStatementCache class - кеш подготовленных запросов одного подключения к БД. Запрос с параметрами
+///         подготавливается (разбирается сервером) при первом использовании и затем выполняется повторно с новыми
+///         значениями параметров. При превышении емкости удаляется запрос, который дольше всех не использовался.
+///         Подготовленные запросы привязаны к подключению: кеш должен быть очищен (clear()) или удален до закрытия
+///         подключения и использоваться только в потоке подключения
+///
+class DBStatementCache final
+{
+public:
+    /*!
+        Конструктор
+        @param db - подключение к БД. Должно существовать все время жизни кеша
+        @param capacity - максимальное количество подготовленных запросов
+    */
+    explicit DBStatementCache(QSqlDatabase& db, qsizetype capacity = 32);
+
+    /*!
+        Деструктор. Освобождает подготовленные запросы
+    */
+    ~DBStatementCache();
+
+    /*!
+        Возвращает подготовленный запрос. Если запроса нет в кеше - подготавливает его. Если возникнет ошибка -
+            будет сгенерированно исключение SQLException
+        @param queryText - текст запроса с параметрами ('?' или ':name')
+        @return подготовленный запрос. Ссылка действительна до следующего вызова prepare(...) или clear()
+    */
+    QSqlQuery& prepare(const QString& queryText);
+
+    /*!
+        Выполняет запрос из кеша со значениями позиционных параметров ('?'). Если возникнет ошибка - будет
+            сгенерированно исключение SQLException
+        @param queryText - текст запроса с параметрами '?'
+        @param args - значения параметров в порядке их следования в запросе
+        @return выполненный запрос (для чтения результата SELECT). Ссылка действительна до следующего вызова
+            prepare(...) или clear()
+    */
+    template <typename... Args>
+    QSqlQuery& execute(const QString& queryText, const Args&... args)
+    {
+        auto& query = prepare(queryText);
+
+        DBQueryBindValues(query, args...);
+        DBQueryExecutePrepared(_db, query);
+
+        return query;
+    }
+
+    /*!
+        Освобождает все подготовленные запросы. Должен вызываться до закрытия подключения
+    */
+    void clear();
+
+    /*!
+        Возвращает количество запросов, найденных в кеше
+        @return количество попаданий
+    */
+    qint64 hitCount() const noexcept { return _hitCount; }
+
+    /*!
+        Возвращает количество запросов, подготовленных заново
+        @return количество промахов
+    */
+    qint64 missCount() const noexcept { return _missCount; }
+
+private:
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Подготовленный запрос
+    ///
+    struct Statement
+    {
+        QString queryText;  ///< Текст запроса
+        QSqlQuery query;    ///< Подготовленный запрос
+    };
+
+    using Statements = std::list<Statement>; ///< Запросы в порядке использования: последний использованный - первый
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBStatementCache() = delete;
+    Q_DISABLE_COPY_MOVE(DBStatementCache);
+
+private:
+    QSqlDatabase& _db;                                  ///< Подключение к БД
+    const qsizetype _capacity = 32;                     ///< Максимальное количество подготовленных запросов
+
+    Statements _statements;                             ///< Подготовленные запросы
+    QHash<QString, Statements::iterator> _index;        ///< Подготовленные запросы по тексту запроса
+
+    qint64 _hitCount = 0;                               ///< Количество попаданий
+    qint64 _missCount = 0;                              ///< Количество промахов
+
+};
+
+} //namespace Common
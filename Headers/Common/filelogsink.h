@@ -0,0 +1,132 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+
+//My
+#include "Common/common.h"
+#include "Common/logsink.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The FileLogSink class - приемник сообщений лога, записывающий их в файл [расположение exe файла]/Log/[название приложения].log
+///         (или .blog в двоичном формате). Файл остается открытым все время работы, сообщения записываются пачками
+///         (одна операция записи на пачку). При превышении максимального размера файл ротируется, сжатие
+///         ротированных файлов и удаление устаревших выполняется в LogMaintenance. Рядом с файлом ведется
+///         разреженный индекс времени сообщений (см. LogIndexRecordType), позволяющий LogFileReader
+///         читать интервал времени без просмотра всего файла
+///
+class FileLogSink final
+    : public LogSink
+{
+public:
+    /*!
+        Конструктор
+    */
+    FileLogSink();
+
+    /*!
+        Деструктор. Записывает все оставшиеся в очереди сообщения и закрывает файл
+    */
+    ~FileLogSink() override;
+
+    /*!
+        Устанавливает формат файла лога. Если формат изменился - текущий файл закрывается и открывается
+            файл с именем, соответствующим формату. Этот метод потокобезопасный
+        @param format - формат файла лога
+    */
+    void setFileFormat(LogFileFormat format);
+
+protected:
+    void stopped() override;
+    void writeRecord(const LogRecord& record) override;
+    void flushRecords() override;
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(FileLogSink);
+
+    /*!
+        Добавляет сообщение в пачку для записи в файл в текстовом формате
+        @param record - сообщение
+    */
+    void appendTextRecord(const LogRecord& record);
+
+    /*!
+        Добавляет сообщение в пачку для записи в файл в двоичном формате. Префикс сообщения заменяется на его ИД,
+            при первом использовании префикса в пачку добавляется его определение
+        @param record - сообщение
+    */
+    void appendBinaryRecord(const LogRecord& record);
+
+    /*!
+        Записывает накопленную пачку сообщений в файл лога
+    */
+    void writeFileBuffer();
+
+    /*!
+        Записывает в индекс записи для пачки сообщений, записанной в файл лога с позиции position
+        @param position - позиция начала пачки в файле лога или -1 если пачку записать не удалось
+    */
+    void writeIndex(qint64 position);
+
+    /*!
+        Закрывает файл лога и его индекс
+    */
+    void closeFile();
+
+    /*!
+        Открывает файл лога, если он еще не открыт. Если размер файла вместе с пачкой сообщений превысит
+            максимальный - файл ротируется
+        @param batchSize - размер записываемой пачки сообщений
+        @return пустая строка в случае успеха или описание ошибки
+    */
+    QString prepareFile(qsizetype batchSize);
+
+    /*!
+        Открывает новый файл лога и его индекс
+        @return пустая строка в случае успеха или описание ошибки
+    */
+    QString openFile();
+
+    /*!
+        Ротирует файл лога: закрывает текущий файл, переименовывает его (и его индекс) в [название приложения].log_yyyy_MM_dd_hh_mm_ss_zzz
+            (если имя занято - с добавлением номера) и открывает новый. Сжатие ротированного файла и удаление устаревших
+            файлов передается в LogMaintenance. Если переименовать файл не удалось - запись продолжается в текущий файл,
+            а следующая попытка ротации выполняется не ранее чем через ROTATE_RETRY_INTERVAL
+        @return пустая строка в случае успеха или описание ошибки
+    */
+    QString rotateFile();
+
+private:
+    std::atomic<LogFileFormat> _format = LogFileFormat::TEXT; ///< Требуемый формат файла лога
+
+    //Данные потока обработки
+    std::unique_ptr<QFile> _file;                   ///< Файл лога
+    QString _fileName;                              ///< Полное имя файла лога
+    qint64 _fileSize = 0;                           ///< Текущий размер файла лога. Учитывается в памяти без обращения к ФС
+    qint64 _rotateRetryTime = 0;                    ///< Время, до которого ротация не выполняется после неудачной попытки (QDeadlineTimer::current().deadline())
+    LogFileFormat _fileFormat = LogFileFormat::TEXT;///< Формат текущего файла лога
+    QHash<QString, quint32> _prefixIds;             ///< Префиксы сообщений, уже определенные в двоичном файле. Ключ - префикс, значение - ИД
+    QByteArray _fileBuffer;                         ///< Пачка сообщений для записи в файл
+
+    std::unique_ptr<QFile> _indexFile;              ///< Индекс файла лога. nullptr - индекс не ведется (ошибка открытия или записи)
+    QByteArray _indexBuffer;                        ///< Записи для индекса
+    std::vector<std::pair<qsizetype, qint64>> _indexCandidates; ///< Возможные записи индекса для пачки: смещение сообщения в пачке, время сообщения
+    qint64 _lastIndexPosition = -1;                 ///< Позиция в файле лога последней записи индекса. -1 - индекс текущего файла пуст
+    qint64 _nextIndexPosition = 0;                  ///< Предполагаемая позиция в файле лога следующей записи индекса
+
+};
+
+} //namespace Common
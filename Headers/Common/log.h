@@ -0,0 +1,189 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <utility>
+
+//Qt
+#include <QString>
+
+//My
+#include "Common/common.h"
+
+///////////////////////////////////////////////////////////////////////////////
+///     Минимальный уровень сообщений (значение LogLevel), включаемых в сборку. Сообщения ниже этого уровня,
+///         переданные через logMessage<...>(...) или макросы LOG_XXX(...), удаляются компилятором вместе с вычислением
+///         аргументов. По умолчанию в DEBUG сборке включаются все сообщения, в RELEASE - начиная с LogLevel::INF.
+///         Может быть переопределен при сборке, например DEFINES += COMMON_LOG_MIN_LEVEL=2
+///
+#ifndef COMMON_LOG_MIN_LEVEL
+#ifdef QT_DEBUG
+#define COMMON_LOG_MIN_LEVEL 0
+#else
+#define COMMON_LOG_MIN_LEVEL 1
+#endif
+#endif
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     Уровень сообщения лога. Значения совпадают с TDBLoger::MSG_CODE
+///
+enum class LogLevel: quint8
+{
+    DBG = 0,        ///< Отладочное сообщение
+    INF = 1,        ///< Информационное сообщение
+    WAR = 2,        ///< Предупреждение
+    CRY = 3,        ///< Критическая ошибка
+    FAT = 4,        ///< Фатальная ошибка
+    UND = 0xFF      ///< Уровень не определен (например, сообщения writeLogFile(...)). Такие сообщения не фильтруются по уровню
+};
+
+/*!
+    Минимальный уровень сообщений, выводимых во время работы. Проверяется одной неупорядоченной атомарной загрузкой
+        до формирования текста сообщения. Изменяется через setLogLevel(...)
+*/
+inline std::atomic<LogLevel> RUNTIME_LOG_LEVEL = LogLevel::DBG;
+
+/*!
+    Проверяет включены ли сообщения уровня level в сборку (см. COMMON_LOG_MIN_LEVEL)
+    @return true - если сообщения включены в сборку
+*/
+template <LogLevel level>
+constexpr bool isLogLevelCompiled() noexcept
+{
+    return level == LogLevel::UND || static_cast<quint8>(level) >= COMMON_LOG_MIN_LEVEL;
+}
+
+/*!
+    Проверяет нужно ли выводить сообщения уровня level. Для уровней, не включенных в сборку, всегда возвращает false
+        без обращения к памяти. Эта функция потокобезопасна
+    @return true - если сообщения нужно выводить
+*/
+template <LogLevel level>
+inline bool isLogLevelEnabled() noexcept
+{
+    if constexpr (!isLogLevelCompiled<level>())
+    {
+        return false;
+    }
+    else
+    {
+        return level == LogLevel::UND
+            || static_cast<quint8>(level) >= static_cast<quint8>(RUNTIME_LOG_LEVEL.load(std::memory_order_relaxed));
+    }
+}
+
+/*!
+    Устанавливает минимальный уровень сообщений, выводимых во время работы. Уровни, не включенные в сборку,
+        не выводятся независимо от этой настройки. Эта функция потокобезопасна
+    @param level - минимальный уровень
+*/
+inline void setLogLevel(LogLevel level) noexcept
+{
+    RUNTIME_LOG_LEVEL.store(level, std::memory_order_relaxed);
+}
+
+/*!
+    Возвращает минимальный уровень сообщений, выводимых во время работы
+    @return минимальный уровень
+*/
+inline LogLevel logLevel() noexcept
+{
+    return RUNTIME_LOG_LEVEL.load(std::memory_order_relaxed);
+}
+
+/*!
+    Преобразует уровень сообщения в тип сообщения Qt
+    @param level - уровень сообщения
+    @return тип сообщения Qt
+*/
+constexpr QtMsgType logLevelToQtMsgType(LogLevel level) noexcept
+{
+    switch (level)
+    {
+    case LogLevel::DBG: return QtDebugMsg;
+    case LogLevel::INF: return QtInfoMsg;
+    case LogLevel::WAR: return QtWarningMsg;
+    case LogLevel::CRY: return QtCriticalMsg;
+    case LogLevel::FAT: return QtFatalMsg;
+    default: break;
+    }
+
+    return QtCriticalMsg;
+}
+
+/*!
+    Формирует текст сообщения, последовательно подставляя аргументы в format через QString::arg(...)
+    @param format - шаблон сообщения ("%1 %2 ...")
+    @param args - аргументы
+    @return текст сообщения
+*/
+template <typename... Args>
+QString formatLogMessage(const QString& format, Args&&... args)
+{
+    QString result(format);
+    ((result = result.arg(std::forward<Args>(args))), ...);
+
+    return result;
+}
+
+/*!
+    Передает сообщение уровня level в конвейер логирования (см. writeLogMessage(...)). Если уровень не включен
+        в сборку - вызов удаляется компилятором, если уровень отключен во время работы - текст сообщения не формируется.
+        Аргументы вычисляются в месте вызова, для исключения и их вычисления используйте макросы LOG_XXX(...).
+        Эта функция потокобезопасна
+    @param format - шаблон сообщения ("%1 %2 ...")
+    @param args - аргументы
+*/
+template <LogLevel level, typename... Args>
+inline void logMessage(const QString& format, Args&&... args)
+{
+    if constexpr (isLogLevelCompiled<level>())
+    {
+        if (isLogLevelEnabled<level>())
+        {
+            writeLogMessage(logLevelToQtMsgType(level), formatLogMessage(format, std::forward<Args>(args)...));
+        }
+    }
+}
+
+} //namespace Common
+
+///////////////////////////////////////////////////////////////////////////////
+///     Макросы логирования. Аргументы вычисляются только если уровень включен в сборку и во время работы.
+///         Пример: LOG_DBG("Received %1 bytes from %2", data.size(), url.toString());
+///
+#define COMMON_LOG_AT_LEVEL(level, ...) \
+    do \
+    { \
+        if constexpr (Common::isLogLevelCompiled<level>()) \
+        { \
+            if (Common::isLogLevelEnabled<level>()) \
+            { \
+                Common::writeLogMessage(Common::logLevelToQtMsgType(level), Common::formatLogMessage(__VA_ARGS__)); \
+            } \
+        } \
+    } while (false)
+
+#define LOG_DBG(...) COMMON_LOG_AT_LEVEL(Common::LogLevel::DBG, __VA_ARGS__)   ///< Отладочное сообщение
+#define LOG_INF(...) COMMON_LOG_AT_LEVEL(Common::LogLevel::INF, __VA_ARGS__)   ///< Информационное сообщение
+#define LOG_WAR(...) COMMON_LOG_AT_LEVEL(Common::LogLevel::WAR, __VA_ARGS__)   ///< Предупреждение
+#define LOG_CRY(...) COMMON_LOG_AT_LEVEL(Common::LogLevel::CRY, __VA_ARGS__)   ///< Критическая ошибка
+
+///////////////////////////////////////////////////////////////////////////////
+///     Отладочная запись в файл лога (см. writeLogFile(...)). Удаляется компилятором вместе с вычислением аргументов,
+///         если отладочные сообщения не включены в сборку
+///
+#define LOG_DBG_FILE(prefix, msg) \
+    do \
+    { \
+        if constexpr (Common::isLogLevelCompiled<Common::LogLevel::DBG>()) \
+        { \
+            if (Common::isLogLevelEnabled<Common::LogLevel::DBG>()) \
+            { \
+                Common::writeLogFile((prefix), (msg)); \
+            } \
+        } \
+    } while (false)
@@ -0,0 +1,100 @@
+#pragma once
+
+//STL
+#include <atomic>
+
+//Qt
+#include <QString>
+
+//My
+#include "Common/log.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LogCrashBuffer class - кольцевой буфер последних сообщений лога в памяти процесса. Запись сообщения
+///         не использует блокировок и выделения памяти (только копирование текста в ячейку фиксированного размера).
+///         При аварийном завершении процесса (SIGSEGV, SIGABRT и т.п.) обработчик сигнала сохраняет содержимое
+///         буфера в файл [расположение exe файла]/Log/[название приложения].crash, используя только
+///         async-signal-safe функции. Предполагается что это глобальный синглтон класс
+///
+class LogCrashBuffer final
+{
+public:
+    static constexpr qsizetype SLOT_COUNT = 1024;   ///< Количество сообщений в буфере. Должно быть степенью 2
+    static constexpr qsizetype TEXT_SIZE = 256;     ///< Максимальная длина текста сообщения (префикс и сообщение), символов. Более длинный текст обрезается
+
+public:
+    /*!
+        Возвращает указатель на глобальный буфер. Буфер размещается в статической памяти и доступен все время работы процесса,
+            в т.ч. в обработчике сигнала
+        @return указатель на буфер. Гарантированно не nullptr
+    */
+    static LogCrashBuffer* instance() noexcept;
+
+    /*!
+        Устанавливает обработчики сигналов аварийного завершения процесса (SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL).
+            Обработчик сохраняет содержимое буфера в файл и завершает процесс стандартным для сигнала образом.
+            Должна вызываться из основного потока при старте программы. Альтернативный стек, на котором обработчик
+            выполняется при переполнении стека, устанавливается только для вызывающего потока (см. installThreadStack())
+        @param fileName - имя файла для сохранения буфера. Если пустое - [расположение exe файла]/Log/[название приложения].crash
+        @return true - в случае успеха
+    */
+    static bool installSignalHandlers(const QString& fileName = QString());
+
+    /*!
+        Устанавливает альтернативный стек обработчика сигналов для текущего потока (sigaltstack действует на один поток).
+            Без него переполнение стека потока завершает процесс без сохранения буфера. Потоки библиотеки (LogSink,
+            LogMaintenance, DBLogRetention, DBLogLocalStore, DBConnectionSupervisor) вызывают его при старте, прочие
+            потоки программы должны вызвать его сами. Стек освобождается при завершении потока. В Windows не используется
+        @return true - в случае успеха или если стек уже установлен
+    */
+    static bool installThreadStack() noexcept;
+
+public:
+    /*!
+        Конструктор. Предполагается создание экзепляра класса только через instance()
+    */
+    LogCrashBuffer() = default;
+
+    /*!
+        Сохраняет сообщение в буфер, вытесняя самое старое. Этот метод потокобезопасный и не использует блокировок
+        @param dateTime - время сообщения (мс от начала эпохи)
+        @param level - уровень сообщения
+        @param prefix - префикс сообщения
+        @param msg - сообщение
+    */
+    void record(qint64 dateTime, LogLevel level, const QString& prefix, const QString& msg) noexcept;
+
+    /*!
+        Записывает содержимое буфера в файловый дескриптор в текстовом виде, от старых сообщений к новым.
+            Использует только async-signal-safe функции и может вызываться из обработчика сигнала. Сообщения,
+            изменяемые в момент записи, пропускаются
+        @param fd - файловый дескриптор
+    */
+    void dump(int fd) const noexcept;
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(LogCrashBuffer);
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Ячейка буфера
+    ///
+    struct Slot
+    {
+        std::atomic<quint64> sequence = 0;      ///< Номер записи. 0 - ячейка пуста, нечетный - ячейка записывается, 2 * pos + 2 - записано сообщение pos
+        qint64 dateTime = 0;                    ///< Время сообщения (мс от начала эпохи)
+        LogLevel level = LogLevel::UND;         ///< Уровень сообщения
+        quint16 textSize = 0;                   ///< Длина текста, символов
+        char16_t text[TEXT_SIZE] = {};          ///< Текст "[prefix] [msg]" в UTF-16
+    };
+
+private:
+    std::atomic<quint64> _head = 0; ///< Номер следующей записи
+    Slot _slots[SLOT_COUNT];        ///< Ячейки буфера
+
+};
+
+} //namespace Common
@@ -0,0 +1,250 @@
+#pragma once
+
+//STL
+#include <stdexcept>
+
+//Qt
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+
+namespace Common
+{
+
+static const QString LOG_ARCHIVE_SUFFIX(".qz");       ///< Расширение сжатых файлов лога
+static const QByteArray LOG_BINARY_MAGIC("CLB2");     ///< Сигнатура двоичного файла лога (LogFileFormat::BINARY)
+static const QString LOG_INDEX_SUFFIX(".idx");        ///< Расширение файлов индекса лога
+static const QByteArray LOG_INDEX_MAGIC("CLI1");      ///< Сигнатура файла индекса лога
+static const qint64 LOG_INDEX_INTERVAL = 64 * 1024;   ///< 64KB минимальное расстояние между записями индекса в файле лога
+
+///////////////////////////////////////////////////////////////////////////////
+///     Тип записи двоичного файла лога. Все числа записываются в порядке little-endian, тексты - в UTF-8.
+///         Файл начинается с сигнатуры LOG_BINARY_MAGIC, далее следуют записи:
+///         PREFIX:  [тип:1][ИД префикса:4][размер текста в байтах:4][текст префикса]
+///         MESSAGE: [тип:1][время, мс от начала эпохи:8][уровень (LogLevel):1][ИД префикса:4][размер текста в байтах:4][текст сообщения]
+///         Текст сообщения хранится отформатированным: отложенное форматирование не выполняется (см. setLogFileFormat(...)).
+///         Определение префикса всегда предшествует первому сообщению с этим префиксом в файле
+///
+enum class LogBinaryRecordType: quint8
+{
+    PREFIX = 1,     ///< Определение префикса
+    MESSAGE = 2     ///< Сообщение
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     Тип записи файла индекса лога [имя файла лога без LOG_ARCHIVE_SUFFIX]LOG_INDEX_SUFFIX. Индекс разреженный:
+///         одна запись на каждые LOG_INDEX_INTERVAL байт файла лога. Все числа записываются в порядке little-endian.
+///         Файл начинается с сигнатуры LOG_INDEX_MAGIC, далее следуют записи:
+///         ENTRY:  [тип:1][время сообщения, мс от начала эпохи:8][смещение начала сообщения в несжатом файле лога:8]
+///         PREFIX: [тип:1][ИД префикса:4][размер текста в байтах:4][текст префикса] - только для двоичных файлов, копия
+///                 определения префикса из файла лога, чтобы чтение можно было начать с любой записи ENTRY
+///
+enum class LogIndexRecordType: quint8
+{
+    ENTRY = 1,      ///< Время и смещение сообщения
+    PREFIX = 2      ///< Определение префикса
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     Вспомогательный класс ошибки сжатия/чтения файлов лога
+///
+class LogFileException final
+    : public std::runtime_error
+{
+public:
+    /*!
+        Конструтор. Планируется использовать только этот конструтор
+        @param what - описание ошибки
+    */
+    explicit LogFileException(const QString& what)
+        : std::runtime_error(what.toStdString())
+    {
+    }
+
+    ~LogFileException() override = default;
+
+private:
+    // Удаляем неиспользуемые конструторы
+    LogFileException() = delete;
+    Q_DISABLE_COPY_MOVE(LogFileException);
+
+};
+
+/*!
+    Сжимает файл лога. Файл читается и сжимается блоками, поэтому целиком в память не загружается. Сжатый файл
+        [fileName]LOG_ARCHIVE_SUFFIX записывается атомарно, после чего исходный файл удаляется. В случае ошибки
+        будет сгенерировано исключение LogFileException, исходный файл при этом не изменяется
+    @param fileName - имя файла лога
+    @return имя сжатого файла
+*/
+QString compressLogFile(const QString& fileName);
+
+/*!
+    Возвращает имя файла индекса для файла лога. Сжатый файл использует индекс исходного файла
+    @param logFileName - имя файла лога (сжатого или несжатого)
+    @return имя файла индекса
+*/
+QString logIndexFileName(const QString& logFileName);
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LogFileReader class - построчное чтение файлов лога. Сжатые файлы (см. compressLogFile(...))
+///         распаковываются потоково по одному блоку, несжатые файлы читаются как есть. Записи двоичных файлов
+///         (LogFileFormat::BINARY) преобразуются в строки текстового формата "[DATETIME_FORMAT] [prefix] [msg]".
+///         Если задан интервал времени (см. setTimeRange(...)) - чтение начинается с ближайшей записи индекса файла
+///         и возвращаются только сообщения из этого интервала
+///
+class LogFileReader final
+{
+public:
+    /*!
+        Конструктор. Планируется использовать только этот конструтор
+        @param fileName - имя файла лога (текстового или двоичного, сжатого или несжатого)
+    */
+    explicit LogFileReader(const QString& fileName);
+
+    /*!
+        Деструктор
+    */
+    ~LogFileReader() = default;
+
+    /*!
+        Открывает файл на чтение
+        @return true - если файл успешно открыт
+    */
+    bool open();
+
+    /*!
+        Возвращает true если файл сжат
+        @return true - если файл сжат
+    */
+    bool isCompressed() const noexcept { return _isCompressed; }
+
+    /*!
+        Возвращает true если файл записан в двоичном формате
+        @return true - если файл двоичный
+    */
+    bool isBinary() const noexcept { return _isBinary; }
+
+    /*!
+        Ограничивает чтение интервалом времени. Если для файла есть индекс (см. LogIndexRecordType) - переходит
+            к последней записи индекса до начала интервала, иначе файл читается с начала. Далее readLine() возвращает
+            только сообщения из интервала, а atEnd() возвращает true после выхода за его конец. Строки без метки
+            времени (продолжения многострочных сообщений) относятся к предыдущему сообщению. Должен вызываться сразу после open()
+        @param from - начало интервала (мс от начала эпохи)
+        @param to - конец интервала включительно (мс от начала эпохи)
+        @return true - если для перехода использован индекс
+    */
+    bool setTimeRange(qint64 from, qint64 to);
+
+    /*!
+        Возвращает true если все строки файла прочитаны или произошла ошибка
+        @return true - если достигнут конец файла
+    */
+    bool atEnd() const;
+
+    /*!
+        Считывает очередную строку файла. Если задан интервал времени - строки вне интервала пропускаются
+        @return строка без символа конца строки
+    */
+    QByteArray readLine();
+
+    /*!
+        Возвращает true если при выполнении последнего действия произошла ошибка
+        @return true - если есть ошибка
+     */
+    bool isError() const noexcept;
+
+    /*!
+        Возвращает тектовое описание ошибки и сбразывает ее
+        @return - текст ошибки
+    */
+    [[nodiscard]] QString errorString();
+
+private:
+    // Удаляем неиспользуемые конструторы
+    LogFileReader() = delete;
+    Q_DISABLE_COPY_MOVE(LogFileReader);
+
+    /*!
+        Считывает очередную строку файла без учета интервала времени
+        @param dateTime - сюда будет помещено время сообщения (мс от начала эпохи) или -1 если строка не содержит метку времени
+        @return строка без символа конца строки
+    */
+    QByteArray readNextLine(qint64& dateTime);
+
+    /*!
+        Ищет в индексе файла позицию для начала чтения сообщений начиная с времени dateTime
+        @param dateTime - время (мс от начала эпохи)
+        @param offset - сюда будет помещено смещение в несжатом файле
+        @return true - если индекс найден и содержит подходящую запись
+    */
+    bool findIndexOffset(qint64 dateTime, qint64& offset);
+
+    /*!
+        Переходит к смещению в несжатых данных файла. Для сжатого файла пропускает блоки до нужного
+            без распаковки
+        @param offset - смещение
+        @return true - в случае успеха
+    */
+    bool seekRaw(qint64 offset);
+
+    /*!
+        Считывает и распаковывает очередной блок сжатого файла
+        @return true - если блок успешно считан
+    */
+    bool readChunk();
+
+    /*!
+        Возвращает true если все данные файла прочитаны (с учетом распаковки)
+        @return true - если достигнут конец данных
+    */
+    bool rawAtEnd() const;
+
+    /*!
+        Считывает строку данных файла (с учетом распаковки)
+        @return строка вместе с символом конца строки
+    */
+    QByteArray readRawLine();
+
+    /*!
+        Считывает заданное количество байт данных файла (с учетом распаковки)
+        @param size - количество байт
+        @return данные. Размер может быть меньше запрошенного, если достигнут конец данных
+    */
+    QByteArray readRaw(qsizetype size);
+
+    /*!
+        Считывает текст двоичного файла в формате [размер в байтах:4][UTF-8]
+        @param text - сюда будет помещен текст в UTF-8
+        @return true - если текст успешно считан
+    */
+    bool readBinaryText(QByteArray& text);
+
+    /*!
+        Считывает записи двоичного файла до очередного сообщения и преобразует его в строку текстового формата
+        @param dateTime - сюда будет помещено время сообщения (мс от начала эпохи)
+        @return строка или пустой массив если достигнут конец файла
+    */
+    QByteArray readBinaryLine(qint64& dateTime);
+
+private:
+    QFile _file;                    ///< Файл лога
+
+    bool _isCompressed = false;     ///< Признак сжатого файла
+    bool _isBinary = false;         ///< Признак двоичного файла
+    QHash<quint32, QByteArray> _prefixes; ///< Префиксы двоичного файла. Ключ - ИД префикса, значение - префикс в UTF-8
+    QByteArray _chunk;              ///< Текущий распакованный блок сжатого файла
+    qsizetype _chunkPos = 0;        ///< Текущая позиция в блоке
+
+    bool _isTimeRange = false;      ///< Признак чтения интервала времени
+    qint64 _from = 0;               ///< Начало интервала времени (мс от начала эпохи)
+    qint64 _to = 0;                 ///< Конец интервала времени (мс от начала эпохи)
+    bool _isInRange = false;        ///< Признак того, что последнее сообщение с меткой времени попало в интервал
+    bool _isRangeEnd = false;       ///< Признак выхода за конец интервала
+
+    QString _errorString;           ///< Текст последней ошибки
+
+};
+
+} //namespace Common
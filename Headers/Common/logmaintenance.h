@@ -0,0 +1,69 @@
+#pragma once
+
+//STL
+#include <functional>
+#include <queue>
+#include <memory>
+
+//Qt
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LogMaintenance class - фоновый обработчик служебных задач логирования (удаление устаревших
+///         файлов лога и т.п.). Задачи выполняются последовательно в отдельном потоке с низким приоритетом
+///         и никогда не блокируют потоки, пишущие в лог. Предполагается что это глобальный синглтон класс
+///
+class LogMaintenance final
+{
+public:
+    using Task = std::function<void()>; ///< Служебная задача
+
+public:
+    /*!
+        Возвращает указатель на глобальный обработчик служебных задач. Обработчик создается при первом вызове
+        @return указатель на обработчик или nullptr если обработчик уже уничтожен (процесс завершается)
+    */
+    static LogMaintenance* instance();
+
+public:
+    /*!
+        Конструктор. Запускает поток обработки. Предполагается создание экзепляра класса только через instance()
+    */
+    LogMaintenance();
+
+    /*!
+        Деструктор. Выполняет все оставшиеся задачи и останавливает поток обработки
+    */
+    ~LogMaintenance();
+
+    /*!
+        Помещает задачу в очередь на выполнение. Этот метод потокобезопасный
+        @param task - задача
+    */
+    void post(Task&& task);
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(LogMaintenance);
+
+    /*!
+        Основной цикл потока обработки
+    */
+    void run();
+
+private:
+    QMutex _mutex;                      ///< Мьютекс очереди задач
+    QWaitCondition _condition;          ///< Поступление новой задачи
+    std::queue<Task> _tasks;            ///< Очередь задач
+    bool _isStopped = false;            ///< Флаг остановки потока обработки
+
+    std::unique_ptr<QThread> _thread;   ///< Поток обработки
+
+};
+
+} //namespace Common
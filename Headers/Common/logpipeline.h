@@ -0,0 +1,96 @@
+#pragma once
+
+//STL
+#include <memory>
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QReadWriteLock>
+
+//My
+#include "Common/logsink.h"
+#include "Common/filelogsink.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LogPipeline class - конвейер логирования. Сообщение создается один раз (LogRecord) и передается
+///         в очереди всех приемников (LogSink), которые его принимают. Каждый приемник обрабатывает сообщения
+///         в своем потоке со своим фильтром уровня и своими пачками. По умолчанию конвейер содержит приемники
+///         ConsoleLogSink и FileLogSink. Предполагается что это глобальный синглтон класс
+///
+class LogPipeline final
+{
+public:
+    /*!
+        Возвращает указатель на глобальный конвейер логирования. Конвейер создается при первом вызове
+        @return указатель на конвейер или nullptr если конвейер уже уничтожен (процесс завершается)
+    */
+    static LogPipeline* instance();
+
+public:
+    /*!
+        Конструктор. Создает и запускает приемники по умолчанию. Предполагается создание экзепляра класса только через instance()
+    */
+    LogPipeline();
+
+    /*!
+        Деструктор. Останавливает все приемники, предварительно обработав все сообщения
+    */
+    ~LogPipeline();
+
+    /*!
+        Добавляет и запускает приемник. Этот метод потокобезопасный
+        @param sink - приемник. Не должен быть nullptr и не должен быть запущен
+    */
+    void addSink(const std::shared_ptr<LogSink>& sink);
+
+    /*!
+        Удаляет приемник из конвейера и останавливает его. Этот метод потокобезопасный
+        @param sink - приемник
+    */
+    void removeSink(const std::shared_ptr<LogSink>& sink);
+
+    /*!
+        Возвращает приемник по названию. Этот метод потокобезопасный
+        @param name - название приемника
+        @return приемник или nullptr если приемник не найден
+    */
+    std::shared_ptr<LogSink> sink(const QString& name) const;
+
+    /*!
+        Возвращает приемник записи в файл лога
+        @return приемник записи в файл лога
+    */
+    const std::shared_ptr<FileLogSink>& fileSink() const noexcept { return _fileSink; }
+
+    /*!
+        Передает сообщение всем приемникам, которые его принимают. Этот метод потокобезопасный
+        @param targets - назначения сообщения (набор флагов LogSink::Target)
+        @param level - уровень сообщения
+        @param prefix - префикс сообщения
+        @param msg - сообщение
+    */
+    void publish(quint8 targets, LogLevel level, const QString& prefix, const QString& msg);
+
+    /*!
+        Ожидает обработки всеми приемниками сообщений, переданных до вызова этого метода. Время ожидания ограничено.
+            Этот метод потокобезопасный
+    */
+    void flush();
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(LogPipeline);
+
+private:
+    mutable QReadWriteLock _sinksLock;              ///< Блокировка списка приемников
+    std::vector<std::shared_ptr<LogSink>> _sinks;   ///< Список приемников
+
+    std::shared_ptr<FileLogSink> _fileSink;         ///< Приемник записи в файл лога
+
+};
+
+} //namespace Common
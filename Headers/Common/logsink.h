@@ -0,0 +1,273 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <memory>
+
+//Qt
+#include <QString>
+#include <QByteArray>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QDeadlineTimer>
+
+//My
+#include "Common/mpscqueue.h"
+#include "Common/log.h"
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LogRecord class - сообщение конвейера логирования. Создается один раз и
+///         разделяется всеми приемниками (см. LogPipeline)
+///
+struct LogRecord
+{
+    qint64 dateTime = 0;            ///< Время сообщения (мс от начала эпохи)
+    quint8 targets = 0;             ///< Назначения сообщения (набор флагов LogSink::Target)
+    LogLevel level = LogLevel::UND; ///< Уровень сообщения
+    QString prefix;                 ///< Префикс сообщения
+    QString msg;                    ///< Сообщение
+};
+
+using PLogRecord = std::shared_ptr<const LogRecord>; ///< Указатель на сообщение конвейера логирования
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LogSink class - базовый класс приемника сообщений лога. Каждый приемник имеет собственную неблокирующую
+///         очередь и собственный поток обработки, поэтому медленный приемник не задерживает остальные. Сообщения
+///         обрабатываются пачками: поток просыпается по таймеру или при накоплении заданного количества сообщений.
+///         Наследники должны вызывать stop() в своем деструкторе
+///
+class LogSink
+{
+public:
+    /*!
+        Назначение сообщения. Приемник принимает сообщения, назначение которых пересекается с его назначениями
+     */
+    enum Target: quint8
+    {
+        TARGET_CONSOLE = 0x01,  ///< Консоль (stderr)
+        TARGET_FILE = 0x02,     ///< Файл лога
+        TARGET_DB = 0x04,       ///< Таблица лога в БД
+        TARGET_SYSLOG = 0x08    ///< Системный журнал
+    };
+
+public:
+    /*!
+        Деструктор. Наследники должны остановить поток обработки (вызвать stop()) до вызова этого деструктора
+    */
+    virtual ~LogSink();
+
+    /*!
+        Возвращает название приемника
+        @return название приемника
+    */
+    const QString& name() const noexcept { return _name; }
+
+    /*!
+        Возвращает назначения сообщений, которые принимает приемник
+        @return набор флагов Target
+    */
+    quint8 targets() const noexcept { return _targets; }
+
+    /*!
+        Устанавливает минимальный уровень принимаемых сообщений. Этот метод потокобезопасный
+        @param level - минимальный уровень
+    */
+    void setMinLevel(LogLevel level);
+
+    /*!
+        Возвращает минимальный уровень принимаемых сообщений
+        @return минимальный уровень
+    */
+    LogLevel minLevel() const;
+
+    /*!
+        Устанавливает параметры формирования пачек. Метод должен вызываться до start()
+        @param wakeUpCount - количество сообщений в очереди, при котором поток обработки будится досрочно
+        @param flushInterval - максимальный интервал обработки накопленных сообщений, мс
+    */
+    void setBatchParams(qint64 wakeUpCount, int flushInterval);
+
+    /*!
+        Возвращает true если приемник принимает сообщение (совпадает назначение и уровень)
+        @param record - сообщение
+        @return true - если приемник принимает сообщение
+    */
+    bool accepts(const LogRecord& record) const;
+
+    /*!
+        Помещает сообщение в очередь приемника. Этот метод потокобезопасный и не использует блокировок
+        @param record - сообщение
+    */
+    void post(const PLogRecord& record);
+
+    /*!
+        Ожидает обработки всех сообщений, помещенных в очередь до вызова этого метода. Этот метод потокобезопасный
+        @param deadline - крайний срок ожидания
+    */
+    void flush(const QDeadlineTimer& deadline);
+
+    /*!
+        Возвращает количество сообщений, помещенных в очередь и еще не обработанных (включая обрабатываемую пачку).
+            Этот метод потокобезопасный и не использует блокировок
+        @return количество сообщений
+    */
+    qint64 queueSize() const noexcept;
+
+    /*!
+        Запускает поток обработки
+    */
+    void start();
+
+    /*!
+        Обрабатывает все оставшиеся в очереди сообщения и останавливает поток обработки
+    */
+    void stop();
+
+protected:
+    /*!
+        Конструктор
+        @param name - название приемника
+        @param targets - назначения сообщений, которые принимает приемник (набор флагов Target)
+    */
+    LogSink(const QString& name, quint8 targets);
+
+    /*!
+        Вызывается в потоке обработки после его запуска
+    */
+    virtual void started() {}
+
+    /*!
+        Вызывается в потоке обработки перед его остановкой, после обработки всех сообщений
+    */
+    virtual void stopped() {}
+
+    /*!
+        Обрабатывает очередное сообщение. Вызывается в потоке обработки
+        @param record - сообщение
+    */
+    virtual void writeRecord(const LogRecord& record) = 0;
+
+    /*!
+        Завершает обработку пачки сообщений (записывает накопленные данные). Вызывается в потоке обработки
+    */
+    virtual void flushRecords() = 0;
+
+    /*!
+        Будит поток обработки досрочно, не помещая сообщение в очередь. Этот метод потокобезопасный
+    */
+    void wakeUp();
+
+    /*!
+        Возвращает true если метод вызван из потока обработки приемника
+        @return true - если текущий поток - поток обработки
+    */
+    bool isSinkThread() const;
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    LogSink() = delete;
+    Q_DISABLE_COPY_MOVE(LogSink);
+
+    /*!
+        Основной цикл потока обработки
+    */
+    void run();
+
+    /*!
+        Извлекает все сообщения из очереди и обрабатывает их
+    */
+    void processQueue();
+
+private:
+    const QString _name;                            ///< Название приемника
+    const quint8 _targets = 0;                      ///< Назначения принимаемых сообщений
+
+    std::atomic<LogLevel> _minLevel = LogLevel::DBG;///< Минимальный уровень принимаемых сообщений
+    qint64 _wakeUpCount = 256;                      ///< Количество сообщений в очереди, при котором поток обработки будится досрочно
+    int _flushInterval = 200;                       ///< Максимальный интервал обработки накопленных сообщений, мс
+
+    MPSCQueue<PLogRecord> _queue;                   ///< Очередь сообщений
+
+    std::atomic<qint64> _pushedCount = 0;           ///< Количество сообщений помещенных в очередь
+    std::atomic<qint64> _processedCount = 0;        ///< Количество обработанных сообщений
+    std::atomic<bool> _isWakeUpPending = false;     ///< Поток обработки уже разбужен
+    std::atomic<bool> _isStopped = false;           ///< Флаг остановки потока обработки
+
+    QMutex _wakeUpMutex;                            ///< Мьютекс пробуждения потока обработки
+    QWaitCondition _wakeUpCondition;                ///< Пробуждение потока обработки
+    QWaitCondition _flushedCondition;               ///< Завершение обработки пачки сообщений
+    int _flushWaiters = 0;                          ///< Количество потоков, ожидающих завершения обработки
+
+    std::unique_ptr<QThread> _thread;               ///< Поток обработки
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The ConsoleLogSink class - приемник сообщений лога, выводящий их в stderr в формате "[SIMPLY_TIME_FORMAT] [prefix] [msg]"
+///
+class ConsoleLogSink final
+    : public LogSink
+{
+public:
+    /*!
+        Конструктор
+    */
+    ConsoleLogSink();
+
+    /*!
+        Деструктор
+    */
+    ~ConsoleLogSink() override;
+
+protected:
+    void writeRecord(const LogRecord& record) override;
+    void flushRecords() override;
+
+private:
+    Q_DISABLE_COPY_MOVE(ConsoleLogSink);
+
+private:
+    QByteArray _buffer;     ///< Пачка сообщений для записи в stderr
+
+};
+
+#ifdef Q_OS_UNIX
+///////////////////////////////////////////////////////////////////////////////
+///     The SyslogLogSink class - приемник сообщений лога, передающий их в системный журнал (syslog/journald)
+///         через локальный сокет. По умолчанию принимает сообщения, назначенные в консоль или файл
+///
+class SyslogLogSink final
+    : public LogSink
+{
+public:
+    /*!
+        Конструктор
+        @param targets - назначения сообщений, которые принимает приемник (набор флагов Target)
+    */
+    explicit SyslogLogSink(quint8 targets = TARGET_CONSOLE | TARGET_FILE);
+
+    /*!
+        Деструктор
+    */
+    ~SyslogLogSink() override;
+
+protected:
+    void started() override;
+    void stopped() override;
+    void writeRecord(const LogRecord& record) override;
+    void flushRecords() override;
+
+private:
+    Q_DISABLE_COPY_MOVE(SyslogLogSink);
+
+private:
+    QByteArray _ident;      ///< Идентификатор приложения в системном журнале. Должен существовать все время работы с журналом
+
+};
+#endif
+
+} //namespace Common
@@ -0,0 +1,124 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <memory>
+
+//Qt
+#include <QString>
+#include <QList>
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LogSuppressor class - подавление лавины одинаковых сообщений лога. Сообщения различаются по ключу
+///         (тип, файл, строка и хеш текста). В течение окна времени пропускаются первые burstLimit сообщений
+///         с одинаковым ключом, остальные только подсчитываются. По окончании окна формируется итоговое сообщение
+///         "повторено X раз" (см. Summary). Ключ занимает ячейку таблицы фиксированного размера, определяемую
+///         его хешем, без блокировок. Если ячейка занята другим сообщением - сообщение пропускается без подавления
+///
+class LogSuppressor final
+{
+public:
+    static const quint32 DEFAULT_BURST_LIMIT = 20;  ///< Количество одинаковых сообщений, пропускаемых в течение окна по умолчанию
+    static const qint64 DEFAULT_WINDOW = 1000;      ///< 1с окно подсчета одинаковых сообщений по умолчанию
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Итог подавления сообщения за окно
+    ///
+    struct Summary
+    {
+        QtMsgType type = QtDebugMsg;    ///< Тип подавленного сообщения
+        QString msg;                    ///< Текст подавленного сообщения
+        quint64 count = 0;              ///< Количество подавленных сообщений. 0 - сообщения не подавлялись
+        qint64 interval = 0;            ///< Длительность окна, мс
+    };
+
+public:
+    /*!
+        Конструктор
+    */
+    LogSuppressor();
+
+    /*!
+        Деструктор
+    */
+    ~LogSuppressor();
+
+    /*!
+        Устанавливает параметры подавления. Этот метод потокобезопасный
+        @param burstLimit - количество одинаковых сообщений, пропускаемых в течение окна. 0 - подавление отключено
+        @param window - длительность окна, мс
+    */
+    void setParams(quint32 burstLimit, qint64 window);
+
+    /*!
+        Учитывает сообщение и определяет нужно ли его выводить. Этот метод потокобезопасный и не использует блокировок
+        @param type - тип сообщения
+        @param file - имя файла исходного кода из контекста сообщения или nullptr
+        @param line - номер строки из контекста сообщения
+        @param msg - сообщение
+        @param now - текущее монотонное время, мс
+        @param summary - итог предыдущего окна этого сообщения. Если summary.count > 0 - итог необходимо вывести перед сообщением
+        @return true - если сообщение нужно вывести, false - если сообщение подавлено
+    */
+    bool check(QtMsgType type, const char* file, int line, const QString& msg, qint64 now, Summary& summary);
+
+    /*!
+        Завершает истекшие окна и возвращает итоги по подавленным в них сообщениям. Освобождает ячейки таблицы
+            сообщений, не повторявшихся в течение окна. Проверка выполняется не чаще одного раза за окно.
+            Этот метод потокобезопасный и не блокирует вызывающий поток
+        @param now - текущее монотонное время, мс
+        @param force - true - завершить все окна, в т.ч. не истекшие, независимо от времени предыдущей проверки
+        @return список итогов
+    */
+    QList<Summary> sweep(qint64 now, bool force = false);
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(LogSuppressor);
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Ячейка таблицы сообщений
+    ///
+    struct Slot
+    {
+        std::atomic<quint64> key = 0;           ///< Ключ сообщения. EMPTY_KEY - ячейка свободна, BUSY_KEY - ячейка занимается/освобождается
+        std::atomic<qint64> windowStart = 0;    ///< Время начала текущего окна, мс
+        std::atomic<quint64> count = 0;         ///< Количество сообщений в текущем окне
+        std::atomic<quint32> users = 0;         ///< Количество потоков, работающих с ячейкой в check(...). Занятая ячейка освобождается только при 0
+
+        //Устанавливаются только в состоянии BUSY_KEY
+        QtMsgType type = QtDebugMsg;            ///< Тип сообщения
+        QString* text = nullptr;                ///< Текст сообщения для итога. Читается только в sweep(...)
+    };
+
+    /*!
+        Ищет ячейку сообщения в таблице. Если ячейка сообщения свободна - занимает ее. Найденная ячейка удерживается
+            (Slot::users) и не может быть освобождена sweep(...) до вызова releaseSlot(...)
+        @param key - ключ сообщения
+        @param type - тип сообщения
+        @param msg - сообщение
+        @param now - текущее монотонное время, мс
+        @return ячейка или nullptr если ячейка занята другим сообщением
+    */
+    Slot* findSlot(quint64 key, QtMsgType type, const QString& msg, qint64 now);
+
+    /*!
+        Освобождает ячейку, удерживаемую findSlot(...)
+        @param slot - ячейка
+    */
+    static void releaseSlot(Slot& slot);
+
+private:
+    std::atomic<quint32> _burstLimit = DEFAULT_BURST_LIMIT; ///< Количество одинаковых сообщений, пропускаемых в течение окна
+    std::atomic<qint64> _window = DEFAULT_WINDOW;           ///< Длительность окна, мс
+
+    std::unique_ptr<Slot[]> _slots;             ///< Таблица сообщений. Ячейка сообщения определяется его ключом
+    std::atomic<qint64> _lastSweep = 0;         ///< Время последней проверки истекших окон, мс
+    std::atomic_bool _isSweeping = false;       ///< Флаг выполнения sweep(...). Одновременно проверку выполняет только один поток
+
+};
+
+} //namespace Common
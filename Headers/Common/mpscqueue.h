@@ -0,0 +1,149 @@
+#pragma once
+
+//STL
+#include <atomic>
+#include <utility>
+
+//Qt
+#include <QtGlobal>
+
+namespace Common
+{
+
+///////////////////////////////////////////////////////////////////////////////
+///     The MPSCQueue class - неблокирующая очередь с множеством писателей и одним читателем
+///         (алгоритм Д. Вьюкова). Метод push(...) может вызываться из любого потока одновременно,
+///         метод pop(...) - только из одного потока-читателя. Тип T должен иметь конструктор по умолчанию
+///
+template <typename T>
+class MPSCQueue final
+{
+public:
+    /*!
+        Конструктор
+    */
+    MPSCQueue()
+        : _head(&_stub)
+        , _tail(&_stub)
+    {
+    }
+
+    /*!
+        Деструктор. Удаляет все оставшиеся в очереди элементы
+    */
+    ~MPSCQueue()
+    {
+        T tmp;
+        while (pop(tmp))
+        {
+        }
+
+        auto node = _tail;
+        while (node != nullptr)
+        {
+            auto next = node->next.load(std::memory_order_relaxed);
+            if (node != &_stub)
+            {
+                delete node;
+            }
+            node = next;
+        }
+    }
+
+    /*!
+        Помещает элемент в очередь. Этот метод потокобезопасный и не использует блокировок
+        @param value - элемент
+    */
+    void push(T&& value)
+    {
+        push(new Node(std::move(value)));
+    }
+
+    /*!
+        Извлекает элемент из очереди. Этот метод должен вызываться только из потока-читателя
+        @param value - сюда будет помещен извлеченный элемент
+        @return true - если элемент извлечен, false - если очередь пуста или писатель еще не завершил добавление
+    */
+    bool pop(T& value)
+    {
+        auto tail = _tail;
+        auto next = tail->next.load(std::memory_order_acquire);
+
+        if (tail == &_stub)
+        {
+            if (next == nullptr)
+            {
+                return false;
+            }
+
+            _tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next != nullptr)
+        {
+            _tail = next;
+            value = std::move(tail->value);
+            delete tail;
+
+            return true;
+        }
+
+        if (tail != _head.load(std::memory_order_acquire))
+        {
+            //писатель еще не завершил добавление элемента
+            return false;
+        }
+
+        push(&_stub);
+
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != nullptr)
+        {
+            _tail = next;
+            value = std::move(tail->value);
+            delete tail;
+
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    /*!
+        Узел очереди
+     */
+    struct Node
+    {
+        Node() = default;
+
+        explicit Node(T&& nodeValue)
+            : value(std::move(nodeValue))
+        {
+        }
+
+        std::atomic<Node*> next = nullptr;  ///< Следующий узел
+        T value;                            ///< Значение
+    };
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(MPSCQueue);
+
+    void push(Node* node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        auto prev = _head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+private:
+    Node _stub;                     ///< Фиктивный узел
+    std::atomic<Node*> _head;       ///< Голова очереди (сюда добавляют писатели)
+    Node* _tail = nullptr;          ///< Хвост очереди (отсюда читает читатель)
+
+};
+
+} //namespace Common
@@ -2,9 +2,12 @@
 
 //STL
 #include  <stdexcept>
+#include <optional>
+#include <type_traits>
 
 //Qt
 #include <QString>
+#include <QVariant>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlQuery>
 
@@ -74,16 +77,28 @@ void closeDB(QSqlDatabase& db);
 /*!
     Начинает транзакцию к БД. Если возникнет ошибка - будет сгенерированно исключение SQLException
     @param db - ссылка на подключение к БД
+    @param isReconnect - true - при ошибке начала транзакции подключение переоткрывается (синхронно, с ожиданием
+        таймаута подключения если БД недоступна). Владельцы подключений, использующие DBConnectionSupervisor, передают false
  */
-void transactionDB(QSqlDatabase& db);
+void transactionDB(QSqlDatabase& db, bool isReconnect = true);
 
 /*!
-    Выполнят запрос к БД типа INSERT, DELETE и UPDATE. Если возникнет ошибка - будет сгенерированно исключение SQLException
+    Выполнят запрос к БД типа INSERT, DELETE и UPDATE в отдельной транзакции. Если возникнет ошибка - будет сгенерированно
+        исключение SQLException. Транзакция требует трех обращений к серверу: для одиночных запросов используйте
+        DBQueryExecuteAutoCommit(...), для нескольких запросов в одной транзакции - DBTransaction
     @param db - ссылка на подключение к БД
     @param queryText - текст запроса
 */
 void DBQueryExecute(QSqlDatabase& db, const QString &queryText);
 
+/*!
+    Выполнят запрос к БД без явной транзакции (в режиме автоматической фиксации подключения) за одно обращение к серверу.
+        Предназначен для одиночных запросов и DDL. Если возникнет ошибка - будет сгенерированно исключение SQLException
+    @param db - ссылка на подключение к БД
+    @param queryText - текст запроса
+*/
+void DBQueryExecuteAutoCommit(QSqlDatabase& db, const QString &queryText);
+
 /*!
     Выполнят запрос к БД типа SELECT. Если возникнет ошибка - будет сгенерированно исключение SQLException. Часто
         для оптимизации работы следут указать свойство запроса QSqlQuery::setForwardOnly(true)
@@ -93,12 +108,156 @@ void DBQueryExecute(QSqlDatabase& db, const QString &queryText);
 */
 void DBQueryExecute(QSqlDatabase& db, QSqlQuery& query, const QString &queryText);
 
+/*!
+    Подготавливает запрос к БД с параметрами (см. QSqlQuery::prepare()). Если возникнет ошибка - будет сгенерированно исключение SQLException
+    @param db - ссылка на подключение к БД
+    @param query - ссылка на запрос
+    @param queryText - текст запроса с параметрами ('?' или ':name')
+*/
+void DBQueryPrepare(QSqlDatabase& db, QSqlQuery& query, const QString &queryText);
+
+/*!
+    Выполняет подготовленный запрос для всех наборов значений параметров, привязанных списками (см. QSqlQuery::execBatch()).
+        Если драйвер не поддерживает пакетное выполнение, запрос выполняется для каждого набора отдельно без повторного разбора.
+        Если возникнет ошибка - будет сгенерированно исключение SQLException
+    @param db - ссылка на подключение к БД
+    @param query - ссылка на подготовленный запрос
+*/
+void DBQueryExecuteBatch(QSqlDatabase& db, QSqlQuery& query);
+
+/*!
+    Выполняет подготовленный запрос с привязанными значениями параметров (см. QSqlQuery::exec()). Если возникнет ошибка -
+        будет сгенерированно исключение SQLException
+    @param db - ссылка на подключение к БД
+    @param query - ссылка на подготовленный запрос
+*/
+void DBQueryExecutePrepared(QSqlDatabase& db, QSqlQuery& query);
+
+///////////////////////////////////////////////////////////////////////////////
+///     Признак типа std::optional для DBQueryParamValue(...)
+///
+template <typename T>
+struct IsDBOptional: std::false_type {};
+
+template <typename T>
+struct IsDBOptional<std::optional<T>>: std::true_type {};
+
+/*!
+    Преобразует значение параметра запроса в QVariant. Строковые литералы передаются как QString (UTF-8), перечисления
+        и целые типы меньше int - как int, пустой std::optional - как NULL соответствующего типа
+    @param value - значение
+    @return значение параметра
+*/
+template <typename T>
+QVariant DBQueryParamValue(const T& value)
+{
+    using Type = std::decay_t<T>;
+
+    if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>)
+    {
+        return QString::fromUtf8(value);
+    }
+    else if constexpr (std::is_enum_v<Type>)
+    {
+        return QVariant(static_cast<int>(value));
+    }
+    else if constexpr (std::is_integral_v<Type> && !std::is_same_v<Type, bool> && sizeof(Type) < sizeof(int))
+    {
+        return QVariant(static_cast<int>(value));
+    }
+    else if constexpr (IsDBOptional<Type>::value)
+    {
+        return value.has_value() ? DBQueryParamValue(*value) : QVariant(QMetaType::fromType<typename Type::value_type>());
+    }
+    else
+    {
+        return QVariant::fromValue(value);
+    }
+}
+
+/*!
+    Привязывает значения позиционных параметров ('?') подготовленного запроса. Значения преобразуются DBQueryParamValue(...),
+        поэтому их не нужно экранировать и вставлять в текст запроса
+    @param query - ссылка на подготовленный запрос
+    @param args - значения параметров в порядке их следования в запросе
+*/
+template <typename... Args>
+void DBQueryBindValues(QSqlQuery& query, const Args&... args)
+{
+    [[maybe_unused]] int index = 0;
+    (query.bindValue(index++, DBQueryParamValue(args)), ...);
+}
+
+/*!
+    Подготавливает и выполняет запрос с позиционными параметрами ('?'). Если возникнет ошибка - будет сгенерированно
+        исключение SQLException. Для многократно выполняемых запросов используйте DBStatementCache, чтобы запрос
+        не разбирался сервером при каждом выполнении
+    @param db - ссылка на подключение к БД
+    @param query - ссылка на запрос
+    @param queryText - текст запроса с параметрами '?'
+    @param arg, args - значения параметров в порядке их следования в запросе
+*/
+template <typename Arg, typename... Args>
+void DBQueryExecute(QSqlDatabase& db, QSqlQuery& query, const QString& queryText, const Arg& arg, const Args&... args)
+{
+    DBQueryPrepare(db, query, queryText);
+    DBQueryBindValues(query, arg, args...);
+    DBQueryExecutePrepared(db, query);
+}
+
 /*!
     Завершаеттранзакцию к БД. Если возникнет ошибка - будет сгенерированно исключение SQLException
     @param db - ссылка на подключение к БД
  */
 void commitDB(QSqlDatabase& db);
 
+///////////////////////////////////////////////////////////////////////////////
+///     The DBTransaction class - область транзакции. Начинает транзакцию в конструкторе и откатывает ее в деструкторе,
+///         если она не была зафиксирована commit(), в том числе при выходе из области по исключению. Позволяет выполнить
+///         несколько запросов с одной фиксацией. Транзакция начинается без переподключения: при ошибке генерируется
+///         исключение SQLException
+///
+class DBTransaction final
+{
+public:
+    /*!
+        Конструктор. Начинает транзакцию. Если возникнет ошибка - будет сгенерированно исключение SQLException
+        @param db - ссылка на подключение к БД. Должно существовать все время жизни объекта
+    */
+    explicit DBTransaction(QSqlDatabase& db);
+
+    /*!
+        Деструктор. Откатывает незафиксированную транзакцию
+    */
+    ~DBTransaction();
+
+    /*!
+        Фиксирует транзакцию. Если возникнет ошибка - транзакция откатывается и генерируется исключение SQLException
+    */
+    void commit();
+
+    /*!
+        Откатывает транзакцию, если она не завершена
+    */
+    void rollback() noexcept;
+
+    /*!
+        Возвращает true если транзакция начата и не завершена
+        @return true - если транзакция активна
+    */
+    bool isActive() const noexcept { return _isActive; }
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    DBTransaction() = delete;
+    Q_DISABLE_COPY_MOVE(DBTransaction);
+
+private:
+    QSqlDatabase& _db;      ///< Подключение к БД
+    bool _isActive = false; ///< Транзакция начата и не завершена
+
+};
+
 /*!
     Возврщает строку с описанием ошибки подключения к БД
     @param db - ссылка на подключение к БД
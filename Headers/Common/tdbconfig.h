@@ -1,6 +1,7 @@
 #pragma once
 
 //STL
+#include <memory>
 #include <unordered_map>
 
 //Qt
@@ -9,6 +10,8 @@
 
 #include "Common/common.h"
 #include "Common/sql.h"
+#include "Common/dbconnectionsupervisor.h"
+#include "Common/dbstatementcache.h"
 
 namespace Common
 {
@@ -16,7 +19,8 @@ namespace Common
 ///////////////////////////////////////////////////////////////////////////////
 ///     The TDBConfig class - класс обеспечивает чтение и сохранение параметров
 ///         приложения в БД. Подключение и считывание параметров из БД происодит
-///         при первом вызове методов getValue(...), setValue(...) или hasValue(...)
+///         при первом вызове методов getValue(...), setValue(...) или hasValue(...). Если БД недоступна, методы
+///         завершаются сразу с ошибкой (см. isError()), а подключение восстанавливается в фоне (см. DBConnectionSupervisor)
 ///
 class TDBConfig final
     : public QObject
@@ -72,6 +76,12 @@ public:
      */
     bool hasValue(const QString& key);
 
+    /*!
+        Возвращает состояние подключения к БД. Этот метод потокобезопасный
+        @return состояние подключения
+    */
+    DBConnectionSupervisor::State connectionState() const noexcept;
+
 signals:
     /*!
         Сигнал генерируется если в процессе работы с БД произошла ошибка. Этот метод потокобезопасный
@@ -90,11 +100,25 @@ private:
     */
     void loadFromDB();
 
+    /*!
+        Открывает подключение к БД, если оно закрыто и БД доступна. Если БД недоступна - сразу возвращает false
+        @return true - если подключение открыто
+    */
+    bool ensureConnected();
+
+    /*!
+        Обрабатывает ошибку выполнения запроса: закрывает подключение и сообщает об ошибке наблюдателю
+        @param errorString - текст ошибки
+    */
+    void queryFailed(const QString& errorString);
+
 private:
     const Common::DBConnectionInfo _dbConnectionInfo;   ///< Параметры подключения к БД
     const QString _configDBName = "Config";             ///< Имя таблицы с параметрами
 
     QSqlDatabase _db; ///< Подключение к БД
+    std::unique_ptr<DBStatementCache> _statements; ///< Подготовленные запросы подключения. Существует пока открыто подключение
+    std::unique_ptr<DBConnectionSupervisor> _supervisor; ///< Наблюдатель за доступностью БД
 
     std::unordered_map<QString, QString> _values; ///< Карта параметров. Ключ - начвание параметра, Значение - значение параметра
 
@@ -1,24 +1,27 @@
 #pragma once
 
 //STL
-#include <future>
-#include <queue>
+#include <atomic>
 #include <memory>
 
 //Qt
 #include <QObject>
-#include <QtSql/QSqlDatabase>
 #include <QCoreApplication>
 
 //My
 #include "common.h"
 #include "sql.h"
+#include "dblogsink.h"
 
 namespace Common
 {
 
 ///////////////////////////////////////////////////////////////////////////////
-///     The TDBLoger class - логер БД. Предполагается что это глобальный сиглтон класс.
+///     The TDBLoger class - логер БД. Основной логер - глобальный сиглтон (DBLoger(...)), дополнительные логеры
+///         в другие таблицы создаются по имени (namedDBLoger(...)). Запись в БД выполняется в отдельном потоке
+///         со своим подключением (см. DBLogSink), поэтому sendLogMsg(...) только помещает сообщение в неблокирующую
+///         очередь и может вызываться из любого потока. Для интенсивного логирования из многих потоков используйте
+///         DBLogHandle: сообщения копятся в буфере потока и забираются потоком записи пачками
 ///
 class TDBLoger final
     : public QObject
@@ -42,11 +45,12 @@ public:
     /*!
         Реализация синглтона для логера. Создает новый логер, или метод вызван с параметрами, или
             возарщает указатель на ранее созданные, если без параметров. Первый вызов обязательно должен быть
-            с параметрами
+            с параметрами. Этот метод потокобезопасный
         @param DBConnectionInfo - конфигурация подключения к БД
         @param logDBName - Название таблицы с логами
         @param debugMode - включит/выключить режим отладки. В режиме отладки в консоль перенаправляются все сообщения,
-            поступающие в логер, в обычном режиме - только сообщения об ошибках
+            поступающие в логер, в обычном режиме - только сообщения об ошибках. Отладочные сообщения (DEBUG_CODE)
+            сохраняются в БД только в режиме отладки, в т.ч. в release сборке
         @param sender - название сервиса отправителя логов
         @param parent - указатель на родительский класс
         @return указатель на глобальный логер. Возвращется гарантированно не nullptr
@@ -58,10 +62,45 @@ public:
                              QObject* parent = nullptr);
 
     /*!
-        Удалят логер
+        Удалят логер. Этот метод потокобезопасный, но не должен вызываться одновременно с записью сообщений в логер
+            и пока существуют его описатели DBLogHandle
     */
     static void deleteDBLoger();
 
+    /*!
+        Возвращает именованный логер. Если логера с таким именем нет - создает его с заданными параметрами.
+            Именованные логеры позволяют писать разные потоки сообщений в разные таблицы, у каждого логера свой поток
+            записи и свое подключение к БД. Таблицы разных логеров должны различаться. Этот метод потокобезопасный
+        @param name - имя логера
+        @param DBConnectionInfo - конфигурация подключения к БД
+        @param logDBName - Название таблицы с логами
+        @param debugMode - включит/выключить режим отладки. Отладочные сообщения (DEBUG_CODE) сохраняются в БД только в режиме отладки
+        @param sender - название сервиса отправителя логов
+        @param parent - указатель на родительский класс
+        @return указатель на логер. Возвращется гарантированно не nullptr
+    */
+    static TDBLoger* namedDBLoger(const QString& name,
+                                  const DBConnectionInfo& DBConnectionInfo = {},
+                                  const QString& logDBName = "Log",
+                                  bool debugMode = true,
+                                  const QString& sender = QCoreApplication::applicationName(),
+                                  QObject* parent = nullptr);
+
+    /*!
+        Возвращает ранее созданный именованный логер. В отличие от namedDBLoger(...) не создает логер.
+            Этот метод потокобезопасный
+        @param name - имя логера
+        @return указатель на логер или nullptr, если логера с таким именем нет
+    */
+    static TDBLoger* findNamedDBLoger(const QString& name);
+
+    /*!
+        Удаляет именованный логер. Этот метод потокобезопасный, но не должен вызываться одновременно с записью
+            сообщений в этот логер и пока существуют его описатели DBLogHandle
+        @param name - имя логера
+    */
+    static void deleteNamedDBLoger(const QString& name);
+
     /*!
         Преобразует код сообщения в строку
         @param code -  код сообщеия
@@ -71,10 +110,84 @@ public:
 
 public:
     /*!
-        Деструктор
+        Деструктор. Записывает в БД оставшиеся в очереди сообщения в течение времени, заданного setStopTimeout(...).
+            Сообщения, не записанные за это время, сохраняются в дисковую очередь и будут записаны после следующего запуска.
+            К моменту удаления логера все его описатели DBLogHandle должны быть удалены
     */
     ~TDBLoger() override;
 
+    /*!
+        Устанавливает максимальное время записи в БД оставшихся в очереди сообщений при остановке логера
+        @param msec - время, мс
+    */
+    void setStopTimeout(qint64 msec) noexcept;
+
+    /*!
+        Устанавливает политику записи пачек сообщений в БД (максимальная задержка, бюджет пачки, подстройка размера пачки).
+            Применяется при следующем вызове start()
+        @param params - параметры политики записи
+    */
+    void setFlushParams(const DBFlushController::Params& params);
+
+    /*!
+        Устанавливает параметры дисковой очереди, в которую сохраняются сообщения, пока БД недоступна (см. DBLogSpool).
+            Применяется при следующем вызове start()
+        @param params - параметры дисковой очереди
+    */
+    void setSpoolParams(const DBLogSpool::Params& params);
+
+    /*!
+        Устанавливает параметры массовой загрузки сообщений при высоком потоке. Применяется при следующем вызове start()
+        @param params - параметры массовой загрузки
+    */
+    void setBulkParams(const DBBulkLoader::Params& params);
+
+    /*!
+        Устанавливает параметры удаления устаревших логов (см. DBLogRetention). Применяется при следующем вызове start()
+        @param params - параметры удаления
+    */
+    void setRetentionParams(const DBLogRetention::Params& params);
+
+    /*!
+        Устанавливает схему хранения таблицы лога (см. DBLogSchema). Применяется при следующем вызове start().
+            По умолчанию - CLASSIC
+        @param type - схема хранения
+    */
+    void setSchemaType(DBLogSchema::Type type);
+
+    /*!
+        Устанавливает параметры локального хранилища лога для площадок с ненадежной связью с БД (см. DBLogLocalStore).
+            Применяется при следующем вызове start()
+        @param params - параметры локального хранилища
+    */
+    void setLocalStoreParams(const DBLogLocalStore::Params& params);
+
+    /*!
+        Устанавливает параметры статистики логера (интервал вывода отчета в лог). Применяется при следующем вызове start()
+        @param params - параметры статистики
+    */
+    void setStatsParams(const DBLogStats::Params& params);
+
+    /*!
+        Возвращает состояние подключения к БД. В состоянии DEGRADED сообщения сохраняются в дисковую очередь,
+            подключение восстанавливается в фоне. Этот метод потокобезопасный
+        @return состояние подключения. Если логер не запущен - DEGRADED
+    */
+    DBConnectionSupervisor::State connectionState() const;
+
+    /*!
+        Возвращает текущее состояние политики записи пачек для мониторинга. Этот метод потокобезопасный
+        @return состояние. Если логер не запущен - состояние по умолчанию
+    */
+    DBFlushController::State flushState() const;
+
+    /*!
+        Возвращает снимок счетчиков логера для мониторинга: размер очереди, скорость потока, количество записанных,
+            не записанных и обрезанных сообщений, длительность транзакций записи. Этот метод потокобезопасный
+        @return снимок счетчиков. Если логер не запущен - снимок по умолчанию
+    */
+    DBLogStats::Snapshot stats() const;
+
     /*!
         Возвращает true если при выполнении последнего действия произошла ошибка
         @return true - если есть ошибка
@@ -87,6 +200,25 @@ public:
     */
     [[nodiscard]] QString errorString();
 
+    /*!
+        Проверяет будет ли сохранено сообщение категории category. Отладочные сообщения сохраняются только в режиме
+            отладки (debugMode). Порог уровней сборки и времени работы (см. log.h) на сохранение в БД не влияет, он
+            определяет только вывод сообщения в консоль и файл. Позволяет не формировать текст сообщения, которое
+            будет отброшено
+        @param category - категория сообщения
+        @return true - если сообщение будет сохранено
+    */
+    bool isMsgEnabled(Common::TDBLoger::MSG_CODE category) const noexcept;
+
+    /*!
+        Записывает сообщение в лог через буфер текущего потока (см. DBLogCollector). В отличие от sendLogMsg(...)
+            не выделяет память на каждое сообщение и не требует очереди событий Qt. Порядок сообщений сохраняется
+            в пределах одного потока. Метод может вызываться из любого потока, но не одновременно с удалением логера
+        @param category - категория сообщения
+        @param msg - сообщение
+    */
+    void appendLogMsg(Common::TDBLoger::MSG_CODE category, const QString& msg);
+
 signals:
     /*!
         Сигнал при фатальной ошибка при работе с БД (не удалось подключится или выполнить запрос и т.п.
@@ -97,7 +229,10 @@ signals:
 
 public slots:
     /*!
-        Записывает сообщение в лог. Если сообшение не удалось записать в БД, оно будет сохранено в LOG-файй
+        Записывает сообщение в лог. Если сообшение не удалось записать в БД, оно будет сохранено в LOG-файй.
+            Сообщения, для которых isMsgEnabled(...) возвращает false, отбрасываются без обработки.
+            Сообщение помещается в очередь потока записи в БД без блокировок, метод может вызываться из любого потока,
+            но не одновременно с удалением логера.
             Если не планируется использовать Сигнал/Слот, просто используйте даннй метод как метод
         @param category - категория сообщения
         @param msg - сообщение
@@ -106,13 +241,15 @@ public slots:
 
     /*!
         Начать работу логера. Этот метод должен быть вызывн до первого вызова sendLogMsg().
-            В этом методе происходит подключение к БД. Если не планируется использоавть. В сслучае
-            ошибки будет сгенерирован сигнал errorOccurred(...) или isError() вернет true
-            ситему Сигнал/Слот, то просто вызовите этот метод.
+            В этом методе запускается поток записи в БД и ожидается его первая попытка подключения к БД. Если БД недоступна,
+            логер запускается в состоянии DEGRADED (см. connectionState()) и подключается к БД в фоне.
+            Если не планируется использоавть ситему Сигнал/Слот, то просто вызовите этот метод.
     */
     void start();
 
 private:
+    friend class DBLogHandle;
+
     // Удаляемнеиспользуемые конструторы
     TDBLoger() = delete;
     Q_DISABLE_COPY_MOVE(TDBLoger);
@@ -123,7 +260,8 @@ private:
         @param DBConnectionInfo - конфигурация подключения к БД
         @param logDBName - Название таблицы с логами
         @param debugMode - включит/выключить режим отладки. В режиме отладки в консоль перенаправляются все сообщения,
-            поступающие в логер, в обычном режиме - только сообщения об ошибках
+            поступающие в логер, в обычном режиме - только сообщения об ошибках. Отладочные сообщения (DEBUG_CODE)
+            сохраняются в БД только в режиме отладки, в т.ч. в release сборке
         @param sender - название сервиса отправителя логов
         @param parent - указатель на родительский класс
      */
@@ -134,29 +272,103 @@ private:
              QObject* parent = nullptr);
 
     /*!
-        Удаляет устаревшие логи
-    */
-    void clearOldLog();
-
-    /*!
-        Сохраянет очередь запросов к БД в БД
+        Формирует сообщение для записи в БД. Передает сообщение в конвейер логирования и обрезает слишком длинные
+            сообщения
+        @param category - категория сообщения
+        @param msg - сообщение
+        @param record - сюда будет помещено сообщение
+        @return true - если сообщение нужно записать в БД
     */
-    void saveToDB();
+    bool makeRecord(Common::TDBLoger::MSG_CODE category, const QString& msg, LogRecord& record);
 
 private:
     const DBConnectionInfo _dbConnectionInfo;   ///< Параметры подключения к БД
     const QString _logDBName = "Log";           ///< Название таблицы лога
     const bool _debugMode = true;               ///< Флаг режиа отладки
 
-    QSqlDatabase _db;                           ///< БД
-
     const QString _sender;                      ///< Название приложение отправителя логов
 
-    std::queue<QString> _queueMessages;         ///< Очередь сообщений к БД
+    std::unique_ptr<DBLogSink> _sink;           ///< Поток записи сообщений в БД
+    qint64 _stopTimeout = 5000;                 ///< Максимальное время записи оставшихся сообщений при остановке, мс
+    DBFlushController::Params _flushParams;     ///< Политика записи пачек сообщений
+    DBLogSpool::Params _spoolParams;            ///< Параметры дисковой очереди
+    DBBulkLoader::Params _bulkParams;           ///< Параметры массовой загрузки
+    DBLogRetention::Params _retentionParams;    ///< Параметры удаления устаревших логов
+    DBLogSchema::Type _schemaType = DBLogSchema::Type::CLASSIC; ///< Схема хранения таблицы лога
+    DBLogLocalStore::Params _localStoreParams;  ///< Параметры локального хранилища
+    DBLogStats::Params _statsParams;            ///< Параметры статистики
 
     QString _errorString;                       ///< Текст последней ошибки
 
-    bool _isStarted = false;                    ///< Флаг успешного старта логирования
+    std::atomic<bool> _isStarted = false;       ///< Флаг успешного старта логирования
+
+    std::atomic<qsizetype> _handleCount = 0;    ///< Количество существующих описателей DBLogHandle этого логера
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The DBLogHandle class - легковесный описатель логера для потоков-отправителей. Хранит указатель на логер,
+///         поэтому не обращается к реестру логеров при каждом сообщении, и пишет сообщения через буфер текущего
+///         потока (см. TDBLoger::appendLogMsg(...)). Может копироваться и храниться в объектах потока. Описатель не
+///         владеет логером: логер нельзя удалять, пока существуют его описатели (проверяется в отладочной сборке).
+///         Описатель несуществующего логера пуст - сообщения через него отбрасываются
+///
+class DBLogHandle final
+{
+public:
+    /*!
+        Конструктор. Описатель основного логера. Логер должен быть создан (TDBLoger::DBLoger(...)) до создания описателя
+    */
+    DBLogHandle();
+
+    /*!
+        Конструктор. Описатель именованного логера. Логер не создается и должен быть создан до создания описателя
+        @param name - имя логера (см. TDBLoger::namedDBLoger(...))
+    */
+    explicit DBLogHandle(const QString& name);
+
+    DBLogHandle(const DBLogHandle& other) noexcept;
+    DBLogHandle& operator=(const DBLogHandle& other) noexcept;
+
+    /*!
+        Деструктор
+    */
+    ~DBLogHandle();
+
+    /*!
+        Возвращает true если сообщение категории category будет сохранено
+        @param category - категория сообщения
+        @return true - если сообщение будет сохранено
+    */
+    bool isMsgEnabled(Common::TDBLoger::MSG_CODE category) const noexcept { return _loger && _loger->isMsgEnabled(category); }
+
+    /*!
+        Записывает сообщение в лог через буфер текущего потока
+        @param category - категория сообщения
+        @param msg - сообщение
+    */
+    void sendLogMsg(Common::TDBLoger::MSG_CODE category, const QString& msg)
+    {
+        if (_loger)
+        {
+            _loger->appendLogMsg(category, msg);
+        }
+    }
+
+private:
+    /*!
+        Регистрирует описатель в логере
+        @param loger - логер. Может быть nullptr
+    */
+    void attach(TDBLoger* loger) noexcept;
+
+    /*!
+        Отменяет регистрацию описателя в логере
+    */
+    void detach() noexcept;
+
+private:
+    TDBLoger* _loger = nullptr; ///< Логер. nullptr - логер не найден
 
 };
 
@@ -11,150 +11,79 @@
 #include <QtSql/QSqlError>
 #include <QTextStream>
 #include <QTimer>
+#include <QDeadlineTimer>
 
 #include "Common/common.h"
+#include "Common/log.h"
+#include "Common/logpipeline.h"
+#include "Common/logsuppressor.h"
 
 using namespace Common;
 
-static constexpr qsizetype MAX_FILE_LOG_SIZE = 100 * 1024 * 1024; ///< 100 MB максимальный размер файл лога
-static const int MAX_SAVE_LOG_INTERVAL = 30;  ///< Максимальный период хранение файла лога.
-
-void Common::writeLogFile(const QString& prefix, const QString& msg)
+Q_GLOBAL_STATIC(LogSuppressor, logSuppressor);
+
+/*!
+    Передает сообщение в конвейер логирования. Если конвейер уже уничтожен (процесс завершается) -
+        сообщение выводится в stderr непосредственно
+    @param targets - назначения сообщения (набор флагов LogSink::Target)
+    @param level - уровень сообщения
+    @param prefix - префикс сообщения
+    @param msg - сообщение
+*/
+static void writeLog(quint8 targets, LogLevel level, const QString& prefix, const QString& msg)
 {
-    const auto fileInfo = QFileInfo(QString("./Log/%1.log").arg(QCoreApplication::applicationName()));
-    const auto fileName = fileInfo.absoluteFilePath();
-
-    static QMutex mutex;
-    auto locker = QMutexLocker(&mutex);
-
-    /*!
-        Вспомогательный класс исключения записи в файл лога
-     */
-    class WriteLogFileException
-        : public std::runtime_error
-    {
-    public:
-        explicit WriteLogFileException(const QString& what)
-            : std::runtime_error(what.toStdString())
-        {
-        }
-
-    private:
-        WriteLogFileException() = delete;
-    };
-
-    try
+    auto pipeline = LogPipeline::instance();
+    if (pipeline)
     {
-        QDir logDir(fileInfo.absolutePath());
-        if (!logDir.exists())
-        {
-            if (!logDir.mkdir(logDir.absolutePath()))
-            {
-                 throw WriteLogFileException(QString("Cannot make log dir: %2").arg(logDir.absolutePath()));
-            }
-        }
-        if (fileInfo.exists() && fileInfo.size() > MAX_FILE_LOG_SIZE)
-        {
-
-            if (!QFile::rename(fileName, QString("%1_%2").arg(fileName).arg(QDateTime::currentDateTime().toString("yyyy_MM_dd_hh_mm_ss"))))
-            {
-                throw WriteLogFileException(QString("Cannot rename old logs to: %1").arg(fileName));
-            }
-
-            for (const auto& oldFileName: logDir.entryList())
-            {
-                QFileInfo oldFileInfo(oldFileName);
-
-                if (!oldFileInfo.fileName().contains(fileInfo.fileName()))
-                {
-                    continue;
-                }
-
-                if (oldFileInfo.lastModified().daysTo(QDateTime::currentDateTime()) > MAX_SAVE_LOG_INTERVAL)
-                {
-                    QFile oldFile(oldFileName);
-                    if (!oldFile.remove())
-                    {
-                        throw WriteLogFileException(QString("Cannot remove old log file: %1 %2").arg(oldFileInfo.fileName()).arg(fileErrorToString(oldFile.error())));
-                    }
-                }
-            }
-        }
+        pipeline->publish(targets, level, prefix, msg);
 
-        QFile file(fileName);
-        if (!file.open(QFile::WriteOnly | QFile::Append | QFile::Text))
-        {
-            throw WriteLogFileException(QString("Cannot open file to write. %1").arg(fileErrorToString(file.error())));
-        }
-
-        QByteArray tmp = QString("%1 %2 %3\n")
-                .arg(QDateTime::currentDateTime().toString(DATETIME_FORMAT))
-                .arg(prefix)
-                .arg(msg).toUtf8();
-
-        if (file.write(tmp) == -1)
-        {
-             file.close();
-
-             throw WriteLogFileException(QString("Cannot write file. %1").arg(file.errorString()));
-        }
-
-        file.close();
+        return;
     }
 
-    catch (const WriteLogFileException& err)
-    {
-        QTextStream ss(stderr);
-        ss << QString("%1 ERR Message not save to log file: %2. Error: %3. Message: %4 %5\n")
-                       .arg(QDateTime::currentDateTime().toString(SIMPLY_TIME_FORMAT))
-                       .arg(fileName)
-                       .arg(err.what())
-                       .arg(prefix)
-                       .arg(msg);
-    }
+    QTextStream ss(stderr);
+    ss << QString("%1 %2 %3\n")
+              .arg(QTime::currentTime().toString(SIMPLY_TIME_FORMAT))
+              .arg(prefix)
+              .arg(msg);
 }
 
-void Common::writeDebugLogFile(const QString& prefix, const QString& msg)
-{
-#ifdef QT_DEBUG
-    writeLogFile(prefix, msg);
-#else
-    Q_UNUSED(prefix);
-    Q_UNUSED(msg);
-#endif
-}
-
-void Common::saveLogToFile(const QString& msg)
-{
-    writeLogFile("LOG", msg);
-}
-
-
-void Common::messageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+/*!
+    Передает сообщение Qt в конвейер логирования. Назначения сообщения определяются его типом и типом сборки
+    @param type - тип сообщения
+    @param context - контекст сообщения или nullptr если контекст не известен
+    @param msg - сообщение
+*/
+static void writeMessage(QtMsgType type, const QMessageLogContext* context, const QString& msg)
 {
 #ifndef QT_DEBUG
     Q_UNUSED(context);
 #endif
 
     QString stringPrefix;
+    LogLevel level = LogLevel::UND;
     bool writeMsgToFile = false;
     switch (type)
     {
     case QtDebugMsg:
         stringPrefix = "DBG"; //debug
+        level = LogLevel::DBG;
         break;
     case QtInfoMsg:
         stringPrefix = "INF"; //info
+        level = LogLevel::INF;
         break;
     case QtWarningMsg:
         stringPrefix = "WAR"; //warning
+        level = LogLevel::WAR;
         break;
     case QtCriticalMsg:
         stringPrefix = "CRY"; //critical
+        level = LogLevel::CRY;
         writeMsgToFile = true;
         break;
     case QtFatalMsg:
         stringPrefix = "FAT"; //fatal
+        level = LogLevel::FAT;
         writeMsgToFile = true;
         break;
     default:
@@ -162,47 +91,163 @@ void Common::messageOutput(QtMsgType type, const QMessageLogContext &context, co
         writeMsgToFile = true;
         break;
     }
+
+    quint8 targets = 0;
 #ifdef QT_DEBUG
+    Q_UNUSED(writeMsgToFile);
+
+    if (DEBUG_MODE.load(std::memory_order_relaxed) || type != QtDebugMsg)
     {
-        if (DEBUG_MODE || type != QtDebugMsg)
+        if (context)
         {
             stringPrefix += QString(" %3:%4:%5")
-                    .arg(context.file)
-                    .arg(context.line)
-                    .arg(context.function);
-
-            static QMutex mutex;
-            auto locker = QMutexLocker(&mutex);
-
-            QTextStream ss(stderr);
-            ss << QString("%1 %2 %3\n")
-                  .arg(QTime::currentTime().toString(SIMPLY_TIME_FORMAT))
-                  .arg(stringPrefix)
-                  .arg(msg);
+                    .arg(context->file)
+                    .arg(context->line)
+                    .arg(context->function);
         }
+
+        targets |= LogSink::TARGET_CONSOLE;
     }
+
+    //в DEBUG сборке в файл сохраняются все сообщения (см. writeDebugLogFile(...))
+    targets |= LogSink::TARGET_FILE;
 #else
+    if (type != QtDebugMsg)
     {
-        if (type != QtDebugMsg)
+        targets |= LogSink::TARGET_CONSOLE;
+    }
+
+    if (writeMsgToFile)
+    {
+        targets |= LogSink::TARGET_FILE;
+    }
+#endif
+
+    writeLog(targets, level, stringPrefix, msg);
+
+    //после фатального сообщения процесс будет аварийно завершен - дожидаемся записи
+    if (type == QtFatalMsg)
+    {
+        flushLogFile();
+    }
+}
+
+/*!
+    Передает в конвейер логирования итог подавления одинаковых сообщений
+    @param summary - итог
+*/
+static void writeSuppressionSummary(const LogSuppressor::Summary& summary)
+{
+    writeMessage(summary.type, nullptr, QString("Previous message repeated %1 more times in %2 ms: %3")
+                                            .arg(summary.count)
+                                            .arg(summary.interval)
+                                            .arg(summary.msg));
+}
+
+/*!
+    Передает в конвейер логирования итоги истекших окон подавления одинаковых сообщений
+    @param now - текущее монотонное время, мс
+    @param force - true - вывести итоги всех окон, в т.ч. не истекших
+*/
+static void writeSuppressionSummaries(qint64 now, bool force)
+{
+    auto suppressor = logSuppressor();
+    if (!suppressor)
+    {
+        return;
+    }
+
+    for (const auto& summary: suppressor->sweep(now, force))
+    {
+        writeSuppressionSummary(summary);
+    }
+}
+
+/*!
+    Передает сообщение Qt в конвейер логирования, подавляя лавину одинаковых сообщений (см. LogSuppressor).
+        Фатальные сообщения никогда не подавляются
+    @param type - тип сообщения
+    @param context - контекст сообщения или nullptr если контекст не известен
+    @param msg - сообщение
+*/
+static void publishMessage(QtMsgType type, const QMessageLogContext* context, const QString& msg)
+{
+    auto suppressor = logSuppressor();
+    if (type != QtFatalMsg && suppressor)
+    {
+        const auto now = QDeadlineTimer::current().deadline();
+
+        writeSuppressionSummaries(now, false);
+
+        LogSuppressor::Summary summary;
+        const auto isPassed = suppressor->check(type, context ? context->file : nullptr, context ? context->line : 0, msg, now, summary);
+        if (summary.count > 0)
         {
-            static QMutex mutex;
-            auto locker = QMutexLocker(&mutex);
+            writeSuppressionSummary(summary);
+        }
 
-            QTextStream ss(stderr);
-            ss << QString("%1 %2 %3\n").arg(QTime::currentTime().toString(SIMPLY_TIME_FORMAT)).arg(stringPrefix).arg(msg);
+        if (!isPassed)
+        {
+            return;
         }
     }
-#endif
-    if (writeMsgToFile)
+
+    writeMessage(type, context, msg);
+}
+
+void Common::writeLogFile(const QString& prefix, const QString& msg)
+{
+    writeLog(LogSink::TARGET_FILE, LogLevel::UND, prefix, msg);
+}
+
+void Common::flushLogFile()
+{
+    writeSuppressionSummaries(QDeadlineTimer::current().deadline(), true);
+
+    auto pipeline = LogPipeline::instance();
+    if (pipeline)
     {
-        writeLogFile(stringPrefix, msg);
+        pipeline->flush();
     }
-    else
+}
+
+void Common::setLogFileFormat(LogFileFormat format)
+{
+    auto pipeline = LogPipeline::instance();
+    if (pipeline)
     {
-        writeDebugLogFile(stringPrefix, msg);
+        pipeline->fileSink()->setFileFormat(format);
     }
 }
 
+void Common::setLogSuppression(quint32 burstLimit, qint64 window)
+{
+    auto suppressor = logSuppressor();
+    if (suppressor)
+    {
+        suppressor->setParams(burstLimit, window);
+    }
+}
+
+void Common::writeDebugLogFile(const QString& prefix, const QString& msg)
+{
+    LOG_DBG_FILE(prefix, msg);
+}
+
+void Common::saveLogToFile(const QString& msg)
+{
+    writeLogFile("LOG", msg);
+}
+
+void Common::writeLogMessage(QtMsgType type, const QString& msg)
+{
+    publishMessage(type, nullptr, msg);
+}
+
+void Common::messageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    publishMessage(type, &context, msg);
+}
 
 QString Common::fileErrorToString(QFileDevice::FileError error)
 {
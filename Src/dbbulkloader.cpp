@@ -0,0 +1,229 @@
+//Qt
+#include <QtSql/QSqlQuery>
+#include <QTemporaryFile>
+#include <QDateTime>
+#include <QDir>
+
+//My
+#include "Common/common.h"
+
+#include "Common/dbbulkloader.h"
+
+using namespace Common;
+
+/*!
+    Добавляет в буфер поле в формате LOAD DATA по умолчанию: символы '\', TAB, LF, CR и NUL экранируются '\'
+    @param buffer - буфер
+    @param field - значение поля в UTF-8
+*/
+static void appendMySqlField(QByteArray& buffer, const QByteArray& field)
+{
+    for (const auto ch: field)
+    {
+        switch (ch)
+        {
+        case '\\': buffer += "\\\\"; break;
+        case '\t': buffer += "\\t"; break;
+        case '\n': buffer += "\\n"; break;
+        case '\r': buffer += "\\r"; break;
+        case '\0': buffer += "\\0"; break;
+        default: buffer += ch; break;
+        }
+    }
+}
+
+/*!
+    Добавляет в буфер поле CSV. Поле заключается в кавычки, кавычки внутри поля удваиваются
+    @param buffer - буфер
+    @param field - значение поля в UTF-8
+*/
+static void appendCsvField(QByteArray& buffer, const QByteArray& field)
+{
+    buffer += '"';
+    for (const auto ch: field)
+    {
+        if (ch == '"')
+        {
+            buffer += '"';
+        }
+        buffer += ch;
+    }
+    buffer += '"';
+}
+
+/*!
+    Экранирует имя файла для вставки в текст запроса в кавычках
+    @param fileName - имя файла
+    @param isBackslashEscape - true - экранировать символ '\' (MySQL)
+    @return экранированное имя файла
+*/
+static QString quoteFileName(const QString& fileName, bool isBackslashEscape)
+{
+    auto result = QDir::toNativeSeparators(fileName);
+    if (isBackslashEscape)
+    {
+        result.replace('\\', "\\\\");
+    }
+    result.replace('\'', "''");
+
+    return result;
+}
+
+bool DBBulkLoader::isSupported(const QString& driverName)
+{
+    return driverName == "QMYSQL" || driverName == "QODBC";
+}
+
+DBBulkLoader::DBBulkLoader(const Params& params, const DBLogSchema& schema, const QString& sender)
+    : _params(params)
+    , _schema(schema)
+    , _sender(sender.toUtf8())
+{
+}
+
+void DBBulkLoader::load(QSqlDatabase& db, const std::vector<LogRecord>& records) const
+{
+    Q_ASSERT(db.isOpen());
+    Q_ASSERT(isSupported(db.driverName()));
+
+    const bool isMySql = db.driverName() == "QMYSQL";
+    const auto tableName = _params.tableName.isEmpty() ? _schema.tableName() : _params.tableName;
+
+    const QDir tempDir(_params.tempDirName.isEmpty() ? QDir::tempPath() : _params.tempDirName);
+
+    QTemporaryFile file(tempDir.absoluteFilePath(isMySql ? "LogBulk_XXXXXX.tsv" : "LogBulk_XXXXXX.csv"));
+    if (!file.open())
+    {
+        throw SQLException(QString("Cannot create bulk load file: %1. %2").arg(file.fileTemplate()).arg(file.errorString()));
+    }
+
+    const auto data = isMySql ? makeMySqlData(records) : makeCsvData(records);
+    if (file.write(data) != data.size() || !file.flush())
+    {
+        throw SQLException(QString("Cannot write bulk load file: %1. %2").arg(file.fileName()).arg(file.errorString()));
+    }
+
+    QTemporaryFile formatFile;
+    QString queryText;
+    if (isMySql)
+    {
+        queryText = QString("LOAD DATA LOCAL INFILE '%1' INTO TABLE `%2` CHARACTER SET utf8mb4 "
+                            "FIELDS TERMINATED BY '\\t' ESCAPED BY '\\\\' LINES TERMINATED BY '\\n' "
+                            "(`%3`)")
+                        .arg(quoteFileName(file.fileName(), true))
+                        .arg(tableName)
+                        .arg(_schema.columnNames().join("`, `"));
+    }
+    else
+    {
+        //без файла форматирования поля сопоставляются по порядку со всеми столбцами таблицы, включая столбец IDENTITY
+        formatFile.setFileTemplate(tempDir.absoluteFilePath("LogBulk_XXXXXX.xml"));
+
+        const auto format = makeMsSqlFormat();
+        if (!formatFile.open() || formatFile.write(format) != format.size() || !formatFile.flush())
+        {
+            throw SQLException(QString("Cannot write bulk load format file: %1. %2").arg(formatFile.fileName()).arg(formatFile.errorString()));
+        }
+
+        //разделители полей и строк задаются файлом форматирования
+        queryText = QString("BULK INSERT [%1] FROM '%2' "
+                            "WITH (FORMAT = 'CSV', FIELDQUOTE = '\"', FORMATFILE = '%3', CODEPAGE = '65001', TABLOCK)")
+                        .arg(tableName)
+                        .arg(quoteFileName(file.fileName(), false))
+                        .arg(quoteFileName(formatFile.fileName(), false));
+    }
+
+    QSqlQuery query(db);
+    DBQueryExecute(db, query, queryText);
+}
+
+QByteArray DBBulkLoader::makeMsSqlFormat() const
+{
+    const auto columnNames = _schema.columnNames();
+
+    QByteArray result("<?xml version=\"1.0\"?>\n"
+                      "<BCPFORMAT xmlns=\"http://schemas.microsoft.com/sqlserver/2004/bulkload/format\" "
+                      "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n"
+                      " <RECORD>\n");
+    for (qsizetype i = 0; i < columnNames.size(); ++i)
+    {
+        result += QString("  <FIELD ID=\"%1\" xsi:type=\"CharTerm\" TERMINATOR=\"%2\"/>\n")
+                      .arg(i + 1)
+                      .arg(QString(i + 1 < columnNames.size() ? "," : "\\n"))
+                      .toUtf8();
+    }
+    result += " </RECORD>\n"
+              " <ROW>\n";
+    for (qsizetype i = 0; i < columnNames.size(); ++i)
+    {
+        result += QString("  <COLUMN SOURCE=\"%1\" NAME=\"%2\"/>\n").arg(i + 1).arg(columnNames[i]).toUtf8();
+    }
+    result += " </ROW>\n"
+              "</BCPFORMAT>\n";
+
+    return result;
+}
+
+QByteArray DBBulkLoader::makeMySqlData(const std::vector<LogRecord>& records) const
+{
+    const bool isCompact = _schema.type() == DBLogSchema::Type::COMPACT;
+
+    QByteArray result;
+    for (const auto& record: records)
+    {
+        result += makeTimeField(record);
+        result += '\t';
+        result += QByteArray::number(static_cast<int>(record.level));
+        result += '\t';
+        if (isCompact)
+        {
+            result += QByteArray::number(_schema.senderId());
+        }
+        else
+        {
+            appendMySqlField(result, _sender);
+        }
+        result += '\t';
+        appendMySqlField(result, record.msg.toUtf8());
+        result += '\n';
+    }
+
+    return result;
+}
+
+QByteArray DBBulkLoader::makeCsvData(const std::vector<LogRecord>& records) const
+{
+    const bool isCompact = _schema.type() == DBLogSchema::Type::COMPACT;
+
+    QByteArray result;
+    for (const auto& record: records)
+    {
+        result += makeTimeField(record);
+        result += ',';
+        result += QByteArray::number(static_cast<int>(record.level));
+        result += ',';
+        if (isCompact)
+        {
+            result += QByteArray::number(_schema.senderId());
+        }
+        else
+        {
+            appendCsvField(result, _sender);
+        }
+        result += ',';
+        appendCsvField(result, record.msg.toUtf8());
+        result += '\n';
+    }
+
+    return result;
+}
+
+QByteArray DBBulkLoader::makeTimeField(const LogRecord& record) const
+{
+    if (_schema.type() == DBLogSchema::Type::COMPACT)
+    {
+        return QByteArray::number(record.dateTime * 1000);
+    }
+
+    return QDateTime::fromMSecsSinceEpoch(record.dateTime).toString(DATETIME_FORMAT).toUtf8();
+}
@@ -0,0 +1,419 @@
+//STL
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+
+//Qt
+#include <QtSql/QSqlQuery>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QDeadlineTimer>
+#include <QThread>
+
+//My
+#include "Common/dbconnectionpool.h"
+
+using namespace Common;
+
+static std::atomic<quint64> nextPoolId = 1; ///< ИД следующего пула. ИД не переиспользуются
+
+///////////////////////////////////////////////////////////////////////////////
+///     Общие данные пула. Разделяются пулом, арендами и свободными подключениями потоков
+///
+struct DBConnectionPool::Core
+{
+    /*!
+        Конструктор
+        @param id - ИД пула
+        @param connectionInfo - параметры подключения к БД
+        @param name - название пула
+        @param params - параметры пула
+    */
+    Core(quint64 id, const DBConnectionInfo& connectionInfo, const QString& name, const Params& params)
+        : id(id)
+        , connectionInfo(connectionInfo)
+        , name(name)
+        , params(params)
+    {
+    }
+
+    const quint64 id;                           ///< ИД пула
+    const DBConnectionInfo connectionInfo;      ///< Параметры подключения к БД
+    const QString name;                         ///< Название пула
+    const Params params;                        ///< Параметры пула
+
+    mutable QMutex mutex;                       ///< Мьютекс счетчиков подключений
+    QWaitCondition releasedCondition;           ///< Освобождение места в пуле
+    qsizetype totalCount = 0;                   ///< Количество открытых подключений. Доступ под mutex
+    qsizetype leasedCount = 0;                  ///< Количество подключений в аренде. Доступ под mutex
+    qsizetype idleCount = 0;                    ///< Количество свободных подключений во всех потоках. Доступ под mutex
+    qsizetype waiterCount = 0;                  ///< Количество потоков, ожидающих места в пуле. Доступ под mutex
+    bool isClosed = false;                      ///< Пул удален. Доступ под mutex
+
+    std::atomic<qint64> connectionNumber = 0;   ///< Номер последнего открытого подключения
+    std::atomic<qint64> closedCount = 0;        ///< Количество закрытых подключений
+    std::atomic<qint64> waitCount = 0;          ///< Количество ожиданий места в пуле
+    std::atomic<qint64> timeoutCount = 0;       ///< Количество отказов по таймауту ожидания
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     class DBConnectionPool::Lease
+///
+DBConnectionPool::Lease::Lease(const std::shared_ptr<Core>& core, Connection&& connection)
+    : _core(core)
+    , _connection(std::move(connection))
+{
+}
+
+DBConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : _core(std::move(other._core))
+    , _connection(std::move(other._connection))
+    , _isValid(other._isValid)
+{
+    //QSqlDatabase копируется при перемещении: ссылка на подключение не должна оставаться в пустой аренде
+    other._core.reset();
+    other._connection = Connection();
+}
+
+DBConnectionPool::Lease& DBConnectionPool::Lease::operator=(Lease&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+
+        _core = std::move(other._core);
+        _connection = std::move(other._connection);
+        _isValid = other._isValid;
+
+        other._core.reset();
+        other._connection = Connection();
+    }
+
+    return *this;
+}
+
+DBConnectionPool::Lease::~Lease()
+{
+    release();
+}
+
+QSqlDatabase& DBConnectionPool::Lease::db() noexcept
+{
+    Q_ASSERT(_core);
+
+    return _connection.db;
+}
+
+void DBConnectionPool::Lease::invalidate() noexcept
+{
+    _isValid = false;
+}
+
+void DBConnectionPool::Lease::release()
+{
+    if (!_core)
+    {
+        return;
+    }
+
+    Q_ASSERT(_connection.threadId == QThread::currentThreadId());
+
+    const auto core = std::move(_core);
+
+    DBConnectionPool::release(core, std::move(_connection), _isValid);
+
+    _connection = Connection();
+    _isValid = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class DBConnectionPool::ThreadSlot
+///
+DBConnectionPool::ThreadSlot::ThreadSlot(const std::shared_ptr<Core>& core)
+    : core(core)
+{
+}
+
+DBConnectionPool::ThreadSlot::~ThreadSlot()
+{
+    for (auto& connection: idle)
+    {
+        DBConnectionPool::close(*core, connection, true);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class DBConnectionPool
+///
+DBConnectionPool::DBConnectionPool(const DBConnectionInfo& connectionInfo, const QString& name, const Params& params)
+    : _core(std::make_shared<Core>(nextPoolId.fetch_add(1, std::memory_order_relaxed), connectionInfo, name, params))
+{
+    Q_ASSERT(params.maxSize > 0);
+}
+
+DBConnectionPool::~DBConnectionPool()
+{
+    {
+        QMutexLocker<QMutex> locker(&_core->mutex);
+
+        _core->isClosed = true;
+    }
+
+    //подключения других потоков закрываются этими потоками: при возврате аренды или при завершении потока
+    threadSlots().erase(_core->id);
+}
+
+DBConnectionPool::Lease DBConnectionPool::acquire()
+{
+    auto& slot = threadSlot(_core);
+    const auto now = QDeadlineTimer::current().deadline();
+
+    //последнее возвращенное подключение используется первым: оно реже требует проверки. Остальные закрываются
+    //по простою после выдачи, чтобы при наличии ожидающих потоков не закрыть и то подключение, которое будет выдано
+    while (!slot.idle.empty())
+    {
+        auto connection = std::move(slot.idle.back());
+        slot.idle.pop_back();
+
+        if (validate(*_core, connection, now))
+        {
+            {
+                QMutexLocker<QMutex> locker(&_core->mutex);
+
+                --_core->idleCount;
+                ++_core->leasedCount;
+            }
+
+            evictIdle(slot, now);
+
+            return Lease(_core, std::move(connection));
+        }
+
+        close(*_core, connection, true);
+    }
+
+    {
+        QMutexLocker<QMutex> locker(&_core->mutex);
+
+        if (_core->totalCount >= _core->params.maxSize)
+        {
+            _core->waitCount.fetch_add(1, std::memory_order_relaxed);
+            ++_core->waiterCount;
+
+            const QDeadlineTimer deadline(_core->params.acquireTimeout);
+            while (_core->totalCount >= _core->params.maxSize && !deadline.hasExpired())
+            {
+                _core->releasedCondition.wait(&_core->mutex, deadline);
+            }
+
+            --_core->waiterCount;
+
+            if (_core->totalCount >= _core->params.maxSize)
+            {
+                _core->timeoutCount.fetch_add(1, std::memory_order_relaxed);
+
+                throw SQLException(QString("Connection pool %1 is exhausted. Max size: %2. Idle in other threads: %3. Timeout: %4 ms")
+                                       .arg(_core->name).arg(_core->params.maxSize).arg(_core->idleCount).arg(_core->params.acquireTimeout));
+            }
+        }
+
+        //место резервируется до подключения, чтобы ожидание ответа БД не выполнялось под блокировкой
+        ++_core->totalCount;
+        ++_core->leasedCount;
+    }
+
+    Connection connection;
+    connection.threadId = QThread::currentThreadId();
+
+    const auto number = _core->connectionNumber.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    try
+    {
+        connectToDB(connection.db, _core->connectionInfo, QString("%1_%2").arg(_core->name).arg(number));
+    }
+    catch (const SQLException&)
+    {
+        QMutexLocker<QMutex> locker(&_core->mutex);
+
+        --_core->totalCount;
+        --_core->leasedCount;
+        _core->releasedCondition.wakeOne();
+
+        throw;
+    }
+
+    return Lease(_core, std::move(connection));
+}
+
+void DBConnectionPool::evictIdle()
+{
+    evictIdle(threadSlot(_core), QDeadlineTimer::current().deadline());
+}
+
+DBConnectionPool::State DBConnectionPool::state() const
+{
+    State result;
+    {
+        QMutexLocker<QMutex> locker(&_core->mutex);
+
+        result.totalCount = _core->totalCount;
+        result.leasedCount = _core->leasedCount;
+        result.idleCount = _core->idleCount;
+    }
+
+    result.createdCount = _core->connectionNumber.load(std::memory_order_relaxed);
+    result.closedCount = _core->closedCount.load(std::memory_order_relaxed);
+    result.waitCount = _core->waitCount.load(std::memory_order_relaxed);
+    result.timeoutCount = _core->timeoutCount.load(std::memory_order_relaxed);
+
+    return result;
+}
+
+DBConnectionPool::ThreadSlots& DBConnectionPool::threadSlots()
+{
+    //удаляются при завершении потока, закрывая его свободные подключения в нем самом
+    thread_local ThreadSlots slots;
+
+    return slots;
+}
+
+DBConnectionPool::ThreadSlot& DBConnectionPool::threadSlot(const std::shared_ptr<Core>& core)
+{
+    auto& slots = threadSlots();
+    const auto now = QDeadlineTimer::current().deadline();
+
+    //свободные подключения всех пулов потока проверяются при обращении потока к любому пулу: подключения удаленных
+    //пулов и пулов с ожидающими потоками закрываются, не дожидаясь обращения к этому пулу или завершения потока
+    for (auto it = slots.begin(); it != slots.end(); )
+    {
+        auto& otherSlot = *it->second;
+        if (otherSlot.core != core)
+        {
+            evictIdle(otherSlot, now);
+        }
+
+        bool isClosed = false;
+        {
+            QMutexLocker<QMutex> locker(&otherSlot.core->mutex);
+
+            isClosed = otherSlot.core->isClosed;
+        }
+
+        it = isClosed ? slots.erase(it) : std::next(it);
+    }
+
+    auto& slot = slots[core->id];
+    if (!slot)
+    {
+        slot = std::make_unique<ThreadSlot>(core);
+    }
+
+    return *slot;
+}
+
+void DBConnectionPool::release(const std::shared_ptr<Core>& core, Connection&& connection, bool isValid)
+{
+    const auto now = QDeadlineTimer::current().deadline();
+    connection.lastUsedTime = now;
+
+    bool isKeep = isValid && connection.db.isOpen();
+    {
+        QMutexLocker<QMutex> locker(&core->mutex);
+
+        --core->leasedCount;
+
+        //место освобождается для потоков, которые не могут использовать свободные подключения этого потока
+        if (core->waiterCount > 0 || core->isClosed)
+        {
+            isKeep = false;
+        }
+
+        if (isKeep)
+        {
+            ++core->idleCount;
+        }
+    }
+
+    if (!isKeep)
+    {
+        close(*core, connection, false);
+
+        return;
+    }
+
+    auto& slot = threadSlot(core);
+    slot.idle.push_back(std::move(connection));
+
+    evictIdle(slot, now);
+}
+
+void DBConnectionPool::evictIdle(ThreadSlot& slot, qint64 now)
+{
+    if (slot.idle.empty())
+    {
+        return;
+    }
+
+    //пул удален или другие потоки ждут места в пуле - все свободные подключения потока закрываются
+    bool isShrink = false;
+    {
+        QMutexLocker<QMutex> locker(&slot.core->mutex);
+
+        isShrink = slot.core->isClosed || slot.core->waiterCount > 0;
+    }
+
+    const auto minIdle = isShrink ? 0 : std::max<qsizetype>(slot.core->params.minIdle, 0);
+
+    //подключения упорядочены по времени возврата: самые старые - в начале
+    qsizetype count = 0;
+    while (static_cast<qsizetype>(slot.idle.size()) - count > minIdle
+           && (isShrink || now - slot.idle[count].lastUsedTime >= slot.core->params.idleTimeout))
+    {
+        close(*slot.core, slot.idle[count], true);
+
+        ++count;
+    }
+
+    slot.idle.erase(slot.idle.begin(), slot.idle.begin() + count);
+}
+
+bool DBConnectionPool::validate(const Core& core, Connection& connection, qint64 now)
+{
+    if (!connection.db.isOpen())
+    {
+        return false;
+    }
+
+    if (core.params.validateInterval > 0 && now - connection.lastUsedTime < core.params.validateInterval)
+    {
+        return true;
+    }
+
+    QSqlQuery query(connection.db);
+    if (!query.exec(core.params.validationQuery))
+    {
+        qWarning() << QString("Connection %1 from pool %2 is broken and will be reopened. Error: %3")
+                          .arg(connection.db.connectionName()).arg(core.name).arg(executeDBErrorString(connection.db, query));
+
+        return false;
+    }
+
+    return true;
+}
+
+void DBConnectionPool::close(Core& core, Connection& connection, bool isIdle)
+{
+    closeDB(connection.db);
+
+    core.closedCount.fetch_add(1, std::memory_order_relaxed);
+
+    QMutexLocker<QMutex> locker(&core.mutex);
+
+    --core.totalCount;
+    if (isIdle)
+    {
+        --core.idleCount;
+    }
+    core.releasedCondition.wakeOne();
+}
@@ -0,0 +1,142 @@
+//STL
+#include <algorithm>
+
+//Qt
+#include <QMutexLocker>
+#include <QDeadlineTimer>
+#include <QRandomGenerator>
+
+//My
+#include "Common/logcrashbuffer.h"
+
+#include "Common/dbconnectionsupervisor.h"
+
+using namespace Common;
+
+static const qint64 INITIAL_RECONNECT_DELAY = 500;      ///< Интервал первой попытки переподключения, мс
+static const qint64 MAX_RECONNECT_DELAY = 30 * 1000;    ///< 30 с. Максимальный интервал попыток переподключения, мс
+static const qint64 RECONNECT_JITTER_PERCENT = 20;      ///< Случайный разброс интервала попыток, %
+
+/*!
+    Добавляет к интервалу случайный разброс +/- RECONNECT_JITTER_PERCENT
+    @param delay - интервал, мс
+    @return интервал с разбросом, мс
+*/
+static qint64 addJitter(qint64 delay)
+{
+    const auto jitter = delay * RECONNECT_JITTER_PERCENT / 100;
+
+    return delay - jitter + static_cast<qint64>(QRandomGenerator::global()->bounded(static_cast<quint64>(2 * jitter + 1)));
+}
+
+DBConnectionSupervisor::DBConnectionSupervisor(const DBConnectionInfo& connectionInfo, const QString& connectionName)
+    : _connectionInfo(connectionInfo)
+    , _connectionName(connectionName)
+{
+    _thread.reset(QThread::create([this](){ run(); }));
+    _thread->setObjectName(QString("DBSupervisor_%1").arg(_connectionName));
+    _thread->start(QThread::LowPriority);
+}
+
+DBConnectionSupervisor::~DBConnectionSupervisor()
+{
+    {
+        QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+        _isStopped = true;
+        _wakeUpCondition.wakeAll();
+    }
+
+    _thread->wait();
+}
+
+void DBConnectionSupervisor::reportFailure(const QString& errorString)
+{
+    auto expected = State::CONNECTED;
+    if (!_state.compare_exchange_strong(expected, State::DEGRADED, std::memory_order_acq_rel))
+    {
+        return;
+    }
+
+    _failureCount.fetch_add(1, std::memory_order_relaxed);
+
+    qWarning() << QString("Connection to DB %1:%2 is degraded. Reconnecting in background. Error: %3")
+                      .arg(_connectionInfo.dbName).arg(_connectionName).arg(errorString);
+
+    QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+    _wakeUpCondition.wakeAll();
+}
+
+void DBConnectionSupervisor::run()
+{
+    //аварийный буфер лога сохраняется и при переполнении стека этого потока
+    LogCrashBuffer::installThreadStack();
+
+    QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+    qint64 delay = INITIAL_RECONNECT_DELAY;
+    while (!_isStopped)
+    {
+        if (isAvailable())
+        {
+            delay = INITIAL_RECONNECT_DELAY;
+
+            _wakeUpCondition.wait(&_wakeUpMutex);
+
+            continue;
+        }
+
+        //пробуждение до истечения интервала возможно только при остановке
+        const QDeadlineTimer deadline(addJitter(delay));
+        while (!_isStopped && !deadline.hasExpired())
+        {
+            _wakeUpCondition.wait(&_wakeUpMutex, deadline);
+        }
+
+        if (_isStopped)
+        {
+            break;
+        }
+
+        locker.unlock();
+
+        QString errorString;
+        const bool isConnected = probe(errorString);
+
+        locker.relock();
+
+        if (isConnected)
+        {
+            _state.store(State::CONNECTED, std::memory_order_release);
+
+            qInfo() << QString("Connection to DB %1:%2 is restored").arg(_connectionInfo.dbName).arg(_connectionName);
+        }
+        else
+        {
+            delay = std::min(delay * 2, MAX_RECONNECT_DELAY);
+
+            qDebug() << QString("Reconnect to DB %1:%2 failed. Next attempt in %3 ms. Error: %4")
+                            .arg(_connectionInfo.dbName).arg(_connectionName).arg(delay).arg(errorString);
+        }
+    }
+}
+
+bool DBConnectionSupervisor::probe(QString& errorString) const
+{
+    QSqlDatabase db;
+    try
+    {
+        connectToDB(db, _connectionInfo, QString("%1_Probe").arg(_connectionName));
+    }
+    catch (const SQLException& err)
+    {
+        errorString = err.what();
+
+        return false;
+    }
+
+    closeDB(db);
+
+    return true;
+}
@@ -0,0 +1,114 @@
+//STL
+#include <algorithm>
+
+//My
+#include "Common/dbflushcontroller.h"
+
+using namespace Common;
+
+static const qint64 COMMIT_TIME_SMOOTHING = 4;  ///< Вес предыдущего значения при сглаживании времени коммита (new = (old * (N - 1) + cur) / N)
+
+DBFlushController::DBFlushController()
+{
+    setParams(Params());
+}
+
+void DBFlushController::setParams(const Params& params)
+{
+    Q_ASSERT(params.maxLatency > 0);
+    Q_ASSERT(params.maxBytes > 0);
+    Q_ASSERT(params.minBatchSize > 0);
+    Q_ASSERT(params.minBatchSize <= params.maxBatchSize);
+
+    _params = params;
+
+    _batchSize.store(_params.minBatchSize, std::memory_order_relaxed);
+}
+
+void DBFlushController::add(qint64 bytes, qint64 now)
+{
+    const auto pendingRows = _pendingRows.load(std::memory_order_relaxed);
+    if (pendingRows == 0)
+    {
+        _firstPendingTime = now;
+    }
+
+    _pendingRows.store(pendingRows + 1, std::memory_order_relaxed);
+    _pendingBytes.store(_pendingBytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+}
+
+bool DBFlushController::isFlushNeeded(qint64 now) const
+{
+    const auto pendingRows = _pendingRows.load(std::memory_order_relaxed);
+    if (pendingRows == 0)
+    {
+        return false;
+    }
+
+    return pendingRows >= _batchSize.load(std::memory_order_relaxed)
+        || _pendingBytes.load(std::memory_order_relaxed) >= _params.maxBytes
+        || now - _firstPendingTime >= _params.maxLatency;
+}
+
+void DBFlushController::flushed(qint64 commitTime, bool isSuccess)
+{
+    const auto rows = _pendingRows.load(std::memory_order_relaxed);
+
+    _pendingRows.store(0, std::memory_order_relaxed);
+    _pendingBytes.store(0, std::memory_order_relaxed);
+
+    if (!isSuccess)
+    {
+        _failCount.fetch_add(1, std::memory_order_relaxed);
+
+        return;
+    }
+
+    _commitCount.fetch_add(1, std::memory_order_relaxed);
+    _rowCount.fetch_add(rows, std::memory_order_relaxed);
+
+    const auto prevCommitTime = _commitTime.load(std::memory_order_relaxed);
+    const auto smoothCommitTime = _commitCount.load(std::memory_order_relaxed) == 1
+        ? commitTime
+        : (prevCommitTime * (COMMIT_TIME_SMOOTHING - 1) + commitTime) / COMMIT_TIME_SMOOTHING;
+    _commitTime.store(smoothCommitTime, std::memory_order_relaxed);
+
+    //размер меняется только по полным пачкам: пачка, записанная по таймеру, не говорит о пропускной способности БД
+    const auto batchSize = _batchSize.load(std::memory_order_relaxed);
+    if (rows < batchSize)
+    {
+        return;
+    }
+
+    if (smoothCommitTime > _params.targetCommitTime)
+    {
+        //БД медленная - стоимость коммита делится на большее количество строк
+        _batchSize.store(std::min(batchSize * 2, _params.maxBatchSize), std::memory_order_relaxed);
+    }
+    else if (smoothCommitTime * 2 < _params.targetCommitTime)
+    {
+        //БД быстрая - пачки уменьшаются, чтобы сообщения быстрее попадали в БД
+        _batchSize.store(std::max(batchSize * 3 / 4, _params.minBatchSize), std::memory_order_relaxed);
+    }
+}
+
+void DBFlushController::reset()
+{
+    _pendingRows.store(0, std::memory_order_relaxed);
+    _pendingBytes.store(0, std::memory_order_relaxed);
+    _firstPendingTime = 0;
+}
+
+DBFlushController::State DBFlushController::state() const
+{
+    State result;
+    result.batchSize = _batchSize.load(std::memory_order_relaxed);
+    result.pendingRows = _pendingRows.load(std::memory_order_relaxed);
+    result.pendingBytes = _pendingBytes.load(std::memory_order_relaxed);
+    result.commitTime = _commitTime.load(std::memory_order_relaxed);
+    result.commitCount = _commitCount.load(std::memory_order_relaxed);
+    result.rowCount = _rowCount.load(std::memory_order_relaxed);
+    result.failCount = _failCount.load(std::memory_order_relaxed);
+
+    return result;
+}
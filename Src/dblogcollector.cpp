@@ -0,0 +1,129 @@
+//STL
+#include <iterator>
+#include <unordered_map>
+
+//Qt
+#include <QMutexLocker>
+
+//My
+#include "Common/dblogcollector.h"
+
+using namespace Common;
+
+static std::atomic<quint64> nextCollectorId = 1; ///< Идентификатор следующего сборщика. Идентификаторы не переиспользуются
+
+DBLogCollector::DBLogCollector()
+    : _id(nextCollectorId.fetch_add(1, std::memory_order_relaxed))
+{
+}
+
+DBLogCollector::~DBLogCollector()
+{
+    close();
+}
+
+qsizetype DBLogCollector::append(LogRecord&& record)
+{
+    if (_isClosed.load(std::memory_order_acquire))
+    {
+        return 0;
+    }
+
+    auto& buffer = threadBuffer();
+
+    QMutexLocker<QMutex> locker(&buffer.mutex);
+
+    if (buffer.isClosed)
+    {
+        return 0;
+    }
+
+    buffer.records.push_back(std::move(record));
+
+    return static_cast<qsizetype>(buffer.records.size());
+}
+
+void DBLogCollector::drain(std::vector<LogRecord>& records)
+{
+    QMutexLocker<QMutex> buffersLocker(&_buffersMutex);
+
+    for (auto it = _buffers.begin(); it != _buffers.end(); )
+    {
+        //проверка до сбора: если поток уже завершился, после сбора в его буфере не появится новых сообщений
+        const bool isThreadFinished = it->use_count() == 1;
+
+        {
+            //буфер обменивается с пустым вектором, чтобы не задерживать поток-отправитель на время переноса сообщений
+            QMutexLocker<QMutex> locker(&(*it)->mutex);
+
+            (*it)->records.swap(_spare);
+        }
+
+        std::move(_spare.begin(), _spare.end(), std::back_inserter(records));
+        _spare.clear();
+
+        if (isThreadFinished)
+        {
+            it = _buffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void DBLogCollector::close()
+{
+    _isClosed.store(true, std::memory_order_release);
+
+    QMutexLocker<QMutex> buffersLocker(&_buffersMutex);
+
+    for (const auto& buffer: _buffers)
+    {
+        QMutexLocker<QMutex> locker(&buffer->mutex);
+
+        buffer->isClosed = true;
+    }
+}
+
+DBLogCollector::ThreadBuffer& DBLogCollector::threadBuffer()
+{
+    //буферы потока по идентификатору сборщика. Удаляются при завершении потока
+    thread_local std::unordered_map<quint64, PThreadBuffer> threadBuffers;
+
+    const auto it = threadBuffers.find(_id);
+    if (it != threadBuffers.end())
+    {
+        return *it->second;
+    }
+
+    //буферы закрытых сборщиков больше не нужны
+    for (auto closedIt = threadBuffers.begin(); closedIt != threadBuffers.end(); )
+    {
+        bool isClosed = false;
+        {
+            QMutexLocker<QMutex> locker(&closedIt->second->mutex);
+
+            isClosed = closedIt->second->isClosed;
+        }
+
+        closedIt = isClosed ? threadBuffers.erase(closedIt) : std::next(closedIt);
+    }
+
+    auto buffer = std::make_shared<ThreadBuffer>();
+    {
+        QMutexLocker<QMutex> buffersLocker(&_buffersMutex);
+
+        if (_isClosed.load(std::memory_order_acquire))
+        {
+            buffer->isClosed = true;
+        }
+        else
+        {
+            _buffers.push_back(buffer);
+        }
+    }
+
+    return *threadBuffers.emplace(_id, std::move(buffer)).first->second;
+}
@@ -0,0 +1,327 @@
+//STL
+#include <algorithm>
+
+//Qt
+#include <QtSql/QSqlQuery>
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QDeadlineTimer>
+#include <QVariantList>
+#include <QFileInfo>
+#include <QDir>
+
+//My
+#include "Common/logcrashbuffer.h"
+
+#include "Common/dbloglocalstore.h"
+
+using namespace Common;
+
+static const qint64 INITIAL_SHIP_RETRY_DELAY = 500;     ///< Интервал первой повторной попытки пересылки после ошибки, мс
+static const qint64 MAX_SHIP_RETRY_DELAY = 30 * 1000;   ///< 30 с. Максимальный интервал повторных попыток пересылки, мс
+
+DBLogLocalStore::DBLogLocalStore(const Params& params, const DBConnectionInfo& connectionInfo, const DBLogSchema& schema, const QString& sender)
+    : _params(params)
+    , _connectionInfo(connectionInfo)
+    , _schema(schema)
+    , _sender(sender)
+{
+    _fileName = _params.fileName.isEmpty()
+        ? QFileInfo(QString("./Log/%1_%2.db").arg(QCoreApplication::applicationName()).arg(_schema.tableName())).absoluteFilePath()
+        : QFileInfo(_params.fileName).absoluteFilePath();
+}
+
+DBLogLocalStore::~DBLogLocalStore()
+{
+    if (_thread)
+    {
+        {
+            QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+            _isStopped = true;
+            _wakeUpCondition.wakeAll();
+        }
+
+        _thread->wait();
+    }
+
+    closeDB(_db);
+}
+
+bool DBLogLocalStore::open(QString& errorString)
+{
+    Q_ASSERT(!_thread);
+
+    if (!QDir().mkpath(QFileInfo(_fileName).absolutePath()))
+    {
+        errorString = QString("Cannot make local log store dir: %1").arg(QFileInfo(_fileName).absolutePath());
+
+        return false;
+    }
+
+    try
+    {
+        connectToLocalDB(_db, QString("%1_Local").arg(_schema.tableName()));
+
+        //AUTOINCREMENT: ИД не переиспользуются после удаления пересланных строк и всегда больше отметки пересылки
+        DBQueryExecuteAutoCommit(_db, "CREATE TABLE IF NOT EXISTS \"Log\" ("
+                                "\"Id\" INTEGER PRIMARY KEY AUTOINCREMENT, "
+                                "\"DateTime\" INTEGER NOT NULL, "
+                                "\"Category\" INTEGER NOT NULL, "
+                                "\"Msg\" TEXT NOT NULL)");
+
+        DBQueryExecuteAutoCommit(_db, "CREATE TABLE IF NOT EXISTS \"ShipState\" ("
+                                "\"Id\" INTEGER PRIMARY KEY CHECK (\"Id\" = 1), "
+                                "\"HighWaterMark\" INTEGER NOT NULL)");
+
+        DBQueryExecuteAutoCommit(_db, "INSERT OR IGNORE INTO \"ShipState\" (\"Id\", \"HighWaterMark\") VALUES (1, 0)");
+    }
+    catch (const SQLException& err)
+    {
+        errorString = QString("Cannot open local log store %1. Error: %2").arg(_fileName).arg(err.what());
+
+        closeDB(_db);
+
+        return false;
+    }
+
+    _thread.reset(QThread::create([this](){ run(); }));
+    _thread->setObjectName(QString("DBLogShipper_%1").arg(_schema.tableName()));
+    _thread->start(QThread::LowPriority);
+
+    return true;
+}
+
+bool DBLogLocalStore::insert(const std::vector<LogRecord>& records, QString& errorString)
+{
+    Q_ASSERT(_db.isOpen());
+
+    QVariantList dateTimes;
+    QVariantList categories;
+    QVariantList msgs;
+    dateTimes.reserve(records.size());
+    categories.reserve(records.size());
+    msgs.reserve(records.size());
+
+    for (const auto& record: records)
+    {
+        dateTimes.push_back(record.dateTime);
+        categories.push_back(static_cast<int>(record.level));
+        msgs.push_back(record.msg);
+    }
+
+    try
+    {
+        DBTransaction transaction(_db);
+
+        QSqlQuery query(_db);
+        DBQueryPrepare(_db, query, "INSERT INTO \"Log\" (\"DateTime\", \"Category\", \"Msg\") VALUES (?, ?, ?)");
+
+        query.addBindValue(dateTimes);
+        query.addBindValue(categories);
+        query.addBindValue(msgs);
+
+        DBQueryExecuteBatch(_db, query);
+
+        transaction.commit();
+    }
+    catch (const SQLException& err)
+    {
+        errorString = err.what();
+
+        return false;
+    }
+
+    _storedRows.fetch_add(static_cast<qint64>(records.size()), std::memory_order_relaxed);
+
+    return true;
+}
+
+DBLogLocalStore::State DBLogLocalStore::state() const
+{
+    State result;
+    result.storedRows = _storedRows.load(std::memory_order_relaxed);
+    result.shippedRows = _shippedRows.load(std::memory_order_relaxed);
+    result.highWaterMark = _highWaterMark.load(std::memory_order_relaxed);
+    result.failCount = _failCount.load(std::memory_order_relaxed);
+
+    return result;
+}
+
+void DBLogLocalStore::run()
+{
+    //аварийный буфер лога сохраняется и при переполнении стека этого потока
+    LogCrashBuffer::installThreadStack();
+
+    //схема центральной БД получает ИД отправителя в своем подключении, поэтому у потока пересылки своя копия
+    auto schema = _schema;
+
+    QSqlDatabase localDB;
+    QSqlDatabase centralDB;
+
+    qint64 delay = 0;
+    bool isFailed = false;
+    while (waitFor(delay))
+    {
+        try
+        {
+            if (!localDB.isOpen())
+            {
+                connectToLocalDB(localDB, QString("%1_LocalShip").arg(_schema.tableName()));
+            }
+
+            //пока есть сообщения, порции пересылаются без пауз
+            const auto shippedCount = ship(localDB, centralDB, schema);
+            delay = shippedCount < _params.shipBatchSize ? _params.shipInterval : 0;
+
+            if (isFailed)
+            {
+                isFailed = false;
+
+                qInfo() << QString("Shipping of the local log store %1 to DB %2 is restored").arg(_fileName).arg(_connectionInfo.dbName);
+            }
+        }
+        catch (const SQLException& err)
+        {
+            _failCount.fetch_add(1, std::memory_order_relaxed);
+
+            //подключения могли быть разорваны - они будут переоткрыты при следующей попытке
+            closeDB(centralDB);
+            closeDB(localDB);
+
+            delay = isFailed ? std::min(delay * 2, MAX_SHIP_RETRY_DELAY) : INITIAL_SHIP_RETRY_DELAY;
+
+            if (!isFailed)
+            {
+                isFailed = true;
+
+                qWarning() << QString("Cannot ship the local log store %1 to DB %2. Retrying in background. Error: %3")
+                                  .arg(_fileName).arg(_connectionInfo.dbName).arg(err.what());
+            }
+        }
+    }
+
+    closeDB(centralDB);
+    closeDB(localDB);
+}
+
+qint64 DBLogLocalStore::ship(QSqlDatabase& localDB, QSqlDatabase& centralDB, DBLogSchema& schema)
+{
+    Q_ASSERT(localDB.isOpen());
+
+    QSqlQuery stateQuery(localDB);
+    DBQueryExecute(localDB, stateQuery, "SELECT \"HighWaterMark\" FROM \"ShipState\" WHERE \"Id\" = 1");
+    const auto highWaterMark = stateQuery.next() ? stateQuery.value(0).toLongLong() : 0;
+    stateQuery.finish();
+
+    _highWaterMark.store(highWaterMark, std::memory_order_relaxed);
+
+    QSqlQuery selectQuery(localDB);
+    selectQuery.setForwardOnly(true);
+    DBQueryPrepare(localDB, selectQuery, "SELECT \"Id\", \"DateTime\", \"Category\", \"Msg\" FROM \"Log\" WHERE \"Id\" > ? ORDER BY \"Id\" LIMIT ?");
+    selectQuery.addBindValue(highWaterMark);
+    selectQuery.addBindValue(_params.shipBatchSize);
+    if (!selectQuery.exec())
+    {
+        throw SQLException(executeDBErrorString(localDB, selectQuery));
+    }
+
+    std::vector<LogRecord> records;
+    records.reserve(static_cast<size_t>(_params.shipBatchSize));
+    qint64 lastId = highWaterMark;
+    while (selectQuery.next())
+    {
+        LogRecord record;
+        lastId = selectQuery.value(0).toLongLong();
+        record.dateTime = selectQuery.value(1).toLongLong();
+        record.targets = LogSink::TARGET_DB;
+        record.level = static_cast<LogLevel>(selectQuery.value(2).toInt());
+        record.msg = selectQuery.value(3).toString();
+
+        records.push_back(std::move(record));
+    }
+    selectQuery.finish();
+
+    if (records.empty())
+    {
+        return 0;
+    }
+
+    if (!centralDB.isOpen())
+    {
+        connectToDB(centralDB, _connectionInfo, QString("%1_Ship").arg(_schema.tableName()));
+
+        schema.prepare(centralDB, _sender);
+    }
+
+    {
+        //запросы освобождаются при выходе из области, до закрытия подключения при ошибке
+        DBStatementCache statements(centralDB);
+        DBTransaction transaction(centralDB);
+
+        schema.insertRecords(centralDB, statements, records, _sender);
+
+        transaction.commit();
+    }
+
+    //отметка сдвигается и пересланные строки удаляются одной локальной транзакцией
+    {
+        DBTransaction transaction(localDB);
+
+        QSqlQuery updateQuery(localDB);
+        DBQueryPrepare(localDB, updateQuery, "UPDATE \"ShipState\" SET \"HighWaterMark\" = ? WHERE \"Id\" = 1");
+        updateQuery.addBindValue(lastId);
+        if (!updateQuery.exec())
+        {
+            throw SQLException(executeDBErrorString(localDB, updateQuery));
+        }
+
+        QSqlQuery deleteQuery(localDB);
+        DBQueryPrepare(localDB, deleteQuery, "DELETE FROM \"Log\" WHERE \"Id\" <= ?");
+        deleteQuery.addBindValue(lastId);
+        if (!deleteQuery.exec())
+        {
+            throw SQLException(executeDBErrorString(localDB, deleteQuery));
+        }
+
+        transaction.commit();
+    }
+
+    const auto shippedCount = static_cast<qint64>(records.size());
+
+    _highWaterMark.store(lastId, std::memory_order_relaxed);
+    _shippedRows.fetch_add(shippedCount, std::memory_order_relaxed);
+
+    return shippedCount;
+}
+
+void DBLogLocalStore::connectToLocalDB(QSqlDatabase& db, const QString& connectionName) const
+{
+    DBConnectionInfo connectionInfo;
+    connectionInfo.driver = "QSQLITE";
+    connectionInfo.dbName = _fileName;
+    connectionInfo.connectOptions = "QSQLITE_BUSY_TIMEOUT=5000";
+
+    connectToDB(db, connectionInfo, connectionName);
+
+    //WAL: запись и чтение потоком пересылки не блокируют друг друга, synchronous=NORMAL в режиме WAL
+    //не теряет согласованность при сбое и не вызывает fsync на каждую транзакцию
+    QSqlQuery query(db);
+    DBQueryExecute(db, query, "PRAGMA journal_mode = WAL");
+    DBQueryExecute(db, query, "PRAGMA synchronous = NORMAL");
+    DBQueryExecute(db, query, "PRAGMA temp_store = MEMORY");
+    DBQueryExecute(db, query, QString("PRAGMA cache_size = -%1").arg(_params.cacheSize));
+}
+
+bool DBLogLocalStore::waitFor(qint64 interval)
+{
+    QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+    const QDeadlineTimer deadline(interval);
+    while (!_isStopped && !deadline.hasExpired())
+    {
+        _wakeUpCondition.wait(&_wakeUpMutex, deadline);
+    }
+
+    return !_isStopped;
+}
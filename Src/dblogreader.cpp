@@ -0,0 +1,291 @@
+//STL
+#include <limits>
+
+//Qt
+#include <QtSql/QSqlDriver>
+#include <QtSql/QSqlField>
+#include <QDateTime>
+
+//My
+#include "Common/common.h"
+
+#include "Common/dblogreader.h"
+
+using namespace Common;
+
+/*!
+    Формирует строковое значение для вставки в текст запроса, экранированное драйвером БД
+    @param db - подключение к БД
+    @param value - значение
+    @return значение в кавычках
+*/
+static QString makeStringLiteral(const QSqlDatabase& db, const QString& value)
+{
+    QSqlField field("Value", QMetaType(QMetaType::QString));
+    field.setValue(value);
+
+    return db.driver()->formatValue(field);
+}
+
+DBLogCursor::DBLogCursor(QSqlDatabase& db, const DBLogSchema& schema, const DBLogFilter& filter)
+    : _schema(schema)
+    , _query(db)
+{
+    //без подготовки: подготовленные запросы QMYSQL всегда загружают результат на клиент целиком
+    _query.setForwardOnly(true);
+    DBQueryExecute(db, _query, DBLogReader::makeSelectQuery(db, _schema, filter, DBLogReader::PageKey(), -1));
+}
+
+DBLogCursor::~DBLogCursor()
+{
+    _query.finish();
+}
+
+bool DBLogCursor::next(DBLogRow& row)
+{
+    if (!_query.next())
+    {
+        return false;
+    }
+
+    row = DBLogReader::readRow(_query, _schema);
+
+    return true;
+}
+
+DBLogReader::DBLogReader(QSqlDatabase& db, const DBLogSchema& schema)
+    : _db(db)
+    , _schema(schema)
+{
+}
+
+DBLogReader::Page DBLogReader::readPage(const DBLogFilter& filter, const PageKey& key, qint64 pageSize)
+{
+    Q_ASSERT(_db.isOpen());
+    Q_ASSERT(pageSize > 0);
+
+    //лишняя строка показывает, есть ли следующая страница
+    QSqlQuery query(_db);
+    query.setForwardOnly(true);
+    DBQueryExecute(_db, query, makeSelectQuery(_db, _schema, filter, key, pageSize + 1));
+
+    Page result;
+    result.next = key;
+    result.rows.reserve(static_cast<size_t>(pageSize));
+    while (query.next())
+    {
+        if (static_cast<qint64>(result.rows.size()) == pageSize)
+        {
+            result.isLast = false;
+
+            break;
+        }
+
+        result.rows.push_back(readRow(query, _schema));
+
+        //ключ хранит значение столбца времени как есть: в COMPACT время в микросекундах точнее DBLogRow::dateTime
+        const auto& row = result.rows.back();
+        result.next.time = _schema.type() == DBLogSchema::Type::COMPACT ? query.value(0).toLongLong() : row.dateTime;
+        result.next.id = row.id;
+    }
+    query.finish();
+
+    return result;
+}
+
+void DBLogReader::createIndexes(QSqlDatabase& db, const DBLogSchema& schema)
+{
+    Q_ASSERT(db.isOpen());
+
+    const auto driverName = db.driverName();
+    const auto tableName = schema.tableName();
+    const auto timeColumn = schema.timeColumnName();
+    const auto senderColumn = schema.type() == DBLogSchema::Type::COMPACT ? "SenderId" : "Sender";
+
+    QList<QStringList> indexes = {
+        {timeColumn},
+        {"Category", timeColumn},
+        {senderColumn, timeColumn}};
+
+    //в SQLite rowid входит в любой индекс
+    if (driverName != "QSQLITE")
+    {
+        for (auto& columns: indexes)
+        {
+            columns.push_back(schema.idColumnName(driverName));
+        }
+    }
+
+    for (const auto& columns: indexes)
+    {
+        const auto indexName = QString("IX_%1_%2").arg(tableName).arg(columns.join('_'));
+
+        QStringList quotedColumns;
+        for (const auto& column: columns)
+        {
+            quotedColumns.push_back(DBLogSchema::quoteName(driverName, column));
+        }
+
+        const auto createText = QString("CREATE INDEX %1 ON %2 (%3)")
+                                    .arg(DBLogSchema::quoteName(driverName, indexName))
+                                    .arg(DBLogSchema::quoteName(driverName, tableName))
+                                    .arg(quotedColumns.join(", "));
+
+        if (driverName == "QMYSQL")
+        {
+            //MySQL не поддерживает CREATE INDEX IF NOT EXISTS
+            QSqlQuery query(db);
+            DBQueryExecute(db, query, QString("SELECT COUNT(*) FROM `INFORMATION_SCHEMA`.`STATISTICS` "
+                                              "WHERE `TABLE_SCHEMA` = DATABASE() AND `TABLE_NAME` = '%1' AND `INDEX_NAME` = '%2'")
+                                          .arg(tableName)
+                                          .arg(indexName));
+
+            if (query.next() && query.value(0).toLongLong() > 0)
+            {
+                continue;
+            }
+
+            DBQueryExecuteAutoCommit(db, createText);
+        }
+        else if (driverName == "QSQLITE")
+        {
+            DBQueryExecuteAutoCommit(db, QString(createText).replace("CREATE INDEX", "CREATE INDEX IF NOT EXISTS"));
+        }
+        else
+        {
+            DBQueryExecuteAutoCommit(db, QString("IF NOT EXISTS (SELECT 1 FROM sys.indexes WHERE name = N'%1' AND object_id = OBJECT_ID(N'%2')) %3")
+                                   .arg(indexName)
+                                   .arg(tableName)
+                                   .arg(createText));
+        }
+
+        qDebug() << QString("Created log index: %1").arg(indexName);
+    }
+}
+
+QString DBLogReader::makeSelectQuery(const QSqlDatabase& db, const DBLogSchema& schema, const DBLogFilter& filter, const PageKey& key, qint64 limit)
+{
+    const auto driverName = db.driverName();
+    const auto quote = [&driverName](const QString& name) { return DBLogSchema::quoteName(driverName, name); };
+
+    QString selectText;
+    QString fromText;
+    QString alias;
+    QString senderCondition;
+    if (schema.type() == DBLogSchema::Type::COMPACT)
+    {
+        alias = "d";
+        selectText = QString("d.%1, d.%2, s.%3, d.%4, d.%5")
+                         .arg(quote("TimeUs"), quote("Category"), quote("Name"), quote("Msg"), quote(schema.idColumnName(driverName)));
+        fromText = QString("%1 d JOIN %2 s ON s.%3 = d.%4")
+                       .arg(quote(schema.tableName())).arg(quote(schema.senderTableName())).arg(quote("Id")).arg(quote("SenderId"));
+
+        if (!filter.sender.isEmpty())
+        {
+            senderCondition = QString("d.%1 = (SELECT %2 FROM %3 WHERE %4 = %5)")
+                                  .arg(quote("SenderId"), quote("Id"), quote(schema.senderTableName()), quote("Name"),
+                                       makeStringLiteral(db, filter.sender));
+        }
+    }
+    else
+    {
+        alias = "l";
+        selectText = QString("l.%1, l.%2, l.%3, l.%4, l.%5")
+                         .arg(quote("DateTime"), quote("Category"), quote("Sender"), quote("Msg"), quote(schema.idColumnName(driverName)));
+        fromText = QString("%1 l").arg(quote(schema.tableName()));
+
+        if (!filter.sender.isEmpty())
+        {
+            senderCondition = QString("l.%1 = %2").arg(quote("Sender"), makeStringLiteral(db, filter.sender));
+        }
+    }
+
+    const auto timeColumn = QString("%1.%2").arg(alias).arg(quote(schema.timeColumnName()));
+    const auto idColumn = QString("%1.%2").arg(alias).arg(quote(schema.idColumnName(driverName)));
+
+    QStringList conditions;
+    conditions.push_back(QString("%1 >= %2").arg(timeColumn).arg(schema.makeTimeLiteral(driverName, filter.from)));
+
+    //продолжение выборки начинается сразу после ключа - запрос просматривает только оставшийся диапазон индекса.
+    //Условие записано через >= по времени, чтобы СУБД использовала его как границу диапазона индекса
+    if (key.id >= 0)
+    {
+        const auto keyTime = schema.type() == DBLogSchema::Type::COMPACT
+            ? QString::number(key.time)
+            : schema.makeTimeLiteral(driverName, key.time);
+
+        conditions.push_back(QString("%1 >= %2 AND (%1 > %2 OR %3 > %4)")
+                                 .arg(timeColumn, keyTime, idColumn, QString::number(key.id)));
+    }
+    if (filter.to != std::numeric_limits<qint64>::max())
+    {
+        conditions.push_back(QString("%1 < %2").arg(timeColumn).arg(schema.makeTimeLiteral(driverName, filter.to)));
+    }
+
+    if (!filter.categories.isEmpty())
+    {
+        QStringList categories;
+        for (const auto category: filter.categories)
+        {
+            categories.push_back(QString::number(category));
+        }
+
+        conditions.push_back(QString("%1.%2 IN (%3)").arg(alias).arg(quote("Category")).arg(categories.join(", ")));
+    }
+
+    if (!senderCondition.isEmpty())
+    {
+        conditions.push_back(senderCondition);
+    }
+
+    //значения подставляются одним вызовом arg(...): строковые значения условий могут содержать "%N"
+    auto queryText = QString("SELECT %1 FROM %2 WHERE %3 ORDER BY %4, %5")
+                         .arg(selectText, fromText, conditions.join(" AND "), timeColumn, idColumn);
+
+    if (limit >= 0)
+    {
+        if (driverName == "QMYSQL" || driverName == "QSQLITE")
+        {
+            queryText += QString(" LIMIT %1").arg(limit);
+        }
+        else
+        {
+            //MS SQL допускает FETCH только вместе с OFFSET
+            queryText += QString(" OFFSET 0 ROWS FETCH NEXT %1 ROWS ONLY").arg(limit);
+        }
+    }
+
+    return queryText;
+}
+
+DBLogRow DBLogReader::readRow(const QSqlQuery& query, const DBLogSchema& schema)
+{
+    DBLogRow result;
+
+    const auto dateTime = query.value(0);
+    if (schema.type() == DBLogSchema::Type::COMPACT)
+    {
+        result.dateTime = dateTime.toLongLong() / 1000;
+    }
+    else if (dateTime.typeId() == QMetaType::QDateTime)
+    {
+        result.dateTime = dateTime.toDateTime().toMSecsSinceEpoch();
+    }
+    else
+    {
+        //SQLite хранит время строкой
+        auto parsed = QDateTime::fromString(dateTime.toString(), DATETIME_FORMAT);
+        if (!parsed.isValid())
+        {
+            parsed = QDateTime::fromString(dateTime.toString(), SIMPLY_DATETIME_FORMAT);
+        }
+        result.dateTime = parsed.toMSecsSinceEpoch();
+    }
+
+    result.category = static_cast<quint8>(query.value(1).toUInt());
+    result.sender = query.value(2).toString();
+    result.msg = query.value(3).toString();
+    result.id = query.value(4).toLongLong();
+
+    return result;
+}
@@ -0,0 +1,262 @@
+//STL
+#include <algorithm>
+
+//Qt
+#include <QtSql/QSqlQuery>
+#include <QMutexLocker>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QDateTime>
+
+//My
+#include "Common/common.h"
+#include "Common/logcrashbuffer.h"
+
+#include "Common/dblogretention.h"
+
+using namespace Common;
+
+static const qint64 TO_DAYS_JULIAN_DAY_OFFSET = 1721060;  ///< Разница между юлианским днем и номером дня MySQL TO_DAYS()
+static const qint64 MAXVALUE_PARTITION_KEY = -1;           ///< Ключ секции MAXVALUE в списке секций
+
+DBLogRetention::DBLogRetention(const DBConnectionInfo& connectionInfo, const DBLogSchema& schema, const Params& params)
+    : _connectionInfo(connectionInfo)
+    , _schema(schema)
+    , _tableName(schema.tableName())
+    , _params(params)
+{
+    _thread.reset(QThread::create([this](){ run(); }));
+    _thread->setObjectName(QString("DBRetention_%1").arg(_tableName));
+    _thread->start(QThread::LowestPriority);
+}
+
+DBLogRetention::~DBLogRetention()
+{
+    {
+        QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+        _isStopped = true;
+        _wakeUpCondition.wakeAll();
+    }
+
+    _thread->wait();
+}
+
+DBLogRetention::State DBLogRetention::state() const
+{
+    State result;
+    result.deletedRows = _deletedRows.load(std::memory_order_relaxed);
+    result.droppedPartitions = _droppedPartitions.load(std::memory_order_relaxed);
+    result.lastRunTime = _lastRunTime.load(std::memory_order_relaxed);
+    result.errorCount = _errorCount.load(std::memory_order_relaxed);
+
+    return result;
+}
+
+void DBLogRetention::run()
+{
+    //аварийный буфер лога сохраняется и при переполнении стека этого потока
+    LogCrashBuffer::installThreadStack();
+
+    auto delay = _params.startDelay;
+    while (waitFor(delay))
+    {
+        delay = _params.checkInterval;
+
+        QSqlDatabase db;
+        try
+        {
+            connectToDB(db, _connectionInfo, QString("%1_Retention").arg(_tableName));
+
+            clearOldLog(db);
+
+            _lastRunTime.store(QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
+        }
+        catch (const SQLException& err)
+        {
+            _errorCount.fetch_add(1, std::memory_order_relaxed);
+
+            qWarning() << QString("Error clear old log in DB %1:%2. Next attempt in %3 ms. Error: %4")
+                              .arg(_connectionInfo.dbName).arg(_tableName).arg(delay).arg(err.what());
+        }
+
+        closeDB(db);
+    }
+}
+
+void DBLogRetention::clearOldLog(QSqlDatabase& db)
+{
+    Q_ASSERT(db.isOpen());
+
+    if (_params.strategy != Strategy::CHUNKS && _schema.type() == DBLogSchema::Type::CLASSIC && db.driverName() == "QMYSQL")
+    {
+        const auto partitions = loadPartitions(db);
+        if (!partitions.isEmpty())
+        {
+            clearPartitions(db, partitions);
+
+            return;
+        }
+
+        if (_params.strategy == Strategy::PARTITIONS)
+        {
+            qWarning() << QString("Table %1 is not partitioned by days. Old log will be deleted by chunks").arg(_tableName);
+        }
+    }
+
+    clearChunks(db);
+}
+
+void DBLogRetention::clearPartitions(QSqlDatabase& db, const QMap<qint64, QString>& partitions)
+{
+    Q_ASSERT(db.isOpen());
+
+    qint64 lastBound = 0;
+    for (auto partitions_it = partitions.begin(); partitions_it != partitions.end(); ++partitions_it)
+    {
+        lastBound = std::max(lastBound, partitions_it.key());
+    }
+
+    //секции на дни вперед создаются заранее, пока секция MAXVALUE пуста и ее разделение не требует копирования строк.
+    //Создание выполняется до удаления, чтобы в таблице всегда оставалась хотя бы одна секция
+    const auto today = QDate::currentDate();
+    for (qint64 day = 0; day <= _params.partitionsAhead; ++day)
+    {
+        const auto date = today.addDays(day);
+        const auto bound = toDays(date.addDays(1));
+        if (bound <= lastBound)
+        {
+            continue;
+        }
+
+        const auto partitionDefinition = QString("PARTITION `p%1` VALUES LESS THAN (%2)").arg(date.toString("yyyyMMdd")).arg(bound);
+
+        QString queryText;
+        if (partitions.contains(MAXVALUE_PARTITION_KEY))
+        {
+            queryText = QString("ALTER TABLE `%1` REORGANIZE PARTITION `%2` INTO (%3, PARTITION `%2` VALUES LESS THAN MAXVALUE)")
+                            .arg(_tableName)
+                            .arg(partitions.value(MAXVALUE_PARTITION_KEY))
+                            .arg(partitionDefinition);
+        }
+        else
+        {
+            queryText = QString("ALTER TABLE `%1` ADD PARTITION (%2)")
+                            .arg(_tableName)
+                            .arg(partitionDefinition);
+        }
+
+        DBQueryExecuteAutoCommit(db, queryText);
+
+        lastBound = bound;
+    }
+
+    //секция удаляется, если все ее строки (до верхней границы, не включая) старше срока хранения
+    const auto lastDay = toDays(QDateTime::currentDateTime().addSecs(-_params.maxAge).date());
+    for (auto partitions_it = partitions.begin(); partitions_it != partitions.end(); ++partitions_it)
+    {
+        const auto bound = partitions_it.key();
+        if (bound == MAXVALUE_PARTITION_KEY || bound > lastDay)
+        {
+            continue;
+        }
+
+        DBQueryExecuteAutoCommit(db, QString("ALTER TABLE `%1` DROP PARTITION `%2`").arg(_tableName).arg(partitions_it.value()));
+
+        _droppedPartitions.fetch_add(1, std::memory_order_relaxed);
+
+        qDebug() << QString("Dropped log partition: %1:%2").arg(_tableName).arg(partitions_it.value());
+    }
+}
+
+void DBLogRetention::clearChunks(QSqlDatabase& db)
+{
+    Q_ASSERT(db.isOpen());
+
+    const auto lastLog = QDateTime::currentDateTime().addSecs(-_params.maxAge);
+    const auto queryText = _schema.makeDeleteOldQuery(db.driverName(), lastLog.toMSecsSinceEpoch(), _params.chunkSize);
+
+    qint64 deletedRows = 0;
+    while (true)
+    {
+        QElapsedTimer chunkTimer;
+        chunkTimer.start();
+
+        //каждая порция - отдельная транзакция в режиме автоподтверждения: блокировки держатся только на время порции
+        QSqlQuery query(db);
+        DBQueryExecute(db, query, queryText);
+
+        const auto chunkRows = std::max(query.numRowsAffected(), 0);
+        deletedRows += chunkRows;
+        _deletedRows.fetch_add(chunkRows, std::memory_order_relaxed);
+
+        if (chunkRows < _params.chunkSize)
+        {
+            break;
+        }
+
+        if (!waitFor(std::max(_params.chunkPause, chunkTimer.elapsed())))
+        {
+            break;
+        }
+    }
+
+    if (deletedRows > 0)
+    {
+        qDebug() << QString("Cleared logs before: %1. Deleted rows: %2").arg(lastLog.toString(SIMPLY_DATETIME_FORMAT)).arg(deletedRows);
+    }
+}
+
+QMap<qint64, QString> DBLogRetention::loadPartitions(QSqlDatabase& db) const
+{
+    Q_ASSERT(db.isOpen());
+
+    const auto queryText = QString("SELECT `PARTITION_NAME`, `PARTITION_DESCRIPTION` "
+                                   "FROM `INFORMATION_SCHEMA`.`PARTITIONS` "
+                                   "WHERE `TABLE_SCHEMA` = DATABASE() AND `TABLE_NAME` = '%1' AND "
+                                       "`PARTITION_METHOD` = 'RANGE' AND LOWER(`PARTITION_EXPRESSION`) LIKE 'to_days(%datetime%)'")
+                               .arg(_tableName);
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    DBQueryExecute(db, query, queryText);
+
+    QMap<qint64, QString> result;
+    while (query.next())
+    {
+        const auto description = query.value("PARTITION_DESCRIPTION").toString();
+        if (description.compare("MAXVALUE", Qt::CaseInsensitive) == 0)
+        {
+            result.insert(MAXVALUE_PARTITION_KEY, query.value("PARTITION_NAME").toString());
+
+            continue;
+        }
+
+        bool isOk = false;
+        const auto bound = description.toLongLong(&isOk);
+        if (isOk)
+        {
+            result.insert(bound, query.value("PARTITION_NAME").toString());
+        }
+    }
+
+    return result;
+}
+
+bool DBLogRetention::waitFor(qint64 interval)
+{
+    QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+    const QDeadlineTimer deadline(interval);
+    while (!_isStopped && !deadline.hasExpired())
+    {
+        _wakeUpCondition.wait(&_wakeUpMutex, deadline);
+    }
+
+    return !_isStopped;
+}
+
+qint64 DBLogRetention::toDays(const QDate& date)
+{
+    return date.toJulianDay() - TO_DAYS_JULIAN_DAY_OFFSET;
+}
@@ -0,0 +1,441 @@
+//Qt
+#include <QDateTime>
+#include <QVariantList>
+#include <QtSql/QSqlDriver>
+
+//My
+#include "Common/common.h"
+
+#include "Common/dblogschema.h"
+
+using namespace Common;
+
+static const QString DATA_TABLE_SUFFIX("_Data");        ///< Суффикс названия таблицы данных схемы COMPACT
+static const QString SENDER_TABLE_SUFFIX("_Sender");    ///< Суффикс названия таблицы словаря отправителей схемы COMPACT
+static const QString CLASSIC_TABLE_SUFFIX("_Classic");  ///< Суффикс названия исходной таблицы после миграции
+static const qsizetype MAX_INSERT_ROW_COUNT = 128;      ///< Максимальное количество строк многострочного запроса INSERT. Степень 2.
+                                                        ///< 4 параметра на строку укладываются в ограничения всех поддерживаемых БД
+
+QString DBLogSchema::quoteName(const QString& driverName, const QString& name)
+{
+    if (driverName == "QMYSQL")
+    {
+        return QString("`%1`").arg(name);
+    }
+
+    if (driverName == "QSQLITE")
+    {
+        return QString("\"%1\"").arg(name);
+    }
+
+    return QString("[%1]").arg(name);
+}
+
+DBLogSchema::DBLogSchema(Type type, const QString& logName)
+    : _type(type)
+    , _logName(logName)
+{
+}
+
+QString DBLogSchema::tableName() const
+{
+    return _type == Type::COMPACT ? _logName + DATA_TABLE_SUFFIX : _logName;
+}
+
+QString DBLogSchema::senderTableName() const
+{
+    return _logName + SENDER_TABLE_SUFFIX;
+}
+
+void DBLogSchema::prepare(QSqlDatabase& db, const QString& sender)
+{
+    Q_ASSERT(db.isOpen());
+
+    //идентификатор отправителя не меняется, поэтому запрашивается один раз, а не при каждом переподключении
+    if (_type != Type::COMPACT || _senderId >= 0)
+    {
+        return;
+    }
+
+    createCompact(db, _logName);
+
+    _senderId = loadSenderId(db, sender);
+}
+
+QString DBLogSchema::makeInsertQuery(const QString& driverName, qsizetype rowCount /* = 1 */) const
+{
+    Q_ASSERT(rowCount > 0);
+
+    QString queryText;
+    QString rowText;
+    if (_type == Type::COMPACT)
+    {
+        queryText = QString("INSERT INTO %1 (%2, %3, %4, %5) VALUES ")
+            .arg(quoteName(driverName, tableName()))
+            .arg(quoteName(driverName, "TimeUs"))
+            .arg(quoteName(driverName, "Category"))
+            .arg(quoteName(driverName, "SenderId"))
+            .arg(quoteName(driverName, "Msg"));
+        rowText = "(?, ?, ?, ?)";
+    }
+    else if (driverName == "QMYSQL")
+    {
+        queryText = QString("INSERT INTO `%1` (`DateTime`, `Category`, `Sender`, `Msg`) VALUES ").arg(_logName);
+        rowText = "(CAST(? AS DATETIME), ?, ?, ?)";
+    }
+    //SQLite хранит время строкой, CAST к DATETIME в нем приводит строку к числу
+    else if (driverName == "QSQLITE")
+    {
+        queryText = QString("INSERT INTO \"%1\" (\"DateTime\", \"Category\", \"Sender\", \"Msg\") VALUES ").arg(_logName);
+        rowText = "(?, ?, ?, ?)";
+    }
+    else
+    {
+        queryText = QString("INSERT INTO [%1] ([DateTime], [Category], [Sender], [Msg]) VALUES ").arg(_logName);
+        rowText = "(CAST(? AS DATETIME2), ?, ?, ?)";
+    }
+
+    return queryText + QStringList(rowCount, rowText).join(", ");
+}
+
+void DBLogSchema::insertRecords(QSqlDatabase& db, DBStatementCache& statements, const std::vector<LogRecord>& records,
+                                const QString& sender) const
+{
+    Q_ASSERT(db.isOpen());
+
+    if (records.empty())
+    {
+        return;
+    }
+
+    const auto driverName = db.driverName();
+
+    if (db.driver()->hasFeature(QSqlDriver::BatchOperations))
+    {
+        auto& query = statements.prepare(makeInsertQuery(driverName));
+        bindRecords(query, records, sender);
+
+        DBQueryExecuteBatch(db, query);
+
+        return;
+    }
+
+    //execBatch() такого драйвера выполняет запрос для каждой строки отдельно, поэтому строки передаются многострочными
+    //запросами. Размеры порций - убывающие степени 2: для любого количества сообщений достаточно не более
+    //log2(MAX_INSERT_ROW_COUNT) + 1 разных подготовленных запросов, а обращений к серверу - не более
+    //records.size() / MAX_INSERT_ROW_COUNT + log2(MAX_INSERT_ROW_COUNT) + 1
+    const auto size = static_cast<qsizetype>(records.size());
+    qsizetype first = 0;
+    for (qsizetype rowCount = MAX_INSERT_ROW_COUNT; rowCount > 0; rowCount /= 2)
+    {
+        while (size - first >= rowCount)
+        {
+            auto& query = statements.prepare(makeInsertQuery(driverName, rowCount));
+            bindRows(query, records, first, rowCount, sender);
+
+            DBQueryExecutePrepared(db, query);
+
+            first += rowCount;
+        }
+    }
+}
+
+void DBLogSchema::bindRecords(QSqlQuery& query, const std::vector<LogRecord>& records, const QString& sender) const
+{
+    QVariantList dateTimes;
+    QVariantList categories;
+    QVariantList senders;
+    QVariantList msgs;
+    dateTimes.reserve(records.size());
+    categories.reserve(records.size());
+    senders.reserve(records.size());
+    msgs.reserve(records.size());
+
+    //в схеме COMPACT время и отправитель передаются числами: серверу не нужно разбирать строки
+    const bool isCompact = _type == Type::COMPACT;
+    for (const auto& record: records)
+    {
+        if (isCompact)
+        {
+            dateTimes.push_back(record.dateTime * 1000);
+            senders.push_back(_senderId);
+        }
+        else
+        {
+            dateTimes.push_back(QDateTime::fromMSecsSinceEpoch(record.dateTime).toString(DATETIME_FORMAT));
+            senders.push_back(sender);
+        }
+        categories.push_back(static_cast<int>(record.level));
+        msgs.push_back(record.msg);
+    }
+
+    query.addBindValue(dateTimes);
+    query.addBindValue(categories);
+    query.addBindValue(senders);
+    query.addBindValue(msgs);
+}
+
+void DBLogSchema::bindRows(QSqlQuery& query, const std::vector<LogRecord>& records, qsizetype first, qsizetype count,
+                           const QString& sender) const
+{
+    Q_ASSERT(first >= 0 && first + count <= static_cast<qsizetype>(records.size()));
+
+    const bool isCompact = _type == Type::COMPACT;
+    int index = 0;
+    for (auto i = first; i < first + count; ++i)
+    {
+        const auto& record = records[static_cast<size_t>(i)];
+        if (isCompact)
+        {
+            query.bindValue(index++, record.dateTime * 1000);
+            query.bindValue(index++, static_cast<int>(record.level));
+            query.bindValue(index++, _senderId);
+        }
+        else
+        {
+            query.bindValue(index++, QDateTime::fromMSecsSinceEpoch(record.dateTime).toString(DATETIME_FORMAT));
+            query.bindValue(index++, static_cast<int>(record.level));
+            query.bindValue(index++, sender);
+        }
+        query.bindValue(index++, record.msg);
+    }
+}
+
+QString DBLogSchema::timeColumnName() const
+{
+    return _type == Type::COMPACT ? "TimeUs" : "DateTime";
+}
+
+QString DBLogSchema::idColumnName(const QString& driverName) const
+{
+    return driverName == "QSQLITE" ? "rowid" : "Id";
+}
+
+QString DBLogSchema::makeTimeLiteral(const QString& driverName, qint64 dateTime) const
+{
+    if (_type == Type::COMPACT)
+    {
+        return QString::number(dateTime * 1000);
+    }
+
+    const auto dateTimeString = QDateTime::fromMSecsSinceEpoch(dateTime).toString(DATETIME_FORMAT);
+    if (driverName == "QMYSQL")
+    {
+        return QString("CAST('%1' AS DATETIME)").arg(dateTimeString);
+    }
+
+    if (driverName == "QSQLITE")
+    {
+        return QString("'%1'").arg(dateTimeString);
+    }
+
+    return QString("CAST('%1' AS DATETIME2)").arg(dateTimeString);
+}
+
+QString DBLogSchema::makeDeleteOldQuery(const QString& driverName, qint64 lastLog, qint64 chunkSize) const
+{
+    const auto table = quoteName(driverName, tableName());
+    const auto timeColumn = quoteName(driverName, timeColumnName());
+    const auto lastLogValue = makeTimeLiteral(driverName, lastLog);
+
+    //порция выбирается по индексу времени от самых старых строк, поэтому каждая следующая порция начинается там,
+    //где закончилась предыдущая, без повторного просмотра удаленного диапазона
+    if (driverName == "QMYSQL")
+    {
+        return QString("DELETE FROM %1 WHERE %2 < %3 ORDER BY %2 LIMIT %4")
+            .arg(table).arg(timeColumn).arg(lastLogValue).arg(chunkSize);
+    }
+
+    if (driverName == "QSQLITE")
+    {
+        return QString("DELETE FROM %1 WHERE rowid IN (SELECT rowid FROM %1 WHERE %2 < %3 ORDER BY %2 LIMIT %4)")
+            .arg(table).arg(timeColumn).arg(lastLogValue).arg(chunkSize);
+    }
+
+    return QString("DELETE TOP (%4) FROM %1 WHERE %2 < %3")
+        .arg(table).arg(timeColumn).arg(lastLogValue).arg(chunkSize);
+}
+
+QStringList DBLogSchema::columnNames() const
+{
+    if (_type == Type::COMPACT)
+    {
+        return {"TimeUs", "Category", "SenderId", "Msg"};
+    }
+
+    return {"DateTime", "Category", "Sender", "Msg"};
+}
+
+void DBLogSchema::createCompact(QSqlDatabase& db, const QString& logName)
+{
+    Q_ASSERT(db.isOpen());
+
+    const auto senderTable = logName + SENDER_TABLE_SUFFIX;
+    const auto dataTable = logName + DATA_TABLE_SUFFIX;
+
+    if (db.driverName() == "QMYSQL")
+    {
+        DBQueryExecuteAutoCommit(db, QString("CREATE TABLE IF NOT EXISTS `%1` ("
+                                   "`Id` INT NOT NULL AUTO_INCREMENT PRIMARY KEY, "
+                                   "`Name` VARCHAR(255) NOT NULL, "
+                                   "UNIQUE KEY `UX_%1_Name` (`Name`))")
+                               .arg(senderTable));
+
+        DBQueryExecuteAutoCommit(db, QString("CREATE TABLE IF NOT EXISTS `%1` ("
+                                   "`Id` BIGINT NOT NULL AUTO_INCREMENT PRIMARY KEY, "
+                                   "`TimeUs` BIGINT NOT NULL, "
+                                   "`Category` TINYINT UNSIGNED NOT NULL, "
+                                   "`SenderId` INT NOT NULL, "
+                                   "`Msg` TEXT NOT NULL, "
+                                   "KEY `IX_%1_TimeUs_Id` (`TimeUs`, `Id`))")
+                               .arg(dataTable));
+    }
+    else if (db.driverName() == "QSQLITE")
+    {
+        DBQueryExecuteAutoCommit(db, QString("CREATE TABLE IF NOT EXISTS \"%1\" ("
+                                   "\"Id\" INTEGER PRIMARY KEY, "
+                                   "\"Name\" TEXT NOT NULL UNIQUE)")
+                               .arg(senderTable));
+
+        DBQueryExecuteAutoCommit(db, QString("CREATE TABLE IF NOT EXISTS \"%1\" ("
+                                   "\"Id\" INTEGER PRIMARY KEY, "
+                                   "\"TimeUs\" INTEGER NOT NULL, "
+                                   "\"Category\" INTEGER NOT NULL, "
+                                   "\"SenderId\" INTEGER NOT NULL, "
+                                   "\"Msg\" TEXT NOT NULL)")
+                               .arg(dataTable));
+
+        DBQueryExecuteAutoCommit(db, QString("CREATE INDEX IF NOT EXISTS \"IX_%1_TimeUs\" ON \"%1\" (\"TimeUs\")")
+                               .arg(dataTable));
+    }
+    else
+    {
+        DBQueryExecuteAutoCommit(db, QString("IF OBJECT_ID(N'%1', N'U') IS NULL "
+                                   "CREATE TABLE [%1] ("
+                                   "[Id] INT IDENTITY(1, 1) NOT NULL PRIMARY KEY, "
+                                   "[Name] NVARCHAR(255) NOT NULL CONSTRAINT [UX_%1_Name] UNIQUE)")
+                               .arg(senderTable));
+
+        DBQueryExecuteAutoCommit(db, QString("IF OBJECT_ID(N'%1', N'U') IS NULL "
+                                   "CREATE TABLE [%1] ("
+                                   "[Id] BIGINT IDENTITY(1, 1) NOT NULL, "
+                                   "[TimeUs] BIGINT NOT NULL, "
+                                   "[Category] TINYINT NOT NULL, "
+                                   "[SenderId] INT NOT NULL, "
+                                   "[Msg] NVARCHAR(MAX) NOT NULL, "
+                                   "INDEX [IX_%1_TimeUs_Id] CLUSTERED ([TimeUs], [Id]))")
+                               .arg(dataTable));
+    }
+}
+
+void DBLogSchema::migrateToCompact(QSqlDatabase& db, const QString& logName)
+{
+    Q_ASSERT(db.isOpen());
+
+    createCompact(db, logName);
+
+    const auto senderTable = logName + SENDER_TABLE_SUFFIX;
+    const auto dataTable = logName + DATA_TABLE_SUFFIX;
+    const auto classicTable = logName + CLASSIC_TABLE_SUFFIX;
+
+    //исходная таблица хранит локальное время, таблица данных - микросекунды от начала эпохи UTC
+    QStringList queries;
+    if (db.driverName() == "QMYSQL")
+    {
+        queries << QString("INSERT INTO `%1` (`Name`) SELECT DISTINCT `Sender` FROM `%2` WHERE `Sender` NOT IN (SELECT `Name` FROM `%1`)")
+                       .arg(senderTable).arg(logName)
+                << QString("INSERT INTO `%1` (`TimeUs`, `Category`, `SenderId`, `Msg`) "
+                           "SELECT CAST(ROUND(UNIX_TIMESTAMP(l.`DateTime`) * 1000000) AS SIGNED), l.`Category`, s.`Id`, l.`Msg` "
+                           "FROM `%2` l JOIN `%3` s ON s.`Name` = l.`Sender`")
+                       .arg(dataTable).arg(logName).arg(senderTable)
+                << QString("RENAME TABLE `%1` TO `%2`").arg(logName).arg(classicTable)
+                << QString("CREATE VIEW `%1` AS "
+                           "SELECT FROM_UNIXTIME(d.`TimeUs` / 1000000) AS `DateTime`, d.`Category`, s.`Name` AS `Sender`, d.`Msg` "
+                           "FROM `%2` d JOIN `%3` s ON s.`Id` = d.`SenderId`")
+                       .arg(logName).arg(dataTable).arg(senderTable);
+    }
+    else if (db.driverName() == "QSQLITE")
+    {
+        queries << QString("INSERT INTO \"%1\" (\"Name\") SELECT DISTINCT \"Sender\" FROM \"%2\" WHERE \"Sender\" NOT IN (SELECT \"Name\" FROM \"%1\")")
+                       .arg(senderTable).arg(logName)
+                << QString("INSERT INTO \"%1\" (\"TimeUs\", \"Category\", \"SenderId\", \"Msg\") "
+                           "SELECT CAST(ROUND((julianday(l.\"DateTime\", 'utc') - 2440587.5) * 86400000000) AS INTEGER), l.\"Category\", s.\"Id\", l.\"Msg\" "
+                           "FROM \"%2\" l JOIN \"%3\" s ON s.\"Name\" = l.\"Sender\"")
+                       .arg(dataTable).arg(logName).arg(senderTable)
+                << QString("ALTER TABLE \"%1\" RENAME TO \"%2\"").arg(logName).arg(classicTable)
+                << QString("CREATE VIEW \"%1\" AS "
+                           "SELECT strftime('%Y-%m-%d %H:%M:%f', d.\"TimeUs\" / 1000000.0, 'unixepoch', 'localtime') AS \"DateTime\", "
+                               "d.\"Category\", s.\"Name\" AS \"Sender\", d.\"Msg\" "
+                           "FROM \"%2\" d JOIN \"%3\" s ON s.\"Id\" = d.\"SenderId\"")
+                       .arg(logName).arg(dataTable).arg(senderTable);
+    }
+    else
+    {
+        //смещение часового пояса берется текущее, поэтому время в представлении на переходах на летнее время приблизительное
+        queries << QString("INSERT INTO [%1] ([Name]) SELECT DISTINCT [Sender] FROM [%2] WHERE [Sender] NOT IN (SELECT [Name] FROM [%1])")
+                       .arg(senderTable).arg(logName)
+                << QString("INSERT INTO [%1] ([TimeUs], [Category], [SenderId], [Msg]) "
+                           "SELECT DATEDIFF_BIG(MICROSECOND, '1970-01-01', DATEADD(MINUTE, DATEDIFF(MINUTE, GETDATE(), GETUTCDATE()), l.[DateTime])), "
+                               "l.[Category], s.[Id], l.[Msg] "
+                           "FROM [%2] l JOIN [%3] s ON s.[Name] = l.[Sender]")
+                       .arg(dataTable).arg(logName).arg(senderTable)
+                << QString("EXEC sp_rename N'%1', N'%2'").arg(logName).arg(classicTable)
+                << QString("CREATE VIEW [%1] AS "
+                           "SELECT DATEADD(MINUTE, DATEDIFF(MINUTE, GETUTCDATE(), GETDATE()), "
+                               "DATEADD(MICROSECOND, CAST(d.[TimeUs] % 1000000 AS INT), "
+                                   "DATEADD(SECOND, CAST(d.[TimeUs] / 1000000 AS INT), CAST('1970-01-01' AS DATETIME2)))) AS [DateTime], "
+                               "d.[Category], s.[Name] AS [Sender], d.[Msg] "
+                           "FROM [%2] d JOIN [%3] s ON s.[Id] = d.[SenderId]")
+                       .arg(logName).arg(dataTable).arg(senderTable);
+    }
+
+    for (const auto& queryText: queries)
+    {
+        DBQueryExecute(db, queryText);
+    }
+
+    qInfo() << QString("Log table %1 migrated to the compact schema. Source table renamed to %2").arg(logName).arg(classicTable);
+}
+
+qint64 DBLogSchema::loadSenderId(QSqlDatabase& db, const QString& sender) const
+{
+    Q_ASSERT(db.isOpen());
+
+    const auto table = quoteName(db.driverName(), senderTableName());
+    const auto idColumn = quoteName(db.driverName(), "Id");
+    const auto nameColumn = quoteName(db.driverName(), "Name");
+
+    const auto selectId = [&]() -> qint64
+    {
+        QSqlQuery query(db);
+        DBQueryPrepare(db, query, QString("SELECT %1 FROM %2 WHERE %3 = ?").arg(idColumn).arg(table).arg(nameColumn));
+        query.addBindValue(sender);
+        if (!query.exec())
+        {
+            throw SQLException(executeDBErrorString(db, query));
+        }
+
+        return query.next() ? query.value(0).toLongLong() : -1;
+    };
+
+    auto result = selectId();
+    if (result >= 0)
+    {
+        return result;
+    }
+
+    //отправителя мог одновременно добавить другой сервис - тогда вставка нарушит уникальность и id будет прочитан повторно
+    QSqlQuery query(db);
+    DBQueryPrepare(db, query, QString("INSERT INTO %1 (%2) VALUES (?)").arg(table).arg(nameColumn));
+    query.addBindValue(sender);
+    query.exec();
+
+    result = selectId();
+    if (result < 0)
+    {
+        throw SQLException(QString("Cannot add sender %1 to the dictionary %2. Error: %3")
+                               .arg(sender).arg(senderTableName()).arg(executeDBErrorString(db, query)));
+    }
+
+    return result;
+}
@@ -0,0 +1,641 @@
+//STL
+#include <algorithm>
+#include <limits>
+
+//Qt
+#include <QtSql/QSqlQuery>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+//My
+#include "Common/common.h"
+#include "Common/tdbloger.h"
+
+#include "Common/dblogsink.h"
+
+using namespace Common;
+
+static const qint64 WAKE_UP_COUNT = 100;                        ///< Количество сообщений в очереди, при котором поток записи будится досрочно
+static const qint64 RECORD_OVERHEAD = 64;                       ///< Объем служебных полей строки лога (время, категория, отправитель), байт
+static const qint64 REPLAY_RETRY_INTERVAL = 5000;               ///< 5 с. Интервал попыток чтения дисковой очереди после ошибки чтения, мс
+static const qint64 REPLAY_TIME_SLICE = 500;                    ///< Максимальное время записи дисковой очереди за одно пробуждение потока, мс
+static const qsizetype REPLAY_BATCH_SIZE = 5000;                ///< Количество сообщений дисковой очереди в одной транзакции
+static const qint64 RATE_WINDOW = 1000;                         ///< Интервал измерения скорости потока сообщений, мс
+
+DBLogSink::DBLogSink(const DBConnectionInfo& connectionInfo, const QString& logDBName, const QString& sender)
+    : LogSink("DB", TARGET_DB)
+    , _dbConnectionInfo(connectionInfo)
+    , _logDBName(logDBName)
+    , _sender(sender)
+    , _supervisor(std::make_unique<DBConnectionSupervisor>(connectionInfo, logDBName))
+    , _schema(DBLogSchema::Type::CLASSIC, logDBName)
+    , _drainDeadline(std::numeric_limits<qint64>::max())
+{
+    setFlushParams(DBFlushController::Params());
+}
+
+DBLogSink::~DBLogSink()
+{
+    stop();
+}
+
+std::future<QString> DBLogSink::connectResult()
+{
+    return _connectPromise.get_future();
+}
+
+void DBLogSink::setErrorHandler(ErrorHandler&& handler)
+{
+    _errorHandler = std::move(handler);
+}
+
+void DBLogSink::setFlushParams(const DBFlushController::Params& params)
+{
+    _flushController.setParams(params);
+
+    //поток просыпается несколько раз за время максимальной задержки, чтобы превышение задержки было небольшим
+    setBatchParams(WAKE_UP_COUNT, static_cast<int>(std::clamp<qint64>(params.maxLatency / 4, 10, 1000)));
+}
+
+void DBLogSink::setSpoolParams(const DBLogSpool::Params& params)
+{
+    _spoolParams = params;
+}
+
+void DBLogSink::setBulkParams(const DBBulkLoader::Params& params)
+{
+    _bulkParams = params;
+}
+
+void DBLogSink::setRetentionParams(const DBLogRetention::Params& params)
+{
+    _retentionParams = params;
+}
+
+void DBLogSink::setSchemaType(DBLogSchema::Type type)
+{
+    _schema = DBLogSchema(type, _logDBName);
+}
+
+void DBLogSink::setLocalStoreParams(const DBLogLocalStore::Params& params)
+{
+    _localStoreParams = params;
+}
+
+void DBLogSink::append(LogRecord&& record)
+{
+    //до набора пачки буфер забирается по таймеру потока обработки
+    if (_collector.append(std::move(record)) == WAKE_UP_COUNT)
+    {
+        wakeUp();
+    }
+}
+
+void DBLogSink::setStatsParams(const DBLogStats::Params& params)
+{
+    _statsParams = params;
+}
+
+DBLogStats::Snapshot DBLogSink::stats() const noexcept
+{
+    return _stats.snapshot(queueSize());
+}
+
+void DBLogSink::addTruncated() noexcept
+{
+    _stats.addTruncated();
+}
+
+DBConnectionSupervisor::State DBLogSink::connectionState() const noexcept
+{
+    return _supervisor->state();
+}
+
+DBFlushController::State DBLogSink::flushState() const
+{
+    return _flushController.state();
+}
+
+void DBLogSink::stop(const QDeadlineTimer& deadline)
+{
+    _drainDeadline.store(deadline.deadline(), std::memory_order_release);
+
+    stop();
+}
+
+void DBLogSink::started()
+{
+    _lastReportTime = QDeadlineTimer::current().deadline();
+
+    //сообщения, не записанные в БД при прошлых запусках, будут записаны после подключения
+    auto spool = std::make_unique<DBLogSpool>(_spoolParams);
+    if (spool->open())
+    {
+        _spool = std::move(spool);
+    }
+    else
+    {
+        qWarning() << QString("DB log spool is disabled. Not saved messages will be written to the log file. Error: %1").arg(spool->errorString());
+    }
+
+    //устаревшие логи удаляются в фоне отдельным подключением, запуск не ждет удаления
+    _retention = std::make_unique<DBLogRetention>(_dbConnectionInfo, _schema, _retentionParams);
+
+    if (_localStoreParams.isEnabled)
+    {
+        auto localStore = std::make_unique<DBLogLocalStore>(_localStoreParams, _dbConnectionInfo, _schema, _sender);
+
+        QString errorString;
+        if (localStore->open(errorString))
+        {
+            //с центральной БД работает только поток пересылки локального хранилища
+            _localStore = std::move(localStore);
+
+            _connectPromise.set_value(QString());
+
+            return;
+        }
+
+        qWarning() << QString("Local log store is disabled. Messages will be written to DB directly. Error: %1").arg(errorString);
+    }
+
+    if (_bulkParams.isEnabled && DBBulkLoader::isSupported(_dbConnectionInfo.driver))
+    {
+        _bulkLoader = std::make_unique<DBBulkLoader>(_bulkParams, _schema, _sender);
+    }
+
+    //при ошибке приемник работает без БД, пока наблюдатель не восстановит подключение
+    QString errorString;
+    if (!ensureConnected(errorString))
+    {
+        _isDBAvailable = false;
+    }
+
+    _connectPromise.set_value(errorString);
+}
+
+void DBLogSink::stopped()
+{
+    _retention.reset();
+
+    //после закрытия сборщика новые сообщения в буферы не попадают
+    _collector.close();
+    collectRecords();
+
+    if (!_batch.empty())
+    {
+        if (isDrainExpired())
+        {
+            spillBatch();
+        }
+        else
+        {
+            writeBatch();
+        }
+    }
+
+    if (_spool)
+    {
+        if (!_spool->flush())
+        {
+            qWarning() << QString("Cannot write DB log spool. Error: %1").arg(_spool->errorString());
+        }
+
+        if (!_spool->isEmpty())
+        {
+            qWarning() << QString("DB log spool is not empty (%1 bytes). Messages will be saved to DB after the next start").arg(_spool->size());
+        }
+
+        _spool.reset();
+    }
+
+    _localStore.reset();
+
+    if (_db.isOpen())
+    {
+        _statements.reset();
+
+        closeDB(_db);
+    }
+
+    if (_savedToFileCount > 0)
+    {
+        qWarning() << QString("%1 log messages were not saved to DB and were saved to the log file instead").arg(_savedToFileCount);
+
+        _savedToFileCount = 0;
+    }
+}
+
+void DBLogSink::writeRecord(const LogRecord& record)
+{
+    const auto now = QDeadlineTimer::current().deadline();
+    updateIncomingRate(1, now);
+
+    _stats.addReceived(1);
+
+    //пока БД недоступна или в дисковой очереди есть сообщения - новые сообщения идут в очередь, чтобы не нарушать их порядок.
+    //Если БД доступна, но не успевает записывать сообщения, они также уходят в дисковую очередь, не накапливаясь в памяти
+    if (isDrainExpired() || checkMemoryQueue() || (_spool && (!_isDBAvailable || !_spool->isEmpty())))
+    {
+        spill(record);
+
+        return;
+    }
+
+    _batch.push_back(record);
+
+    _flushController.add(record.msg.size() * static_cast<qint64>(sizeof(QChar)) + RECORD_OVERHEAD, now);
+
+    if (_flushController.isFlushNeeded(now))
+    {
+        writeBatch();
+    }
+}
+
+void DBLogSink::flushRecords()
+{
+    const auto now = QDeadlineTimer::current().deadline();
+    updateIncomingRate(0, now);
+    reportStats(now);
+
+    collectRecords();
+
+    if (_spool)
+    {
+        if (!_spool->flush())
+        {
+            qWarning() << QString("Cannot write DB log spool. Error: %1").arg(_spool->errorString());
+        }
+
+        replaySpool();
+    }
+
+    //пачка копится между пробуждениями потока, пока не наберется или не истечет максимальная задержка
+    if (_flushController.isFlushNeeded(QDeadlineTimer::current().deadline()))
+    {
+        writeBatch();
+    }
+}
+
+void DBLogSink::collectRecords()
+{
+    _collector.drain(_collected);
+
+    for (const auto& record: _collected)
+    {
+        writeRecord(record);
+    }
+
+    _collected.clear();
+}
+
+void DBLogSink::writeBatch()
+{
+    if (_batch.empty())
+    {
+        return;
+    }
+
+    QElapsedTimer commitTimer;
+    commitTimer.start();
+
+    QString errorString;
+    const bool isSuccess = insertRecords(_batch, _incomingRate >= _bulkParams.rateThreshold, errorString);
+
+    _flushController.flushed(commitTimer.elapsed(), isSuccess);
+
+    if (isSuccess)
+    {
+        _stats.addFlush(static_cast<qint64>(_batch.size()), commitTimer.nsecsElapsed() / 1000);
+
+        _isDBAvailable = true;
+        _batch.clear();
+
+        return;
+    }
+
+    _stats.addFailedFlush();
+
+    setDBUnavailable(errorString);
+
+    spillBatch();
+}
+
+void DBLogSink::spillBatch()
+{
+    for (const auto& record: _batch)
+    {
+        spill(record);
+    }
+
+    _batch.clear();
+
+    //пачка больше не накапливается: иначе устаревшие счетчики вызвали бы досрочную запись следующей пачки
+    _flushController.reset();
+
+    if (_spool && !_spool->flush())
+    {
+        qWarning() << QString("Cannot write DB log spool. Error: %1").arg(_spool->errorString());
+    }
+}
+
+void DBLogSink::spill(const LogRecord& record)
+{
+    if (!_spool)
+    {
+        saveToFile(record);
+
+        return;
+    }
+
+    _stats.addSpilled(1);
+
+    //при ошибке записи сообщение остается в буфере очереди и будет записано при следующей попытке
+    if (!_spool->append(record))
+    {
+        qWarning() << QString("Cannot write DB log spool. Error: %1").arg(_spool->errorString());
+    }
+}
+
+bool DBLogSink::checkMemoryQueue()
+{
+    const auto maxSize = _spoolParams.maxMemoryQueueSize;
+    if (maxSize <= 0)
+    {
+        return false;
+    }
+
+    const auto size = queueSize() + static_cast<qint64>(_batch.size());
+    if (!_isMemoryQueueFull && size > maxSize)
+    {
+        _isMemoryQueueFull = true;
+
+        qWarning() << QString("DB log queue exceeds %1 messages. New messages will be spooled until the queue is drained").arg(maxSize);
+
+        //накопленная пачка старше новых сообщений - она уходит в дисковую очередь первой
+        spillBatch();
+    }
+    else if (_isMemoryQueueFull && size <= maxSize / 2)
+    {
+        _isMemoryQueueFull = false;
+    }
+
+    return _isMemoryQueueFull;
+}
+
+void DBLogSink::replaySpool()
+{
+    Q_ASSERT(_spool);
+
+    if (_spool->isEmpty() || isDrainExpired() || !_supervisor->isAvailable() || QDeadlineTimer::current().deadline() < _nextReplayTime)
+    {
+        return;
+    }
+
+    QElapsedTimer sliceTimer;
+    sliceTimer.start();
+
+    qint64 replayedCount = 0;
+    std::vector<LogRecord> records;
+    records.reserve(REPLAY_BATCH_SIZE);
+
+    while (!_spool->isEmpty() && !sliceTimer.hasExpired(REPLAY_TIME_SLICE) && !isDrainExpired())
+    {
+        records.clear();
+        if (!_spool->read(records, REPLAY_BATCH_SIZE))
+        {
+            if (_spool->isError())
+            {
+                qWarning() << QString("Cannot read DB log spool. Error: %1").arg(_spool->errorString());
+
+                _nextReplayTime = QDeadlineTimer::current().deadline() + REPLAY_RETRY_INTERVAL;
+            }
+
+            break;
+        }
+
+        QElapsedTimer commitTimer;
+        commitTimer.start();
+
+        QString errorString;
+        if (!insertRecords(records, true, errorString))
+        {
+            _stats.addFailedFlush();
+
+            setDBUnavailable(errorString);
+
+            return;
+        }
+
+        _stats.addFlush(static_cast<qint64>(records.size()), commitTimer.nsecsElapsed() / 1000);
+
+        _spool->commitRead();
+
+        replayedCount += static_cast<qint64>(records.size());
+    }
+
+    if (replayedCount > 0 && !_isDBAvailable)
+    {
+        _isDBAvailable = true;
+
+        qInfo() << QString("Log DB is available again. Messages saved from the DB log spool: %1").arg(replayedCount);
+    }
+}
+
+bool DBLogSink::insertRecords(const std::vector<LogRecord>& records, bool isHighVolume, QString& errorString)
+{
+    if (_localStore)
+    {
+        return _localStore->insert(records, errorString);
+    }
+
+    if (!ensureConnected(errorString))
+    {
+        return false;
+    }
+
+    if (!_bulkLoader || !isHighVolume || static_cast<qint64>(records.size()) < _bulkParams.minRows)
+    {
+        return executeInsert(records, errorString);
+    }
+
+    QString bulkErrorString;
+    if (executeBulkLoad(records, bulkErrorString))
+    {
+        return true;
+    }
+
+    if (!executeInsert(records, errorString))
+    {
+        return false;
+    }
+
+    //БД доступна - значит массовая загрузка не настроена на сервере или клиенте (local_infile, права, доступ сервера к файлу)
+    qWarning() << QString("Bulk load to log DB is disabled. Messages will be saved by batch insert. Error: %1").arg(bulkErrorString);
+
+    _bulkLoader.reset();
+
+    return true;
+}
+
+bool DBLogSink::executeInsert(const std::vector<LogRecord>& records, QString& errorString)
+{
+    Q_ASSERT(_db.isOpen());
+
+    try
+    {
+        //без переподключения: восстановлением подключения занимается наблюдатель. При ошибке транзакция откатывается
+        DBTransaction transaction(_db);
+
+        //подготовленные запросы переиспользуются: запрос разбирается сервером один раз на подключение
+        _schema.insertRecords(_db, *_statements, records, _sender);
+
+        transaction.commit();
+    }
+    catch (const SQLException& err)
+    {
+        errorString = err.what();
+
+        //подключение могло быть разорвано - оно будет переоткрыто после проверки доступности БД наблюдателем
+        _statements.reset();
+        closeDB(_db);
+
+        _supervisor->reportFailure(errorString);
+
+        return false;
+    }
+
+    return true;
+}
+
+bool DBLogSink::executeBulkLoad(const std::vector<LogRecord>& records, QString& errorString)
+{
+    Q_ASSERT(_db.isOpen());
+    Q_ASSERT(_bulkLoader);
+
+    try
+    {
+        DBTransaction transaction(_db);
+
+        _bulkLoader->load(_db, records);
+
+        transaction.commit();
+    }
+    catch (const SQLException& err)
+    {
+        errorString = err.what();
+
+        return false;
+    }
+
+    return true;
+}
+
+void DBLogSink::updateIncomingRate(qint64 count, qint64 now)
+{
+    _rateWindowCount += count;
+
+    const auto elapsed = now - _rateWindowStart;
+    if (elapsed < RATE_WINDOW)
+    {
+        return;
+    }
+
+    //после долгого простоя первый интервал дает заниженную оценку, что безопасно - массовая загрузка не включится случайно
+    _incomingRate = _rateWindowCount * 1000 / elapsed;
+    _rateWindowStart = now;
+    _rateWindowCount = 0;
+
+    _stats.setIncomingRate(_incomingRate);
+}
+
+void DBLogSink::reportStats(qint64 now)
+{
+    const auto interval = now - _lastReportTime;
+    if (_statsParams.reportInterval <= 0 || interval < _statsParams.reportInterval)
+    {
+        return;
+    }
+
+    const auto current = stats();
+
+    qInfo() << DBLogStats::makeReport(current, _lastReport, interval);
+
+    _lastReport = current;
+    _lastReportTime = now;
+}
+
+bool DBLogSink::ensureConnected(QString& errorString)
+{
+    if (_db.isOpen())
+    {
+        return true;
+    }
+
+    if (!_supervisor->isAvailable())
+    {
+        errorString = QString("Log DB %1 is unavailable. Reconnecting in background").arg(_dbConnectionInfo.dbName);
+
+        return false;
+    }
+
+    try
+    {
+        connectToDB(_db, _dbConnectionInfo, _logDBName);
+
+        _schema.prepare(_db, _sender);
+
+        _statements = std::make_unique<DBStatementCache>(_db);
+    }
+    catch (const SQLException& err)
+    {
+        errorString = err.what();
+
+        _statements.reset();
+        closeDB(_db);
+
+        _supervisor->reportFailure(errorString);
+
+        return false;
+    }
+
+    return true;
+}
+
+void DBLogSink::setDBUnavailable(const QString& errorString)
+{
+    //об ошибке сообщается один раз за время недоступности БД
+    if (!_isDBAvailable)
+    {
+        return;
+    }
+
+    _isDBAvailable = false;
+
+    writeLogFile("ERROR_SAVE_TO_LOG_DB", errorString);
+
+    qCritical() << QString("Error save to log DB. Message: %1").arg(errorString);
+
+    if (_errorHandler)
+    {
+        _errorHandler(errorString);
+    }
+}
+
+bool DBLogSink::isDrainExpired() const noexcept
+{
+    return QDeadlineTimer::current().deadline() >= _drainDeadline.load(std::memory_order_acquire);
+}
+
+void DBLogSink::saveToFile(const LogRecord& record)
+{
+    ++_savedToFileCount;
+    _stats.addSavedToFile(1);
+
+    const auto category = TDBLoger::msgCodeToQString(static_cast<TDBLoger::MSG_CODE>(record.level));
+
+    writeLogFile("NOT_SAVED_TO_LOG_DB", QString("%1 %2 %3")
+                                            .arg(QDateTime::fromMSecsSinceEpoch(record.dateTime).toString(DATETIME_FORMAT))
+                                            .arg(category)
+                                            .arg(record.msg));
+}
@@ -0,0 +1,471 @@
+//STL
+#include <algorithm>
+#include <array>
+
+//Qt
+#include <QtEndian>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QCoreApplication>
+
+//My
+#include "Common/common.h"
+
+#include "Common/dblogspool.h"
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Common;
+
+static const qint64 RECORD_HEADER_SIZE = 2 * sizeof(quint32);                   ///< Размер заголовка записи [размер:4][CRC32:4]
+static const qint64 RECORD_MIN_SIZE = sizeof(qint64) + sizeof(quint8);          ///< Минимальный размер данных записи (время и уровень)
+static const qsizetype MAX_WRITE_BUFFER_SIZE = 1024 * 1024;                     ///< 1MB. Размер буфера, при превышении которого он записывается не дожидаясь flush()
+
+/*!
+    Формирует таблицу CRC32 (полином 0xEDB88320, как в zlib)
+    @return таблица
+*/
+static constexpr std::array<quint32, 256> makeCrc32Table()
+{
+    std::array<quint32, 256> table = {};
+    for (quint32 i = 0; i < 256; ++i)
+    {
+        quint32 crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : (crc >> 1);
+        }
+        table[i] = crc;
+    }
+
+    return table;
+}
+
+static constexpr auto CRC32_TABLE = makeCrc32Table();
+
+/*!
+    Вычисляет CRC32 данных
+    @param data - данные
+    @param size - размер данных
+    @return CRC32
+*/
+static quint32 crc32(const char* data, qsizetype size)
+{
+    quint32 crc = 0xFFFFFFFFu;
+    for (qsizetype i = 0; i < size; ++i)
+    {
+        crc = CRC32_TABLE[(crc ^ static_cast<quint8>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/*!
+    Добавляет значение в буфер в порядке байт little-endian
+    @param buffer - буфер
+    @param value - значение
+*/
+template <typename T>
+static void appendLittleEndian(QByteArray& buffer, T value)
+{
+    char data[sizeof(T)];
+    qToLittleEndian<T>(value, data);
+
+    buffer.append(data, sizeof(T));
+}
+
+/*!
+    Сбрасывает данные файла на диск
+    @param file - открытый файл
+    @return true - в случае успеха
+*/
+static bool syncFile(QFile& file)
+{
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+DBLogSpool::DBLogSpool(const Params& params)
+    : _params(params)
+{
+    Q_ASSERT(_params.maxSegmentSize > 0);
+    Q_ASSERT(_params.maxSize >= _params.maxSegmentSize);
+}
+
+DBLogSpool::~DBLogSpool()
+{
+    flush();
+
+    closeWriteSegment();
+}
+
+bool DBLogSpool::open()
+{
+    _dirName = _params.dirName.isEmpty()
+        ? QFileInfo(QString("./Log/%1.dbspool").arg(QCoreApplication::applicationName())).absoluteFilePath()
+        : QFileInfo(_params.dirName).absoluteFilePath();
+
+    QDir dir(_dirName);
+    if (!dir.exists() && !dir.mkpath(_dirName))
+    {
+        _errorString = QString("Cannot make DB log spool dir: %1").arg(_dirName);
+
+        return false;
+    }
+
+    //сегменты, оставшиеся от предыдущих запусков. Имена фиксированной длины, поэтому сортировка по имени совпадает с порядком ИД
+    for (const auto& fileInfo: dir.entryInfoList(QStringList{"*" + DB_LOG_SPOOL_SEGMENT_SUFFIX}, QDir::Files, QDir::Name))
+    {
+        bool isOk = false;
+        const auto id = fileInfo.completeBaseName().toULongLong(&isOk, 16);
+        if (isOk)
+        {
+            _segments.push_back(id);
+            _size += fileInfo.size();
+        }
+    }
+
+    QFile positionFile(dir.absoluteFilePath(DB_LOG_SPOOL_POSITION_FILE));
+    if (positionFile.open(QFile::ReadOnly))
+    {
+        const auto data = positionFile.readAll();
+        if (data.size() == sizeof(quint64) + sizeof(qint64))
+        {
+            const auto id = qFromLittleEndian<quint64>(data.constData());
+            const auto offset = qFromLittleEndian<qint64>(data.constData() + sizeof(quint64));
+
+            //сегменты до сохраненной позиции прочитаны полностью, но процесс завершился до их удаления
+            while (!_segments.empty() && _segments.front() < id)
+            {
+                removeFirstSegment();
+            }
+
+            if (!_segments.empty() && _segments.front() == id)
+            {
+                _readOffset = offset;
+                _pendingReadOffset = offset;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool DBLogSpool::isEmpty() const noexcept
+{
+    return _segments.empty() && _writeBuffer.isEmpty();
+}
+
+bool DBLogSpool::append(const LogRecord& record)
+{
+    QByteArray data;
+    data.reserve(RECORD_MIN_SIZE + record.msg.size() * sizeof(char16_t));
+    appendLittleEndian<qint64>(data, record.dateTime);
+    data += static_cast<char>(record.level);
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    data.append(reinterpret_cast<const char*>(record.msg.utf16()), record.msg.size() * sizeof(char16_t));
+#else
+    for (const auto& ch: record.msg)
+    {
+        appendLittleEndian<quint16>(data, ch.unicode());
+    }
+#endif
+
+    appendLittleEndian<quint32>(_writeBuffer, static_cast<quint32>(data.size()));
+    appendLittleEndian<quint32>(_writeBuffer, crc32(data.constData(), data.size()));
+    _writeBuffer += data;
+
+    if (_writeBuffer.size() >= MAX_WRITE_BUFFER_SIZE)
+    {
+        return flush();
+    }
+
+    return true;
+}
+
+bool DBLogSpool::flush()
+{
+    if (_writeBuffer.isEmpty())
+    {
+        return true;
+    }
+
+    if (_writeFile && _writeOffset > 0 && _writeOffset + _writeBuffer.size() > _params.maxSegmentSize)
+    {
+        closeWriteSegment();
+    }
+
+    if (!_writeFile && !openWriteSegment())
+    {
+        return false;
+    }
+
+    if (_writeFile->write(_writeBuffer) != _writeBuffer.size())
+    {
+        _errorString = QString("Cannot write DB log spool file: %1. %2").arg(_writeFile->fileName()).arg(fileErrorToString(_writeFile->error()));
+
+        //сегмент мог быть записан частично - следующие записи пишутся в новый сегмент, оборванная запись будет пропущена при чтении
+        closeWriteSegment();
+
+        return false;
+    }
+
+    _writeOffset += _writeBuffer.size();
+    _size += _writeBuffer.size();
+    _writeBuffer.clear();
+
+    if (_params.syncPolicy == SyncPolicy::FLUSH && !syncFile(*_writeFile))
+    {
+        _errorString = QString("Cannot sync DB log spool file: %1").arg(_writeFile->fileName());
+
+        return false;
+    }
+
+    //очередь ограничена по объему - при переполнении теряются самые старые сообщения
+    while (_size > _params.maxSize && _segments.size() > 1)
+    {
+        qWarning() << QString("DB log spool size limit exceeded. Segment %1 removed").arg(segmentFileName(_segments.front()));
+
+        removeFirstSegment();
+    }
+
+    return true;
+}
+
+bool DBLogSpool::read(std::vector<LogRecord>& records, qsizetype maxCount)
+{
+    if (!flush())
+    {
+        return false;
+    }
+
+    _pendingReadOffset = _readOffset;
+
+    while (!_segments.empty())
+    {
+        if (!_readFile)
+        {
+            auto readFile = std::make_unique<QFile>(segmentFileName(_segments.front()));
+            if (!readFile->open(QFile::ReadOnly | QFile::Unbuffered))
+            {
+                _errorString = QString("Cannot open DB log spool file: %1. %2").arg(readFile->fileName()).arg(fileErrorToString(readFile->error()));
+
+                return false;
+            }
+
+            _readFile = std::move(readFile);
+        }
+
+        const auto end = isReadingWriteSegment() ? _writeOffset : _readFile->size();
+
+        qsizetype count = 0;
+        bool isCorrupted = false;
+        if (_pendingReadOffset < end && !_readFile->seek(_pendingReadOffset))
+        {
+            isCorrupted = true;
+        }
+
+        while (!isCorrupted && count < maxCount && _pendingReadOffset + RECORD_HEADER_SIZE <= end)
+        {
+            const auto header = _readFile->read(RECORD_HEADER_SIZE);
+            if (header.size() != RECORD_HEADER_SIZE)
+            {
+                isCorrupted = true;
+
+                break;
+            }
+
+            const auto dataSize = static_cast<qint64>(qFromLittleEndian<quint32>(header.constData()));
+            const auto crc = qFromLittleEndian<quint32>(header.constData() + sizeof(quint32));
+            if (dataSize < RECORD_MIN_SIZE || (dataSize - RECORD_MIN_SIZE) % sizeof(char16_t) != 0
+                || _pendingReadOffset + RECORD_HEADER_SIZE + dataSize > end)
+            {
+                isCorrupted = true;
+
+                break;
+            }
+
+            const auto data = _readFile->read(dataSize);
+            if (data.size() != dataSize || crc32(data.constData(), data.size()) != crc)
+            {
+                isCorrupted = true;
+
+                break;
+            }
+
+            LogRecord record;
+            record.dateTime = qFromLittleEndian<qint64>(data.constData());
+            record.targets = LogSink::TARGET_DB;
+            record.level = static_cast<LogLevel>(data.at(sizeof(qint64)));
+
+            const auto textSize = (dataSize - RECORD_MIN_SIZE) / static_cast<qint64>(sizeof(char16_t));
+            record.msg.resize(textSize);
+            for (qint64 i = 0; i < textSize; ++i)
+            {
+                record.msg[i] = QChar(qFromLittleEndian<quint16>(data.constData() + RECORD_MIN_SIZE + i * sizeof(char16_t)));
+            }
+
+            records.emplace_back(std::move(record));
+
+            _pendingReadOffset += RECORD_HEADER_SIZE + dataSize;
+            ++count;
+        }
+
+        if (count > 0)
+        {
+            return true;
+        }
+
+        if (isCorrupted || (_pendingReadOffset < end && !isReadingWriteSegment()))
+        {
+            qWarning() << QString("DB log spool file is corrupted: %1. Position: %2. Lost bytes: %3")
+                              .arg(_readFile->fileName()).arg(_pendingReadOffset).arg(end - _pendingReadOffset);
+
+            _pendingReadOffset = end;
+        }
+
+        //сегмент прочитан полностью
+        _readOffset = _pendingReadOffset;
+        if (isReadingWriteSegment())
+        {
+            closeWriteSegment();
+        }
+
+        removeFirstSegment();
+    }
+
+    return false;
+}
+
+void DBLogSpool::commitRead()
+{
+    _readOffset = _pendingReadOffset;
+
+    if (!_segments.empty() && _readFile)
+    {
+        const auto end = isReadingWriteSegment() ? _writeOffset : _readFile->size();
+        if (_readOffset >= end)
+        {
+            if (isReadingWriteSegment())
+            {
+                closeWriteSegment();
+            }
+
+            removeFirstSegment();
+
+            return;
+        }
+    }
+
+    savePosition();
+}
+
+bool DBLogSpool::isError() const noexcept
+{
+    return !_errorString.isEmpty();
+}
+
+QString DBLogSpool::errorString()
+{
+    const QString result(_errorString);
+    _errorString.clear();
+
+    return result;
+}
+
+QString DBLogSpool::segmentFileName(quint64 id) const
+{
+    return QDir(_dirName).absoluteFilePath(QString("%1%2").arg(id, 16, 16, QChar('0')).arg(DB_LOG_SPOOL_SEGMENT_SUFFIX));
+}
+
+bool DBLogSpool::openWriteSegment()
+{
+    Q_ASSERT(!_writeFile);
+
+    const quint64 id = _segments.empty() ? 1 : _segments.back() + 1;
+
+    auto writeFile = std::make_unique<QFile>(segmentFileName(id));
+    if (!writeFile->open(QFile::WriteOnly | QFile::Truncate | QFile::Unbuffered))
+    {
+        _errorString = QString("Cannot open DB log spool file to write: %1. %2").arg(writeFile->fileName()).arg(fileErrorToString(writeFile->error()));
+
+        return false;
+    }
+
+    _segments.push_back(id);
+    _writeFile = std::move(writeFile);
+    _writeOffset = 0;
+
+    return true;
+}
+
+void DBLogSpool::closeWriteSegment()
+{
+    if (!_writeFile)
+    {
+        return;
+    }
+
+    if (_params.syncPolicy != SyncPolicy::NONE)
+    {
+        syncFile(*_writeFile);
+    }
+
+    _writeFile.reset();
+    _writeOffset = 0;
+}
+
+bool DBLogSpool::isReadingWriteSegment() const noexcept
+{
+    return _writeFile && _segments.size() == 1;
+}
+
+void DBLogSpool::removeFirstSegment()
+{
+    Q_ASSERT(!_segments.empty());
+    Q_ASSERT(!isReadingWriteSegment());
+
+    _readFile.reset();
+
+    const auto fileName = segmentFileName(_segments.front());
+    _size = std::max<qint64>(_size - QFileInfo(fileName).size(), 0);
+
+    QFile::remove(fileName);
+
+    _segments.pop_front();
+    _readOffset = 0;
+    _pendingReadOffset = 0;
+
+    savePosition();
+}
+
+void DBLogSpool::savePosition()
+{
+    const auto fileName = QDir(_dirName).absoluteFilePath(DB_LOG_SPOOL_POSITION_FILE);
+
+    if (_segments.empty())
+    {
+        QFile::remove(fileName);
+
+        return;
+    }
+
+    QByteArray data;
+    appendLittleEndian<quint64>(data, _segments.front());
+    appendLittleEndian<qint64>(data, _readOffset);
+
+    QSaveFile file(fileName);
+    if (!file.open(QFile::WriteOnly) || file.write(data) != data.size() || !file.commit())
+    {
+        _errorString = QString("Cannot save DB log spool position: %1. %2").arg(fileName).arg(file.errorString());
+    }
+}
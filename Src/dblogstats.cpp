@@ -0,0 +1,152 @@
+//STL
+#include <algorithm>
+#include <cmath>
+
+//Qt
+#include <QtAlgorithms>
+
+//My
+#include "Common/dblogstats.h"
+
+using namespace Common;
+
+qint64 DBLogLatencyHistogram::Snapshot::average() const noexcept
+{
+    return count > 0 ? sum / count : 0;
+}
+
+qint64 DBLogLatencyHistogram::Snapshot::percentile(double percent) const noexcept
+{
+    if (count <= 0)
+    {
+        return 0;
+    }
+
+    //ранг значения процентиля среди всех значений (1..count)
+    const auto rank = std::max<qint64>(static_cast<qint64>(std::ceil(count * std::clamp(percent, 0.0, 100.0) / 100.0)), 1);
+
+    qint64 total = 0;
+    for (qsizetype i = 0; i < BUCKET_COUNT; ++i)
+    {
+        total += buckets[i];
+        if (total >= rank)
+        {
+            return i == 0 ? 0 : std::min<qint64>(Q_INT64_C(1) << i, max);
+        }
+    }
+
+    return max;
+}
+
+void DBLogLatencyHistogram::add(qint64 usec) noexcept
+{
+    usec = std::max<qint64>(usec, 0);
+
+    //номер корзины - количество значащих бит значения
+    const auto index = std::min<qsizetype>(64 - qCountLeadingZeroBits(static_cast<quint64>(usec)), BUCKET_COUNT - 1);
+
+    _buckets[index].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(usec, std::memory_order_relaxed);
+
+    auto max = _max.load(std::memory_order_relaxed);
+    while (usec > max && !_max.compare_exchange_weak(max, usec, std::memory_order_relaxed))
+    {
+    }
+}
+
+DBLogLatencyHistogram::Snapshot DBLogLatencyHistogram::snapshot() const noexcept
+{
+    Snapshot result;
+    result.count = _count.load(std::memory_order_relaxed);
+    result.sum = _sum.load(std::memory_order_relaxed);
+    result.max = _max.load(std::memory_order_relaxed);
+
+    for (qsizetype i = 0; i < BUCKET_COUNT; ++i)
+    {
+        result.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+    }
+
+    return result;
+}
+
+void DBLogStats::addReceived(qint64 count) noexcept
+{
+    _receivedCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+void DBLogStats::addFlush(qint64 count, qint64 usec) noexcept
+{
+    _writtenCount.fetch_add(count, std::memory_order_relaxed);
+    _flushCount.fetch_add(1, std::memory_order_relaxed);
+
+    _commitLatency.add(usec);
+}
+
+void DBLogStats::addFailedFlush() noexcept
+{
+    _failedFlushCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DBLogStats::addSpilled(qint64 count) noexcept
+{
+    _spilledCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+void DBLogStats::addSavedToFile(qint64 count) noexcept
+{
+    _savedToFileCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+void DBLogStats::addTruncated() noexcept
+{
+    _truncatedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DBLogStats::setIncomingRate(qint64 rate) noexcept
+{
+    _incomingRate.store(rate, std::memory_order_relaxed);
+}
+
+DBLogStats::Snapshot DBLogStats::snapshot(qint64 queueSize) const noexcept
+{
+    Snapshot result;
+    result.queueSize = queueSize;
+    result.incomingRate = _incomingRate.load(std::memory_order_relaxed);
+    result.receivedCount = _receivedCount.load(std::memory_order_relaxed);
+    result.writtenCount = _writtenCount.load(std::memory_order_relaxed);
+    result.flushCount = _flushCount.load(std::memory_order_relaxed);
+    result.failedFlushCount = _failedFlushCount.load(std::memory_order_relaxed);
+    result.spilledCount = _spilledCount.load(std::memory_order_relaxed);
+    result.savedToFileCount = _savedToFileCount.load(std::memory_order_relaxed);
+    result.truncatedCount = _truncatedCount.load(std::memory_order_relaxed);
+    result.commitLatency = _commitLatency.snapshot();
+
+    return result;
+}
+
+QString DBLogStats::makeReport(const Snapshot& current, const Snapshot& previous, qint64 interval)
+{
+    const auto writtenRate = interval > 0 ? (current.writtenCount - previous.writtenCount) * 1000 / interval : 0;
+
+    //задержки выводятся в мс с точностью до десятых
+    const auto toMs = [](qint64 usec) { return QString::number(static_cast<double>(usec) / 1000.0, 'f', 1); };
+
+    return QString("DB log stats. Queue: %1. Incoming: %2 msg/s. Written: %3 msg/s (total %4 in %5 commits). "
+                   "Commit latency, ms: avg %6, p50 %7, p95 %8, p99 %9, max %10. "
+                   "Failed commits: %11. Spilled: %12. Saved to file: %13. Truncated: %14")
+        .arg(current.queueSize)
+        .arg(current.incomingRate)
+        .arg(writtenRate)
+        .arg(current.writtenCount)
+        .arg(current.flushCount)
+        .arg(toMs(current.commitLatency.average()))
+        .arg(toMs(current.commitLatency.percentile(50)))
+        .arg(toMs(current.commitLatency.percentile(95)))
+        .arg(toMs(current.commitLatency.percentile(99)))
+        .arg(toMs(current.commitLatency.max))
+        .arg(current.failedFlushCount)
+        .arg(current.spilledCount)
+        .arg(current.savedToFileCount)
+        .arg(current.truncatedCount);
+}
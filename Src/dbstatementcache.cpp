@@ -0,0 +1,56 @@
+//STL
+#include <algorithm>
+
+//My
+#include "Common/dbstatementcache.h"
+
+using namespace Common;
+
+DBStatementCache::DBStatementCache(QSqlDatabase& db, qsizetype capacity /* = 32 */)
+    : _db(db)
+    , _capacity(std::max<qsizetype>(capacity, 1))
+{
+}
+
+DBStatementCache::~DBStatementCache()
+{
+    clear();
+}
+
+QSqlQuery& DBStatementCache::prepare(const QString& queryText)
+{
+    Q_ASSERT(_db.isOpen());
+
+    const auto index_it = _index.constFind(queryText);
+    if (index_it != _index.constEnd())
+    {
+        ++_hitCount;
+
+        //запрос становится последним использованным, итераторы списка при перемещении не меняются
+        _statements.splice(_statements.begin(), _statements, index_it.value());
+
+        return _statements.front().query;
+    }
+
+    ++_missCount;
+
+    QSqlQuery query(_db);
+    DBQueryPrepare(_db, query, queryText);
+
+    if (static_cast<qsizetype>(_statements.size()) >= _capacity)
+    {
+        _index.remove(_statements.back().queryText);
+        _statements.pop_back();
+    }
+
+    _statements.push_front(Statement{queryText, std::move(query)});
+    _index.insert(queryText, _statements.begin());
+
+    return _statements.front().query;
+}
+
+void DBStatementCache::clear()
+{
+    _index.clear();
+    _statements.clear();
+}
@@ -0,0 +1,464 @@
+//Qt
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDir>
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QtEndian>
+#include <QDeadlineTimer>
+
+//My
+#include "Common/common.h"
+#include "Common/logmaintenance.h"
+#include "Common/logfilereader.h"
+
+#include "Common/filelogsink.h"
+
+using namespace Common;
+
+static constexpr qsizetype MAX_FILE_LOG_SIZE = 100 * 1024 * 1024; ///< 100 MB максимальный размер файл лога
+static const int MAX_SAVE_LOG_INTERVAL = 30;            ///< Максимальный период хранение файла лога.
+static const qsizetype MAX_BATCH_SIZE = 64 * 1024;      ///< 64KB размер пачки, при превышении которого она записывается не дожидаясь опустошения очереди
+static const qint64 ROTATE_RETRY_INTERVAL = 60 * 1000;  ///< 1 мин. Интервал между попытками ротации, если переименовать файл не удалось, мс
+
+#ifdef Q_OS_WIN
+static const char LINE_END[] = "\r\n";                  ///< Окончание строки текстового файла лога
+#else
+static const char LINE_END[] = "\n";                    ///< Окончание строки текстового файла лога
+#endif
+
+/*!
+    Обслуживает ротированные файлы лога: удаляет файлы, последнее изменение которых было более MAX_SAVE_LOG_INTERVAL
+        дней назад, и сжимает оставшиеся несжатые файлы (см. compressLogFile(...))
+    @param fileName - полное имя текущего файла лога
+*/
+static void maintainOldFiles(const QString& fileName)
+{
+    const QFileInfo fileInfo(fileName);
+    const QDir dir(fileInfo.absolutePath());
+    const auto currentDateTime = QDateTime::currentDateTime();
+
+    const auto indexFileName = QFileInfo(logIndexFileName(fileName)).fileName();
+
+    for (const auto& oldFileName: dir.entryList(QDir::Files))
+    {
+        if (!oldFileName.startsWith(fileInfo.fileName()) || oldFileName == fileInfo.fileName() || oldFileName == indexFileName)
+        {
+            continue;
+        }
+
+        const QFileInfo oldFileInfo(dir.absoluteFilePath(oldFileName));
+        if (oldFileInfo.lastModified().daysTo(currentDateTime) > MAX_SAVE_LOG_INTERVAL)
+        {
+            QFile oldFile(oldFileInfo.absoluteFilePath());
+            if (!oldFile.remove())
+            {
+                QTextStream ss(stderr);
+                ss << QString("%1 ERR Cannot remove old log file: %2 %3\n")
+                          .arg(currentDateTime.toString(SIMPLY_TIME_FORMAT))
+                          .arg(oldFileName)
+                          .arg(fileErrorToString(oldFile.error()));
+            }
+
+            continue;
+        }
+
+        //индекс остается несжатым и используется для чтения сжатого файла
+        if (oldFileName.endsWith(LOG_ARCHIVE_SUFFIX) || oldFileName.endsWith(LOG_INDEX_SUFFIX))
+        {
+            continue;
+        }
+
+        try
+        {
+            compressLogFile(oldFileInfo.absoluteFilePath());
+        }
+        catch (const LogFileException& err)
+        {
+            QTextStream ss(stderr);
+            ss << QString("%1 ERR Cannot compress old log file: %2\n")
+                      .arg(currentDateTime.toString(SIMPLY_TIME_FORMAT))
+                      .arg(err.what());
+        }
+    }
+}
+
+/*!
+    Передает обслуживание ротированных файлов лога фоновому обработчику служебных задач
+    @param fileName - полное имя текущего файла лога
+*/
+static void postMaintainOldFiles(const QString& fileName)
+{
+    auto maintenance = LogMaintenance::instance();
+    if (maintenance)
+    {
+        maintenance->post([fileName](){ maintainOldFiles(fileName); });
+    }
+}
+
+/*!
+    Добавляет число в буфер в порядке little-endian
+    @param buffer - буфер
+    @param value - число
+*/
+template <typename T>
+static void appendLittleEndian(QByteArray& buffer, T value)
+{
+    char data[sizeof(T)];
+    qToLittleEndian<T>(value, data);
+
+    buffer.append(data, sizeof(T));
+}
+
+/*!
+    Добавляет текст в буфер в виде [размер в байтах:4][UTF-8]
+    @param buffer - буфер
+    @param text - текст
+*/
+static void appendBinaryText(QByteArray& buffer, const QString& text)
+{
+    //размер заранее неизвестен: место под него резервируется и заполняется после преобразования
+    const auto sizePos = buffer.size();
+    appendLittleEndian<quint32>(buffer, 0);
+
+    buffer += text.toUtf8();
+
+    qToLittleEndian<quint32>(static_cast<quint32>(buffer.size() - sizePos - sizeof(quint32)), buffer.data() + sizePos);
+}
+
+/*!
+    Добавляет в буфер определение префикса двоичного файла лога
+    @param buffer - буфер
+    @param id - ИД префикса
+    @param prefix - префикс
+*/
+static void appendBinaryPrefix(QByteArray& buffer, quint32 id, const QString& prefix)
+{
+    buffer += static_cast<char>(LogBinaryRecordType::PREFIX);
+    appendLittleEndian<quint32>(buffer, id);
+    appendBinaryText(buffer, prefix);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class FileLogSink
+///
+FileLogSink::FileLogSink()
+    : LogSink("File", TARGET_FILE)
+{
+}
+
+FileLogSink::~FileLogSink()
+{
+    stop();
+}
+
+void FileLogSink::setFileFormat(LogFileFormat format)
+{
+    _format.store(format, std::memory_order_release);
+}
+
+void FileLogSink::stopped()
+{
+    closeFile();
+}
+
+void FileLogSink::writeRecord(const LogRecord& record)
+{
+    const auto format = _format.load(std::memory_order_acquire);
+    if (format != _fileFormat)
+    {
+        writeFileBuffer();
+
+        closeFile();
+        _prefixIds.clear();
+        _fileFormat = format;
+    }
+
+    //возможная запись индекса. Окончательно записи отбираются при записи пачки, т.к. файл может быть ротирован
+    const auto bufferPos = _fileBuffer.size();
+    if (bufferPos == 0 || _fileSize + bufferPos >= _nextIndexPosition)
+    {
+        _indexCandidates.emplace_back(bufferPos, record.dateTime);
+        _nextIndexPosition = _fileSize + bufferPos + LOG_INDEX_INTERVAL;
+    }
+
+    if (_fileFormat == LogFileFormat::BINARY)
+    {
+        appendBinaryRecord(record);
+    }
+    else
+    {
+        appendTextRecord(record);
+    }
+
+    if (_fileBuffer.size() >= MAX_BATCH_SIZE)
+    {
+        writeFileBuffer();
+    }
+}
+
+void FileLogSink::flushRecords()
+{
+    writeFileBuffer();
+}
+
+void FileLogSink::appendTextRecord(const LogRecord& record)
+{
+    _fileBuffer += QDateTime::fromMSecsSinceEpoch(record.dateTime).toString(DATETIME_FORMAT).toUtf8();
+    _fileBuffer += ' ';
+    _fileBuffer += record.prefix.toUtf8();
+    _fileBuffer += ' ';
+    _fileBuffer += record.msg.toUtf8();
+    _fileBuffer += LINE_END;
+}
+
+void FileLogSink::appendBinaryRecord(const LogRecord& record)
+{
+    auto prefixIds_it = _prefixIds.constFind(record.prefix);
+    if (prefixIds_it == _prefixIds.constEnd())
+    {
+        const auto id = static_cast<quint32>(_prefixIds.size());
+        prefixIds_it = _prefixIds.insert(record.prefix, id);
+
+        appendBinaryPrefix(_fileBuffer, id, record.prefix);
+        appendBinaryPrefix(_indexBuffer, id, record.prefix);
+    }
+
+    _fileBuffer += static_cast<char>(LogBinaryRecordType::MESSAGE);
+    appendLittleEndian<qint64>(_fileBuffer, record.dateTime);
+    _fileBuffer += static_cast<char>(record.level);
+    appendLittleEndian<quint32>(_fileBuffer, prefixIds_it.value());
+    appendBinaryText(_fileBuffer, record.msg);
+}
+
+void FileLogSink::writeFileBuffer()
+{
+    if (_fileBuffer.isEmpty())
+    {
+        return;
+    }
+
+    qint64 position = -1;
+    auto errorString = prepareFile(_fileBuffer.size());
+    if (errorString.isEmpty())
+    {
+        if (_file->write(_fileBuffer) != _fileBuffer.size())
+        {
+            errorString = QString("Cannot write file. %1").arg(fileErrorToString(_file->error()));
+
+            _file.reset();
+        }
+        else
+        {
+            position = _fileSize;
+            _fileSize += _fileBuffer.size();
+        }
+    }
+
+    writeIndex(position);
+
+    if (!errorString.isEmpty())
+    {
+        QTextStream ss(stderr);
+        ss << QString("%1 ERR Messages not save to log file: %2. Messages:\n%3")
+                  .arg(QDateTime::currentDateTime().toString(SIMPLY_TIME_FORMAT))
+                  .arg(errorString)
+                  .arg(_fileFormat == LogFileFormat::BINARY ? QString("%1 bytes of binary log\n").arg(_fileBuffer.size()) : QString::fromUtf8(_fileBuffer));
+    }
+
+    _fileBuffer.clear();
+}
+
+void FileLogSink::writeIndex(qint64 position)
+{
+    if (position >= 0)
+    {
+        for (const auto& [bufferPos, dateTime]: _indexCandidates)
+        {
+            const auto filePos = position + bufferPos;
+            if (_lastIndexPosition >= 0 && filePos - _lastIndexPosition < LOG_INDEX_INTERVAL)
+            {
+                continue;
+            }
+
+            _indexBuffer += static_cast<char>(LogIndexRecordType::ENTRY);
+            appendLittleEndian<qint64>(_indexBuffer, dateTime);
+            appendLittleEndian<qint64>(_indexBuffer, filePos);
+
+            _lastIndexPosition = filePos;
+        }
+    }
+
+    _indexCandidates.clear();
+
+    if (!_indexFile || _indexBuffer.isEmpty())
+    {
+        _indexBuffer.clear();
+
+        return;
+    }
+
+    //ошибка индекса не влияет на запись лога - индекс просто перестает вестись до открытия следующего файла
+    if (_indexFile->write(_indexBuffer) != _indexBuffer.size())
+    {
+        QTextStream ss(stderr);
+        ss << QString("%1 ERR Cannot write log index file: %2. %3\n")
+                  .arg(QDateTime::currentDateTime().toString(SIMPLY_TIME_FORMAT))
+                  .arg(_indexFile->fileName())
+                  .arg(fileErrorToString(_indexFile->error()));
+
+        _indexFile.reset();
+    }
+
+    _indexBuffer.clear();
+}
+
+void FileLogSink::closeFile()
+{
+    _file.reset();
+    _indexFile.reset();
+}
+
+QString FileLogSink::prepareFile(qsizetype batchSize)
+{
+    if (!_file)
+    {
+        auto errorString = openFile();
+        if (!errorString.isEmpty())
+        {
+            return errorString;
+        }
+
+        //при первом открытии файла обслуживаем логи предыдущих запусков
+        postMaintainOldFiles(_fileName);
+    }
+
+    //после неудачной ротации файл временно превышает максимальный размер, чтобы не повторять попытку на каждой пачке
+    if (_fileSize > 0 && _fileSize + batchSize > MAX_FILE_LOG_SIZE && QDeadlineTimer::current().deadline() >= _rotateRetryTime)
+    {
+        return rotateFile();
+    }
+
+    return {};
+}
+
+QString FileLogSink::openFile()
+{
+    const auto fileInfo = QFileInfo(QString(_fileFormat == LogFileFormat::BINARY ? "./Log/%1.blog" : "./Log/%1.log")
+                                        .arg(QCoreApplication::applicationName()));
+    _fileName = fileInfo.absoluteFilePath();
+
+    QDir logDir(fileInfo.absolutePath());
+    if (!logDir.exists())
+    {
+        if (!logDir.mkpath(logDir.absolutePath()))
+        {
+            return QString("Cannot make log dir: %1").arg(logDir.absolutePath());
+        }
+    }
+
+    //файл открывается без QFile::Text: размер файла и смещения индекса вычисляются по размеру пачки в памяти,
+    //поэтому окончания строк записываются в пачку как есть (см. LINE_END)
+    auto file = std::make_unique<QFile>(_fileName);
+    if (!file->open(QFile::WriteOnly | QFile::Append | QFile::Unbuffered))
+    {
+        return QString("Cannot open file to write: %1. %2").arg(_fileName).arg(fileErrorToString(file->error()));
+    }
+
+    //размер файла запрашивается только при открытии, далее он учитывается в памяти
+    _fileSize = file->size();
+
+    //новый двоичный файл должен быть самодостаточным - повторяем в нем определения всех известных префиксов
+    if (_fileFormat == LogFileFormat::BINARY && _fileSize == 0)
+    {
+        QByteArray header(LOG_BINARY_MAGIC);
+        for (auto prefixIds_it = _prefixIds.constBegin(); prefixIds_it != _prefixIds.constEnd(); ++prefixIds_it)
+        {
+            appendBinaryPrefix(header, prefixIds_it.value(), prefixIds_it.key());
+        }
+
+        if (file->write(header) != header.size())
+        {
+            return QString("Cannot write file header: %1. %2").arg(_fileName).arg(fileErrorToString(file->error()));
+        }
+
+        _fileSize = header.size();
+    }
+
+    _file = std::move(file);
+
+    _lastIndexPosition = -1;
+    _nextIndexPosition = _fileSize;
+
+    auto indexFile = std::make_unique<QFile>(logIndexFileName(_fileName));
+    if (!indexFile->open(QFile::WriteOnly | QFile::Append | QFile::Unbuffered))
+    {
+        QTextStream ss(stderr);
+        ss << QString("%1 ERR Cannot open log index file: %2. %3\n")
+                  .arg(QDateTime::currentDateTime().toString(SIMPLY_TIME_FORMAT))
+                  .arg(indexFile->fileName())
+                  .arg(fileErrorToString(indexFile->error()));
+
+        return {};
+    }
+
+    //новый индекс двоичного файла содержит определения всех известных префиксов
+    if (indexFile->size() == 0)
+    {
+        QByteArray header(LOG_INDEX_MAGIC);
+        if (_fileFormat == LogFileFormat::BINARY)
+        {
+            for (auto prefixIds_it = _prefixIds.constBegin(); prefixIds_it != _prefixIds.constEnd(); ++prefixIds_it)
+            {
+                appendBinaryPrefix(header, prefixIds_it.value(), prefixIds_it.key());
+            }
+        }
+
+        _indexBuffer.prepend(header);
+    }
+
+    _indexFile = std::move(indexFile);
+
+    return {};
+}
+
+QString FileLogSink::rotateFile()
+{
+    //файл необходимо закрыть до переименования (в Windows открытый файл переименовать нельзя)
+    closeFile();
+
+    //ротированный ранее файл мог быть уже сжат: проверяется и имя сжатого файла
+    const auto rotatedBaseFileName = QString("%1_%2").arg(_fileName).arg(QDateTime::currentDateTime().toString("yyyy_MM_dd_hh_mm_ss_zzz"));
+    auto rotatedFileName = rotatedBaseFileName;
+    for (int number = 1; QFile::exists(rotatedFileName) || QFile::exists(rotatedFileName + LOG_ARCHIVE_SUFFIX); ++number)
+    {
+        rotatedFileName = QString("%1_%2").arg(rotatedBaseFileName).arg(number);
+    }
+
+    if (!QFile::rename(_fileName, rotatedFileName))
+    {
+        _rotateRetryTime = QDeadlineTimer::current().deadline() + ROTATE_RETRY_INTERVAL;
+
+        QTextStream ss(stderr);
+        ss << QString("%1 ERR Cannot rename old logs to: %2. Next attempt in %3 s\n")
+                  .arg(QDateTime::currentDateTime().toString(SIMPLY_TIME_FORMAT))
+                  .arg(rotatedFileName)
+                  .arg(ROTATE_RETRY_INTERVAL / 1000);
+
+        //ротированного файла не появилось - обслуживать нечего
+        return openFile();
+    }
+
+    _rotateRetryTime = 0;
+
+    //индекс текущего файла переходит к ротированному файлу, иначе он будет дополнен записями нового файла
+    const auto indexFileName = logIndexFileName(_fileName);
+    if (QFile::exists(indexFileName) && !QFile::rename(indexFileName, logIndexFileName(rotatedFileName)))
+    {
+        QFile::remove(indexFileName);
+    }
+
+    postMaintainOldFiles(_fileName);
+
+    return openFile();
+}
@@ -0,0 +1,500 @@
+//STL
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <new>
+
+//Qt
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QDir>
+
+//My
+#include "Common/logcrashbuffer.h"
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+using namespace Common;
+
+static_assert((LogCrashBuffer::SLOT_COUNT & (LogCrashBuffer::SLOT_COUNT - 1)) == 0, "SLOT_COUNT must be a power of 2");
+
+static LogCrashBuffer crashBuffer;                      ///< Глобальный буфер. Размещается в статической памяти без динамической инициализации
+
+static constexpr qsizetype MAX_CRASH_FILE_NAME = 4096;  ///< Максимальная длина имени файла аварийного дампа, байт
+static char crashFileName[MAX_CRASH_FILE_NAME] = {};    ///< Имя файла аварийного дампа в локальной кодировке. Подготавливается заранее
+
+static const int CRASH_SIGNALS[] = {SIGSEGV, SIGABRT, SIGFPE, SIGILL
+#ifdef SIGBUS
+                                    , SIGBUS
+#endif
+                                   };                   ///< Сигналы аварийного завершения процесса
+
+#ifndef Q_OS_WIN
+static constexpr size_t ALTERNATE_STACK_SIZE = 64 * 1024; ///< 64KB размер альтернативного стека обработчика сигналов
+
+///////////////////////////////////////////////////////////////////////////////
+///     The AlternateStack class - альтернативный стек обработчика сигналов одного потока. Отключается и
+///         освобождается при завершении потока
+///
+class AlternateStack final
+{
+public:
+    /*!
+        Конструктор
+    */
+    AlternateStack() = default;
+
+    /*!
+        Деструктор. Отключает стек до освобождения его памяти
+    */
+    ~AlternateStack()
+    {
+        if (_stack)
+        {
+            stack_t stack = {};
+            stack.ss_flags = SS_DISABLE;
+            sigaltstack(&stack, nullptr);
+        }
+    }
+
+    /*!
+        Выделяет и устанавливает стек для текущего потока, если он еще не установлен
+        @return true - в случае успеха
+    */
+    bool install() noexcept
+    {
+        if (_stack)
+        {
+            return true;
+        }
+
+        std::unique_ptr<char[]> memory(new (std::nothrow) char[ALTERNATE_STACK_SIZE]);
+        if (!memory)
+        {
+            return false;
+        }
+
+        stack_t stack = {};
+        stack.ss_sp = memory.get();
+        stack.ss_size = ALTERNATE_STACK_SIZE;
+        if (sigaltstack(&stack, nullptr) != 0)
+        {
+            return false;
+        }
+
+        _stack = std::move(memory);
+
+        return true;
+    }
+
+private:
+    // Удаляем неиспользуемые конструкторы
+    Q_DISABLE_COPY_MOVE(AlternateStack);
+
+private:
+    std::unique_ptr<char[]> _stack; ///< Память стека. nullptr - стек не установлен
+
+};
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+///     The CrashWriter class - буферизированная запись в файловый дескриптор. Использует только async-signal-safe функции
+///
+class CrashWriter final
+{
+public:
+    /*!
+        Конструктор
+        @param fd - файловый дескриптор
+    */
+    explicit CrashWriter(int fd) noexcept
+        : _fd(fd)
+    {
+    }
+
+    /*!
+        Деструктор. Записывает остаток буфера
+    */
+    ~CrashWriter()
+    {
+        flush();
+    }
+
+    /*!
+        Добавляет данные в буфер. При заполнении буфер записывается в файловый дескриптор
+        @param data - данные
+        @param size - размер данных, байт
+    */
+    void append(const char* data, qsizetype size) noexcept
+    {
+        while (size > 0)
+        {
+            if (_size == BUFFER_SIZE)
+            {
+                flush();
+            }
+
+            const auto count = std::min(size, BUFFER_SIZE - _size);
+            std::memcpy(_buffer + _size, data, count);
+            _size += count;
+            data += count;
+            size -= count;
+        }
+    }
+
+    void append(const char* str) noexcept
+    {
+        append(str, static_cast<qsizetype>(std::strlen(str)));
+    }
+
+    void append(char ch) noexcept
+    {
+        append(&ch, 1);
+    }
+
+    /*!
+        Добавляет неотрицательное число в десятичном виде, дополняя его нулями слева до width символов
+    */
+    void appendNumber(quint64 value, int width = 0) noexcept
+    {
+        char digits[24];
+        int count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+        while (value > 0 && count < 24);
+
+        while (count < width && count < 24)
+        {
+            digits[count++] = '0';
+        }
+
+        while (count > 0)
+        {
+            append(digits[--count]);
+        }
+    }
+
+    /*!
+        Добавляет текст в UTF-16, преобразуя его в UTF-8
+    */
+    void appendUtf16(const char16_t* text, qsizetype size) noexcept
+    {
+        for (qsizetype i = 0; i < size; ++i)
+        {
+            quint32 code = text[i];
+            if (code >= 0xD800 && code <= 0xDBFF && i + 1 < size && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF)
+            {
+                code = 0x10000 + ((code - 0xD800) << 10) + (text[i + 1] - 0xDC00);
+                ++i;
+            }
+
+            if (code < 0x80)
+            {
+                append(static_cast<char>(code));
+            }
+            else if (code < 0x800)
+            {
+                append(static_cast<char>(0xC0 | (code >> 6)));
+                append(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+            else if (code < 0x10000)
+            {
+                append(static_cast<char>(0xE0 | (code >> 12)));
+                append(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                append(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+            else
+            {
+                append(static_cast<char>(0xF0 | (code >> 18)));
+                append(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+                append(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                append(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+        }
+    }
+
+    /*!
+        Добавляет время в формате "yyyy-MM-dd hh:mm:ss.zzz UTC"
+        @param dateTime - время (мс от начала эпохи)
+    */
+    void appendDateTime(qint64 dateTime) noexcept
+    {
+        if (dateTime < 0)
+        {
+            dateTime = 0;
+        }
+
+        //преобразование дней от начала эпохи в дату (без обращения к функциям времени, которые не являются async-signal-safe)
+        const qint64 days = dateTime / 86400000 + 719468;
+        const qint64 era = days / 146097;
+        const qint64 dayOfEra = days - era * 146097;
+        const qint64 yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const qint64 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const qint64 mp = (5 * dayOfYear + 2) / 153;
+        const qint64 day = dayOfYear - (153 * mp + 2) / 5 + 1;
+        const qint64 month = mp < 10 ? mp + 3 : mp - 9;
+        const qint64 year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+        const qint64 msOfDay = dateTime % 86400000;
+
+        appendNumber(year, 4);
+        append('-');
+        appendNumber(month, 2);
+        append('-');
+        appendNumber(day, 2);
+        append(' ');
+        appendNumber(msOfDay / 3600000, 2);
+        append(':');
+        appendNumber(msOfDay / 60000 % 60, 2);
+        append(':');
+        appendNumber(msOfDay / 1000 % 60, 2);
+        append('.');
+        appendNumber(msOfDay % 1000, 3);
+        append(" UTC");
+    }
+
+    /*!
+        Записывает буфер в файловый дескриптор
+    */
+    void flush() noexcept
+    {
+        const char* data = _buffer;
+        while (_size > 0)
+        {
+#ifdef Q_OS_WIN
+            const auto count = _write(_fd, data, static_cast<unsigned int>(_size));
+#else
+            const auto count = ::write(_fd, data, static_cast<size_t>(_size));
+#endif
+            if (count <= 0)
+            {
+#ifndef Q_OS_WIN
+                if (count < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+#endif
+                break;
+            }
+
+            data += count;
+            _size -= count;
+        }
+
+        _size = 0;
+    }
+
+private:
+    Q_DISABLE_COPY_MOVE(CrashWriter);
+
+    static constexpr qsizetype BUFFER_SIZE = 4096;   ///< Размер буфера, байт
+
+    const int _fd = -1;             ///< Файловый дескриптор
+    char _buffer[BUFFER_SIZE];      ///< Буфер
+    qsizetype _size = 0;            ///< Количество данных в буфере, байт
+
+};
+
+/*!
+    Возвращает название уровня сообщения
+    @param level - уровень сообщения
+    @return название уровня
+*/
+static const char* levelToString(LogLevel level) noexcept
+{
+    switch (level)
+    {
+    case LogLevel::DBG: return "DBG";
+    case LogLevel::INF: return "INF";
+    case LogLevel::WAR: return "WAR";
+    case LogLevel::CRY: return "CRY";
+    case LogLevel::FAT: return "FAT";
+    default: break;
+    }
+
+    return "UND";
+}
+
+/*!
+    Обработчик сигналов аварийного завершения процесса. Сохраняет буфер в файл и повторно генерирует сигнал
+        со стандартной обработкой
+    @param sig - номер сигнала
+*/
+static void crashSignalHandler(int sig)
+{
+#ifdef Q_OS_WIN
+    const int fd = _open(crashFileName, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    const int fd = ::open(crashFileName, O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+    if (fd >= 0)
+    {
+        {
+            CrashWriter writer(fd);
+            writer.append("===== Process crashed. Signal: ");
+            writer.appendNumber(static_cast<quint64>(sig));
+            writer.append(". Last log messages: =====\n");
+        }
+
+        crashBuffer.dump(fd);
+
+#ifdef Q_OS_WIN
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class LogCrashBuffer
+///
+LogCrashBuffer* LogCrashBuffer::instance() noexcept
+{
+    return &crashBuffer;
+}
+
+bool LogCrashBuffer::installSignalHandlers(const QString& fileName /* = QString() */)
+{
+    const QFileInfo fileInfo(fileName.isEmpty() ? QString("./Log/%1.crash").arg(QCoreApplication::applicationName()) : fileName);
+
+    const QDir dir(fileInfo.absolutePath());
+    if (!dir.exists() && !dir.mkpath(dir.absolutePath()))
+    {
+        return false;
+    }
+
+    const auto localFileName = fileInfo.absoluteFilePath().toLocal8Bit();
+    if (localFileName.size() >= MAX_CRASH_FILE_NAME)
+    {
+        return false;
+    }
+
+    std::memcpy(crashFileName, localFileName.constData(), localFileName.size());
+    crashFileName[localFileName.size()] = '\0';
+
+#ifdef Q_OS_WIN
+    for (const auto sig: CRASH_SIGNALS)
+    {
+        if (std::signal(sig, crashSignalHandler) == SIG_ERR)
+        {
+            return false;
+        }
+    }
+#else
+    //обработчик выполняется на отдельном стеке, чтобы сохранить буфер и при переполнении стека этого потока
+    if (!installThreadStack())
+    {
+        return false;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = crashSignalHandler;
+    action.sa_flags = SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+
+    for (const auto sig: CRASH_SIGNALS)
+    {
+        if (sigaction(sig, &action, nullptr) != 0)
+        {
+            return false;
+        }
+    }
+#endif
+
+    return true;
+}
+
+bool LogCrashBuffer::installThreadStack() noexcept
+{
+#ifdef Q_OS_WIN
+    return true;
+#else
+    thread_local AlternateStack stack;
+
+    return stack.install();
+#endif
+}
+
+void LogCrashBuffer::record(qint64 dateTime, LogLevel level, const QString& prefix, const QString& msg) noexcept
+{
+    const auto pos = _head.fetch_add(1, std::memory_order_relaxed);
+    auto& slot = _slots[pos & (SLOT_COUNT - 1)];
+
+    slot.sequence.store(2 * pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const auto prefixSize = std::min(prefix.size(), TEXT_SIZE);
+    std::memcpy(slot.text, prefix.utf16(), prefixSize * sizeof(char16_t));
+
+    qsizetype textSize = prefixSize;
+    if (textSize < TEXT_SIZE)
+    {
+        slot.text[textSize++] = u' ';
+
+        const auto msgSize = std::min(msg.size(), TEXT_SIZE - textSize);
+        std::memcpy(slot.text + textSize, msg.utf16(), msgSize * sizeof(char16_t));
+        textSize += msgSize;
+    }
+
+    slot.dateTime = dateTime;
+    slot.level = level;
+    slot.textSize = static_cast<quint16>(textSize);
+
+    slot.sequence.store(2 * pos + 2, std::memory_order_release);
+}
+
+void LogCrashBuffer::dump(int fd) const noexcept
+{
+    CrashWriter writer(fd);
+    char16_t text[TEXT_SIZE];
+
+    const auto head = _head.load(std::memory_order_acquire);
+    const auto first = head > static_cast<quint64>(SLOT_COUNT) ? head - SLOT_COUNT : 0;
+    for (auto pos = first; pos < head; ++pos)
+    {
+        const auto& slot = _slots[pos & (SLOT_COUNT - 1)];
+
+        //ячейка перезаписана более новым сообщением или еще записывается
+        if (slot.sequence.load(std::memory_order_acquire) != 2 * pos + 2)
+        {
+            continue;
+        }
+
+        const auto dateTime = slot.dateTime;
+        const auto level = slot.level;
+        const auto textSize = std::min(static_cast<qsizetype>(slot.textSize), TEXT_SIZE);
+        std::memcpy(text, slot.text, textSize * sizeof(char16_t));
+
+        //сообщение было перезаписано во время копирования
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != 2 * pos + 2)
+        {
+            continue;
+        }
+
+        writer.appendDateTime(dateTime);
+        writer.append(' ');
+        writer.append(levelToString(level));
+        writer.append(' ');
+        writer.appendUtf16(text, textSize);
+        writer.append('\n');
+    }
+
+    writer.append("===== End of log messages =====\n");
+}
@@ -0,0 +1,568 @@
+//STL
+#include <algorithm>
+
+//Qt
+#include <QSaveFile>
+#include <QDateTime>
+#include <QtEndian>
+
+//My
+#include "Common/common.h"
+
+#include "Common/logfilereader.h"
+
+using namespace Common;
+
+static const QByteArray LOG_ARCHIVE_MAGIC("CLZ1");        ///< Сигнатура сжатого файла лога
+static const qint64 ARCHIVE_CHUNK_SIZE = 1024 * 1024;    ///< 1MB размер несжатого блока
+static const quint32 MAX_ARCHIVE_CHUNK_SIZE = 64 * 1024 * 1024; ///< 64MB максимально допустимый размер блока при чтении
+static const qsizetype CHUNK_HEADER_SIZE = 8;             ///< Размер заголовка блока: несжатый размер (4 байта) + сжатый размер (4 байта)
+static const qint64 MAX_TIME_DISORDER = 1000;             ///< 1с максимальное отклонение порядка сообщений в файле от порядка их времени (сообщения разных потоков)
+
+QString Common::compressLogFile(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        throw LogFileException(QString("Cannot open log file for compression: %1. %2").arg(fileName).arg(fileErrorToString(file.error())));
+    }
+
+    const auto archiveFileName = fileName + LOG_ARCHIVE_SUFFIX;
+
+    QSaveFile archiveFile(archiveFileName);
+    if (!archiveFile.open(QFile::WriteOnly))
+    {
+        throw LogFileException(QString("Cannot open archive file to write: %1. %2").arg(archiveFileName).arg(archiveFile.errorString()));
+    }
+
+    archiveFile.write(LOG_ARCHIVE_MAGIC);
+
+    while (!file.atEnd())
+    {
+        const auto chunk = file.read(ARCHIVE_CHUNK_SIZE);
+        if (chunk.isEmpty() && file.error() != QFile::NoError)
+        {
+            archiveFile.cancelWriting();
+
+            throw LogFileException(QString("Cannot read log file: %1. %2").arg(fileName).arg(fileErrorToString(file.error())));
+        }
+
+        const auto compressedChunk = qCompress(chunk);
+
+        char header[CHUNK_HEADER_SIZE];
+        qToBigEndian<quint32>(static_cast<quint32>(chunk.size()), header);
+        qToBigEndian<quint32>(static_cast<quint32>(compressedChunk.size()), header + 4);
+
+        archiveFile.write(header, CHUNK_HEADER_SIZE);
+        archiveFile.write(compressedChunk);
+    }
+
+    //QSaveFile заменяет итоговый файл только если все записи прошли успешно
+    if (!archiveFile.commit())
+    {
+        throw LogFileException(QString("Cannot save archive file: %1. %2").arg(archiveFileName).arg(archiveFile.errorString()));
+    }
+
+    file.close();
+
+    if (!file.remove())
+    {
+        throw LogFileException(QString("Cannot remove log file after compression: %1. %2").arg(fileName).arg(fileErrorToString(file.error())));
+    }
+
+    return archiveFileName;
+}
+
+QString Common::logIndexFileName(const QString& logFileName)
+{
+    auto baseFileName = logFileName;
+    if (baseFileName.endsWith(LOG_ARCHIVE_SUFFIX))
+    {
+        baseFileName.chop(LOG_ARCHIVE_SUFFIX.size());
+    }
+
+    return baseFileName + LOG_INDEX_SUFFIX;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class LogFileReader
+///
+LogFileReader::LogFileReader(const QString& fileName)
+    : _file(fileName)
+{
+}
+
+bool LogFileReader::open()
+{
+    if (!_file.open(QFile::ReadOnly))
+    {
+        _errorString = QString("Cannot open log file: %1. %2").arg(_file.fileName()).arg(fileErrorToString(_file.error()));
+
+        return false;
+    }
+
+    _isCompressed = _file.peek(LOG_ARCHIVE_MAGIC.size()) == LOG_ARCHIVE_MAGIC;
+    if (_isCompressed)
+    {
+        _file.skip(LOG_ARCHIVE_MAGIC.size());
+
+        if (!_file.atEnd() && !readChunk())
+        {
+            return false;
+        }
+
+        _isBinary = _chunk.startsWith(LOG_BINARY_MAGIC);
+        if (_isBinary)
+        {
+            _chunkPos = LOG_BINARY_MAGIC.size();
+        }
+    }
+    else
+    {
+        _isBinary = _file.peek(LOG_BINARY_MAGIC.size()) == LOG_BINARY_MAGIC;
+        if (_isBinary)
+        {
+            _file.skip(LOG_BINARY_MAGIC.size());
+        }
+    }
+
+    return true;
+}
+
+bool LogFileReader::setTimeRange(qint64 from, qint64 to)
+{
+    _isTimeRange = true;
+    _from = from;
+    _to = to;
+    _isInRange = false;
+    _isRangeEnd = false;
+
+    qint64 offset = 0;
+    if (!findIndexOffset(from - MAX_TIME_DISORDER, offset))
+    {
+        return false;
+    }
+
+    return seekRaw(offset);
+}
+
+bool LogFileReader::atEnd() const
+{
+    if (!_file.isOpen() || isError() || _isRangeEnd)
+    {
+        return true;
+    }
+
+    return rawAtEnd();
+}
+
+QByteArray LogFileReader::readLine()
+{
+    qint64 dateTime = -1;
+    auto line = readNextLine(dateTime);
+    if (!_isTimeRange)
+    {
+        return line;
+    }
+
+    while (true)
+    {
+        if (dateTime >= 0)
+        {
+            //сообщения могут быть записаны не строго по порядку времени - завершаем чтение с запасом
+            if (dateTime > _to + MAX_TIME_DISORDER)
+            {
+                _isRangeEnd = true;
+
+                return {};
+            }
+
+            _isInRange = dateTime >= _from && dateTime <= _to;
+        }
+
+        if (_isInRange)
+        {
+            return line;
+        }
+
+        if (rawAtEnd() || isError())
+        {
+            return {};
+        }
+
+        line = readNextLine(dateTime);
+    }
+}
+
+bool LogFileReader::isError() const noexcept
+{
+    return !_errorString.isEmpty();
+}
+
+QString LogFileReader::errorString()
+{
+    const QString result(_errorString);
+    _errorString.clear();
+
+    return result;
+}
+
+QByteArray LogFileReader::readNextLine(qint64& dateTime)
+{
+    if (_isBinary)
+    {
+        return readBinaryLine(dateTime);
+    }
+
+    dateTime = -1;
+
+    auto line = readRawLine();
+    while (line.endsWith('\n') || line.endsWith('\r'))
+    {
+        line.chop(1);
+    }
+
+    //метка времени разбирается только при чтении интервала времени
+    const auto dateTimeSize = DATETIME_FORMAT.size();
+    if (_isTimeRange && line.size() >= dateTimeSize && line.at(4) == '-' && line.at(10) == ' ')
+    {
+        const auto lineDateTime = QDateTime::fromString(QString::fromLatin1(line.constData(), dateTimeSize), DATETIME_FORMAT);
+        if (lineDateTime.isValid())
+        {
+            dateTime = lineDateTime.toMSecsSinceEpoch();
+        }
+    }
+
+    return line;
+}
+
+bool LogFileReader::findIndexOffset(qint64 dateTime, qint64& offset)
+{
+    static const qsizetype ENTRY_SIZE = sizeof(qint64) + sizeof(qint64);    ///< Время + смещение
+    static const qsizetype PREFIX_HEADER_SIZE = sizeof(quint32) + sizeof(quint32); ///< ИД префикса + размер текста
+
+    QFile indexFile(logIndexFileName(_file.fileName()));
+    if (!indexFile.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    const auto data = indexFile.readAll();
+    if (!data.startsWith(LOG_INDEX_MAGIC))
+    {
+        return false;
+    }
+
+    //префиксы применяются в порядке записи, т.к. после перезапуска программы ИД префиксов в файле могут повторяться
+    QHash<quint32, QByteArray> prefixes;
+    bool isFound = false;
+    qsizetype pos = LOG_INDEX_MAGIC.size();
+    while (pos < data.size())
+    {
+        const auto type = static_cast<LogIndexRecordType>(data.at(pos));
+        ++pos;
+
+        if (type == LogIndexRecordType::ENTRY)
+        {
+            //последняя запись может быть записана не полностью
+            if (data.size() - pos < ENTRY_SIZE)
+            {
+                break;
+            }
+
+            const auto entryDateTime = qFromLittleEndian<qint64>(data.constData() + pos);
+            if (entryDateTime >= dateTime)
+            {
+                break;
+            }
+
+            offset = qFromLittleEndian<qint64>(data.constData() + pos + sizeof(qint64));
+            _prefixes = prefixes;
+            isFound = true;
+
+            pos += ENTRY_SIZE;
+        }
+        else if (type == LogIndexRecordType::PREFIX)
+        {
+            if (data.size() - pos < PREFIX_HEADER_SIZE)
+            {
+                break;
+            }
+
+            const auto id = qFromLittleEndian<quint32>(data.constData() + pos);
+            const auto byteSize = qFromLittleEndian<quint32>(data.constData() + pos + sizeof(quint32));
+            pos += PREFIX_HEADER_SIZE;
+
+            if (data.size() - pos < static_cast<qsizetype>(byteSize))
+            {
+                break;
+            }
+
+            prefixes.insert(id, data.mid(pos, byteSize));
+
+            pos += byteSize;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return isFound;
+}
+
+bool LogFileReader::seekRaw(qint64 offset)
+{
+    if (!_isCompressed)
+    {
+        if (!_file.seek(offset))
+        {
+            _errorString = QString("Cannot seek log file: %1. %2").arg(_file.fileName()).arg(fileErrorToString(_file.error()));
+
+            return false;
+        }
+
+        return true;
+    }
+
+    if (!_file.seek(LOG_ARCHIVE_MAGIC.size()))
+    {
+        _errorString = QString("Cannot seek log file: %1. %2").arg(_file.fileName()).arg(fileErrorToString(_file.error()));
+
+        return false;
+    }
+
+    _chunk.clear();
+    _chunkPos = 0;
+
+    //блоки до нужного пропускаются без распаковки
+    qint64 chunkStart = 0;
+    while (!_file.atEnd())
+    {
+        const auto header = _file.peek(CHUNK_HEADER_SIZE);
+        if (header.size() != CHUNK_HEADER_SIZE)
+        {
+            _errorString = QString("Unexpected end of archive: %1").arg(_file.fileName());
+
+            return false;
+        }
+
+        const auto chunkSize = qFromBigEndian<quint32>(header.constData());
+        const auto compressedSize = qFromBigEndian<quint32>(header.constData() + 4);
+        if (chunkSize > MAX_ARCHIVE_CHUNK_SIZE || compressedSize > MAX_ARCHIVE_CHUNK_SIZE)
+        {
+            _errorString = QString("Archive is corrupted: %1").arg(_file.fileName());
+
+            return false;
+        }
+
+        if (offset < chunkStart + chunkSize)
+        {
+            if (!readChunk())
+            {
+                return false;
+            }
+
+            _chunkPos = offset - chunkStart;
+
+            return true;
+        }
+
+        if (!_file.seek(_file.pos() + CHUNK_HEADER_SIZE + compressedSize))
+        {
+            _errorString = QString("Unexpected end of archive: %1").arg(_file.fileName());
+
+            return false;
+        }
+
+        chunkStart += chunkSize;
+    }
+
+    return true;
+}
+
+bool LogFileReader::readChunk()
+{
+    const auto header = _file.read(CHUNK_HEADER_SIZE);
+    if (header.size() != CHUNK_HEADER_SIZE)
+    {
+        _errorString = QString("Unexpected end of archive: %1").arg(_file.fileName());
+
+        return false;
+    }
+
+    const auto chunkSize = qFromBigEndian<quint32>(header.constData());
+    const auto compressedSize = qFromBigEndian<quint32>(header.constData() + 4);
+    if (chunkSize > MAX_ARCHIVE_CHUNK_SIZE || compressedSize > MAX_ARCHIVE_CHUNK_SIZE)
+    {
+        _errorString = QString("Archive is corrupted: %1").arg(_file.fileName());
+
+        return false;
+    }
+
+    const auto compressedChunk = _file.read(compressedSize);
+    if (compressedChunk.size() != static_cast<qsizetype>(compressedSize))
+    {
+        _errorString = QString("Unexpected end of archive: %1").arg(_file.fileName());
+
+        return false;
+    }
+
+    _chunk = qUncompress(compressedChunk);
+    _chunkPos = 0;
+
+    if (_chunk.size() != static_cast<qsizetype>(chunkSize))
+    {
+        _errorString = QString("Archive is corrupted: %1").arg(_file.fileName());
+        _chunk.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool LogFileReader::rawAtEnd() const
+{
+    return _isCompressed ? _chunkPos >= _chunk.size() && _file.atEnd() : _file.atEnd();
+}
+
+QByteArray LogFileReader::readRawLine()
+{
+    if (!_isCompressed)
+    {
+        return _file.readLine();
+    }
+
+    QByteArray line;
+    while (true)
+    {
+        const auto endLinePos = _chunk.indexOf('\n', _chunkPos);
+        if (endLinePos != -1)
+        {
+            line.append(_chunk.constData() + _chunkPos, endLinePos - _chunkPos + 1);
+            _chunkPos = endLinePos + 1;
+
+            break;
+        }
+
+        //строка продолжается в следующем блоке
+        line.append(_chunk.constData() + _chunkPos, _chunk.size() - _chunkPos);
+        _chunkPos = _chunk.size();
+
+        if (_file.atEnd() || !readChunk())
+        {
+            break;
+        }
+    }
+
+    return line;
+}
+
+QByteArray LogFileReader::readRaw(qsizetype size)
+{
+    if (!_isCompressed)
+    {
+        return _file.read(size);
+    }
+
+    QByteArray data;
+    while (data.size() < size)
+    {
+        if (_chunkPos >= _chunk.size())
+        {
+            if (_file.atEnd() || !readChunk())
+            {
+                break;
+            }
+        }
+
+        const auto count = std::min(size - data.size(), _chunk.size() - _chunkPos);
+        data.append(_chunk.constData() + _chunkPos, count);
+        _chunkPos += count;
+    }
+
+    return data;
+}
+
+bool LogFileReader::readBinaryText(QByteArray& text)
+{
+    const auto sizeData = readRaw(sizeof(quint32));
+    if (sizeData.size() != static_cast<qsizetype>(sizeof(quint32)))
+    {
+        return false;
+    }
+
+    const auto byteSize = qFromLittleEndian<quint32>(sizeData.constData());
+    if (byteSize > MAX_ARCHIVE_CHUNK_SIZE)
+    {
+        return false;
+    }
+
+    text = readRaw(byteSize);
+
+    return text.size() == static_cast<qsizetype>(byteSize);
+}
+
+QByteArray LogFileReader::readBinaryLine(qint64& dateTime)
+{
+    static const qsizetype MESSAGE_HEADER_SIZE = sizeof(qint64) + sizeof(quint8) + sizeof(quint32); ///< Время + уровень + ИД префикса
+
+    dateTime = -1;
+
+    while (!rawAtEnd())
+    {
+        const auto type = readRaw(1);
+        if (type.isEmpty())
+        {
+            break;
+        }
+
+        switch (static_cast<LogBinaryRecordType>(type.at(0)))
+        {
+        case LogBinaryRecordType::PREFIX:
+        {
+            const auto idData = readRaw(sizeof(quint32));
+            QByteArray prefix;
+            if (idData.size() != static_cast<qsizetype>(sizeof(quint32)) || !readBinaryText(prefix))
+            {
+                _errorString = QString("Binary log is corrupted: %1").arg(_file.fileName());
+
+                return {};
+            }
+
+            _prefixes.insert(qFromLittleEndian<quint32>(idData.constData()), prefix);
+
+            break;
+        }
+        case LogBinaryRecordType::MESSAGE:
+        {
+            const auto header = readRaw(MESSAGE_HEADER_SIZE);
+            QByteArray msg;
+            if (header.size() != MESSAGE_HEADER_SIZE || !readBinaryText(msg))
+            {
+                _errorString = QString("Binary log is corrupted: %1").arg(_file.fileName());
+
+                return {};
+            }
+
+            dateTime = qFromLittleEndian<qint64>(header.constData());
+            const auto prefixId = qFromLittleEndian<quint32>(header.constData() + sizeof(qint64) + sizeof(quint8));
+
+            QByteArray line = QDateTime::fromMSecsSinceEpoch(dateTime).toString(DATETIME_FORMAT).toUtf8();
+            line += ' ';
+            line += _prefixes.value(prefixId, "UND");
+            line += ' ';
+            line += msg;
+
+            return line;
+        }
+        default:
+            _errorString = QString("Binary log is corrupted. Undefined record type: %1").arg(_file.fileName());
+
+            return {};
+        }
+    }
+
+    return {};
+}
@@ -0,0 +1,83 @@
+//STL
+#include <exception>
+
+//Qt
+#include <QMutexLocker>
+
+//My
+#include "Common/logcrashbuffer.h"
+
+#include "Common/logmaintenance.h"
+
+using namespace Common;
+
+Q_GLOBAL_STATIC(LogMaintenance, logMaintenance);
+
+LogMaintenance* LogMaintenance::instance()
+{
+    return logMaintenance();
+}
+
+LogMaintenance::LogMaintenance()
+{
+    _thread.reset(QThread::create([this](){ run(); }));
+    _thread->setObjectName("LogMaintenance");
+    _thread->start(QThread::IdlePriority);
+}
+
+LogMaintenance::~LogMaintenance()
+{
+    {
+        QMutexLocker<QMutex> locker(&_mutex);
+
+        _isStopped = true;
+        _condition.wakeAll();
+    }
+
+    _thread->wait();
+}
+
+void LogMaintenance::post(Task&& task)
+{
+    QMutexLocker<QMutex> locker(&_mutex);
+
+    _tasks.emplace(std::move(task));
+    _condition.wakeOne();
+}
+
+void LogMaintenance::run()
+{
+    //аварийный буфер лога сохраняется и при переполнении стека этого потока
+    LogCrashBuffer::installThreadStack();
+
+    QMutexLocker<QMutex> locker(&_mutex);
+
+    while (true)
+    {
+        while (_tasks.empty() && !_isStopped)
+        {
+            _condition.wait(&_mutex);
+        }
+
+        if (_tasks.empty())
+        {
+            break;
+        }
+
+        auto task = std::move(_tasks.front());
+        _tasks.pop();
+
+        locker.unlock();
+
+        try
+        {
+            task();
+        }
+        catch (const std::exception&)
+        {
+            //задачи сами сообщают о своих ошибках, исключение не должно остановить поток обработки
+        }
+
+        locker.relock();
+    }
+}
@@ -0,0 +1,124 @@
+//STL
+#include <algorithm>
+
+//Qt
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+//My
+#include "Common/logcrashbuffer.h"
+
+#include "Common/logpipeline.h"
+
+using namespace Common;
+
+static const int FLUSH_TIMEOUT = 5 * 1000;  ///< 5с максимальное время ожидания обработки сообщений в flush()
+
+Q_GLOBAL_STATIC(LogPipeline, logPipeline);
+
+LogPipeline* LogPipeline::instance()
+{
+    return logPipeline();
+}
+
+LogPipeline::LogPipeline()
+    : _fileSink(std::make_shared<FileLogSink>())
+{
+    addSink(std::make_shared<ConsoleLogSink>());
+    addSink(_fileSink);
+}
+
+LogPipeline::~LogPipeline()
+{
+    std::vector<std::shared_ptr<LogSink>> sinks;
+    {
+        QWriteLocker locker(&_sinksLock);
+
+        sinks.swap(_sinks);
+    }
+
+    for (const auto& sink: sinks)
+    {
+        sink->stop();
+    }
+}
+
+void LogPipeline::addSink(const std::shared_ptr<LogSink>& sink)
+{
+    Q_CHECK_PTR(sink);
+
+    sink->start();
+
+    QWriteLocker locker(&_sinksLock);
+
+    _sinks.push_back(sink);
+}
+
+void LogPipeline::removeSink(const std::shared_ptr<LogSink>& sink)
+{
+    {
+        QWriteLocker locker(&_sinksLock);
+
+        const auto sinks_it = std::find(_sinks.begin(), _sinks.end(), sink);
+        if (sinks_it == _sinks.end())
+        {
+            return;
+        }
+
+        _sinks.erase(sinks_it);
+    }
+
+    sink->stop();
+}
+
+std::shared_ptr<LogSink> LogPipeline::sink(const QString& name) const
+{
+    QReadLocker locker(&_sinksLock);
+
+    for (const auto& sink: _sinks)
+    {
+        if (sink->name() == name)
+        {
+            return sink;
+        }
+    }
+
+    return nullptr;
+}
+
+void LogPipeline::publish(quint8 targets, LogLevel level, const QString& prefix, const QString& msg)
+{
+    auto record = std::make_shared<const LogRecord>(LogRecord{QDateTime::currentMSecsSinceEpoch(), targets, level, prefix, msg});
+
+    //последние сообщения сохраняются синхронно, чтобы они не потерялись при аварийном завершении процесса
+    LogCrashBuffer::instance()->record(record->dateTime, level, prefix, msg);
+
+    QReadLocker locker(&_sinksLock);
+
+    for (const auto& sink: _sinks)
+    {
+        if (sink->accepts(*record))
+        {
+            sink->post(record);
+        }
+    }
+}
+
+void LogPipeline::flush()
+{
+    const QDeadlineTimer deadline(FLUSH_TIMEOUT);
+
+    std::vector<std::shared_ptr<LogSink>> sinks;
+    {
+        QReadLocker locker(&_sinksLock);
+
+        sinks = _sinks;
+    }
+
+    for (const auto& sink: sinks)
+    {
+        sink->flush(deadline);
+    }
+}
@@ -0,0 +1,313 @@
+//STL
+#include <algorithm>
+#include <cstdio>
+
+//Qt
+#include <QDateTime>
+#include <QCoreApplication>
+#include <QMutexLocker>
+
+//My
+#include "Common/common.h"
+#include "Common/logcrashbuffer.h"
+
+#include "Common/logsink.h"
+
+#ifdef Q_OS_UNIX
+#include <syslog.h>
+#endif
+
+using namespace Common;
+
+static const qsizetype MAX_CONSOLE_BATCH_SIZE = 64 * 1024;   ///< 64KB размер пачки, при превышении которого она выводится в stderr не дожидаясь опустошения очереди
+
+///////////////////////////////////////////////////////////////////////////////
+///     class LogSink
+///
+LogSink::LogSink(const QString& name, quint8 targets)
+    : _name(name)
+    , _targets(targets)
+{
+}
+
+LogSink::~LogSink()
+{
+    Q_ASSERT(!_thread || _thread->isFinished());
+}
+
+void LogSink::setMinLevel(LogLevel level)
+{
+    _minLevel.store(level, std::memory_order_relaxed);
+}
+
+LogLevel LogSink::minLevel() const
+{
+    return _minLevel.load(std::memory_order_relaxed);
+}
+
+void LogSink::setBatchParams(qint64 wakeUpCount, int flushInterval)
+{
+    Q_ASSERT(!_thread);
+    Q_ASSERT(wakeUpCount > 0);
+    Q_ASSERT(flushInterval > 0);
+
+    _wakeUpCount = wakeUpCount;
+    _flushInterval = flushInterval;
+}
+
+bool LogSink::accepts(const LogRecord& record) const
+{
+    if ((record.targets & _targets) == 0)
+    {
+        return false;
+    }
+
+    return record.level == LogLevel::UND
+        || static_cast<quint8>(record.level) >= static_cast<quint8>(_minLevel.load(std::memory_order_relaxed));
+}
+
+void LogSink::post(const PLogRecord& record)
+{
+    //счетчик увеличивается до помещения в очередь, чтобы flush() гарантированно дождался этого сообщения
+    const auto queueSize = _pushedCount.fetch_add(1, std::memory_order_acq_rel) + 1 - _processedCount.load(std::memory_order_relaxed);
+
+    _queue.push(PLogRecord(record));
+
+    if (queueSize >= _wakeUpCount
+        && !_isWakeUpPending.load(std::memory_order_relaxed)
+        && !_isWakeUpPending.exchange(true, std::memory_order_acq_rel))
+    {
+        QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+        _wakeUpCondition.wakeOne();
+    }
+}
+
+void LogSink::wakeUp()
+{
+    if (_isWakeUpPending.load(std::memory_order_relaxed) || _isWakeUpPending.exchange(true, std::memory_order_acq_rel))
+    {
+        return;
+    }
+
+    QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+    _wakeUpCondition.wakeOne();
+}
+
+void LogSink::flush(const QDeadlineTimer& deadline)
+{
+    if (!_thread || isSinkThread())
+    {
+        return;
+    }
+
+    const auto target = _pushedCount.load(std::memory_order_acquire);
+
+    QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+    ++_flushWaiters;
+    _wakeUpCondition.wakeOne();
+
+    while (_processedCount.load(std::memory_order_acquire) < target && !deadline.hasExpired() && !_thread->isFinished())
+    {
+        _flushedCondition.wait(&_wakeUpMutex, deadline);
+    }
+
+    --_flushWaiters;
+}
+
+qint64 LogSink::queueSize() const noexcept
+{
+    //обработанные считываются первыми: иначе между двумя чтениями счетчик обработанных может обогнать прочитанный счетчик помещенных
+    const auto processedCount = _processedCount.load(std::memory_order_acquire);
+
+    return std::max<qint64>(_pushedCount.load(std::memory_order_acquire) - processedCount, 0);
+}
+
+void LogSink::start()
+{
+    Q_ASSERT(!_thread);
+
+    _thread.reset(QThread::create([this](){ run(); }));
+    _thread->setObjectName(QString("LogSink_%1").arg(_name));
+    _thread->start(QThread::LowPriority);
+}
+
+void LogSink::stop()
+{
+    if (!_thread || _thread->isFinished())
+    {
+        return;
+    }
+
+    {
+        QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+        _isStopped.store(true, std::memory_order_release);
+        _wakeUpCondition.wakeAll();
+    }
+
+    _thread->wait();
+}
+
+bool LogSink::isSinkThread() const
+{
+    return _thread && QThread::currentThread() == _thread.get();
+}
+
+void LogSink::run()
+{
+    //аварийный буфер лога сохраняется и при переполнении стека этого потока
+    LogCrashBuffer::installThreadStack();
+
+    started();
+
+    while (!_isStopped.load(std::memory_order_acquire))
+    {
+        {
+            QMutexLocker<QMutex> locker(&_wakeUpMutex);
+
+            const auto queueSize = _pushedCount.load(std::memory_order_relaxed) - _processedCount.load(std::memory_order_relaxed);
+            if (!_isStopped.load(std::memory_order_relaxed) && _flushWaiters == 0 && queueSize < _wakeUpCount)
+            {
+                _wakeUpCondition.wait(&_wakeUpMutex, _flushInterval);
+            }
+
+            _isWakeUpPending.store(false, std::memory_order_release);
+        }
+
+        processQueue();
+    }
+
+    processQueue();
+
+    stopped();
+}
+
+void LogSink::processQueue()
+{
+    qint64 count = 0;
+    PLogRecord record;
+    while (_queue.pop(record))
+    {
+        ++count;
+
+        writeRecord(*record);
+    }
+
+    flushRecords();
+
+    if (count > 0)
+    {
+        _processedCount.fetch_add(count, std::memory_order_acq_rel);
+    }
+
+    QMutexLocker<QMutex> locker(&_wakeUpMutex);
+    if (_flushWaiters > 0)
+    {
+        _flushedCondition.wakeAll();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class ConsoleLogSink
+///
+ConsoleLogSink::ConsoleLogSink()
+    : LogSink("Console", TARGET_CONSOLE)
+{
+}
+
+ConsoleLogSink::~ConsoleLogSink()
+{
+    stop();
+}
+
+void ConsoleLogSink::writeRecord(const LogRecord& record)
+{
+    _buffer += QDateTime::fromMSecsSinceEpoch(record.dateTime).toString(SIMPLY_TIME_FORMAT).toUtf8();
+    _buffer += ' ';
+    _buffer += record.prefix.toUtf8();
+    _buffer += ' ';
+    _buffer += record.msg.toUtf8();
+    _buffer += '\n';
+
+    if (_buffer.size() >= MAX_CONSOLE_BATCH_SIZE)
+    {
+        flushRecords();
+    }
+}
+
+void ConsoleLogSink::flushRecords()
+{
+    if (_buffer.isEmpty())
+    {
+        return;
+    }
+
+    std::fwrite(_buffer.constData(), 1, _buffer.size(), stderr);
+    std::fflush(stderr);
+
+    _buffer.clear();
+}
+
+#ifdef Q_OS_UNIX
+///////////////////////////////////////////////////////////////////////////////
+///     class SyslogLogSink
+///
+SyslogLogSink::SyslogLogSink(quint8 targets /* = TARGET_CONSOLE | TARGET_FILE */)
+    : LogSink("Syslog", targets)
+{
+}
+
+SyslogLogSink::~SyslogLogSink()
+{
+    stop();
+}
+
+void SyslogLogSink::started()
+{
+    _ident = QCoreApplication::applicationName().toUtf8();
+
+    openlog(_ident.constData(), LOG_PID | LOG_NDELAY, LOG_USER);
+}
+
+void SyslogLogSink::stopped()
+{
+    closelog();
+}
+
+void SyslogLogSink::writeRecord(const LogRecord& record)
+{
+    int priority = LOG_NOTICE;
+    switch (record.level)
+    {
+    case LogLevel::DBG:
+        priority = LOG_DEBUG;
+        break;
+    case LogLevel::INF:
+        priority = LOG_INFO;
+        break;
+    case LogLevel::WAR:
+        priority = LOG_WARNING;
+        break;
+    case LogLevel::CRY:
+        priority = LOG_ERR;
+        break;
+    case LogLevel::FAT:
+        priority = LOG_CRIT;
+        break;
+    default:
+        break;
+    }
+
+    const auto text = QString("%1 %2").arg(record.prefix, record.msg).toUtf8();
+
+    syslog(priority, "%s", text.constData());
+}
+
+void SyslogLogSink::flushRecords()
+{
+    //каждое сообщение передается в журнал отдельной датаграммой, накопленных данных нет
+}
+#endif
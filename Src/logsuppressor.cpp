@@ -0,0 +1,201 @@
+//Qt
+#include <QHash>
+#include <QByteArrayView>
+
+//My
+#include "Common/logsuppressor.h"
+
+using namespace Common;
+
+static const quint64 EMPTY_KEY = 0;                 ///< Ключ свободной ячейки
+static const quint64 BUSY_KEY = ~quint64(0);        ///< Ключ ячейки, которая в данный момент занимается или освобождается
+static const qsizetype SLOT_COUNT = 4096;           ///< Размер таблицы сообщений. Должен быть степенью 2
+
+static_assert((SLOT_COUNT & (SLOT_COUNT - 1)) == 0, "SLOT_COUNT must be a power of 2");
+
+/*!
+    Вычисляет ключ сообщения
+    @param type - тип сообщения
+    @param file - имя файла исходного кода или nullptr
+    @param line - номер строки
+    @param msg - сообщение
+    @return ключ. Никогда не равен EMPTY_KEY и BUSY_KEY
+*/
+static quint64 makeKey(QtMsgType type, const char* file, int line, const QString& msg)
+{
+    const quint64 key = qHashMulti(0, static_cast<int>(type), QByteArrayView(file), line, msg);
+
+    return key == EMPTY_KEY || key == BUSY_KEY ? 1 : key;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class LogSuppressor
+///
+LogSuppressor::LogSuppressor()
+    : _slots(std::make_unique<Slot[]>(SLOT_COUNT))
+{
+}
+
+LogSuppressor::~LogSuppressor()
+{
+    for (qsizetype i = 0; i < SLOT_COUNT; ++i)
+    {
+        delete _slots[i].text;
+    }
+}
+
+void LogSuppressor::setParams(quint32 burstLimit, qint64 window)
+{
+    Q_ASSERT(window > 0);
+
+    _window.store(window, std::memory_order_relaxed);
+    _burstLimit.store(burstLimit, std::memory_order_relaxed);
+}
+
+bool LogSuppressor::check(QtMsgType type, const char* file, int line, const QString& msg, qint64 now, Summary& summary)
+{
+    summary.count = 0;
+
+    const auto burstLimit = _burstLimit.load(std::memory_order_relaxed);
+    if (burstLimit == 0)
+    {
+        return true;
+    }
+
+    auto slot = findSlot(makeKey(type, file, line, msg), type, msg, now);
+    if (!slot)
+    {
+        return true;
+    }
+
+    bool isOutput = true;
+
+    //окно истекло - начинаем новое. Итог предыдущего окна выводит тот поток, который начал новое окно
+    auto windowStart = slot->windowStart.load(std::memory_order_acquire);
+    if (now - windowStart >= _window.load(std::memory_order_relaxed)
+        && slot->windowStart.compare_exchange_strong(windowStart, now, std::memory_order_acq_rel))
+    {
+        const auto count = slot->count.exchange(1, std::memory_order_acq_rel);
+        if (count > burstLimit)
+        {
+            summary.type = type;
+            summary.msg = msg;
+            summary.count = count - burstLimit;
+            summary.interval = now - windowStart;
+        }
+    }
+    else
+    {
+        isOutput = slot->count.fetch_add(1, std::memory_order_acq_rel) < burstLimit;
+    }
+
+    releaseSlot(*slot);
+
+    return isOutput;
+}
+
+QList<LogSuppressor::Summary> LogSuppressor::sweep(qint64 now, bool force /* = false */)
+{
+    QList<Summary> result;
+
+    const auto window = _window.load(std::memory_order_relaxed);
+    if (!force && now - _lastSweep.load(std::memory_order_relaxed) < window)
+    {
+        return result;
+    }
+
+    if (_isSweeping.exchange(true, std::memory_order_acquire))
+    {
+        return result;
+    }
+
+    _lastSweep.store(now, std::memory_order_relaxed);
+
+    const auto burstLimit = _burstLimit.load(std::memory_order_relaxed);
+    for (qsizetype i = 0; i < SLOT_COUNT; ++i)
+    {
+        auto& slot = _slots[i];
+
+        const auto key = slot.key.load(std::memory_order_acquire);
+        if (key == EMPTY_KEY || key == BUSY_KEY)
+        {
+            continue;
+        }
+
+        auto windowStart = slot.windowStart.load(std::memory_order_acquire);
+        if ((!force && now - windowStart < window)
+            || !slot.windowStart.compare_exchange_strong(windowStart, now, std::memory_order_acq_rel))
+        {
+            continue;
+        }
+
+        const auto count = slot.count.exchange(0, std::memory_order_acq_rel);
+        if (count > burstLimit)
+        {
+            result.push_back({slot.type, *slot.text, count - burstLimit, now - windowStart});
+        }
+        //сообщение не повторялось в течение окна - освобождаем ячейку
+        else if (count == 0)
+        {
+            //ячейка сначала блокируется, затем проверяется что ее не удерживает check(...). Порядок обратный findSlot(...),
+            //поэтому при последовательной согласованности один из потоков обязательно увидит действие другого
+            auto expected = key;
+            if (slot.key.compare_exchange_strong(expected, BUSY_KEY, std::memory_order_seq_cst))
+            {
+                if (slot.users.load(std::memory_order_seq_cst) != 0)
+                {
+                    slot.key.store(key, std::memory_order_release);
+
+                    continue;
+                }
+
+                delete slot.text;
+                slot.text = nullptr;
+
+                slot.key.store(EMPTY_KEY, std::memory_order_release);
+            }
+        }
+    }
+
+    _isSweeping.store(false, std::memory_order_release);
+
+    return result;
+}
+
+LogSuppressor::Slot* LogSuppressor::findSlot(quint64 key, QtMsgType type, const QString& msg, qint64 now)
+{
+    //ключ может находиться только в одной ячейке: два потока не займут для одного сообщения разные ячейки
+    auto& slot = _slots[key & (SLOT_COUNT - 1)];
+
+    //ячейка удерживается до проверки ключа: пока она удерживается, sweep(...) не может освободить ее
+    //и отдать другому сообщению
+    slot.users.fetch_add(1, std::memory_order_seq_cst);
+
+    auto slotKey = slot.key.load(std::memory_order_seq_cst);
+    if (slotKey == key)
+    {
+        return &slot;
+    }
+
+    //ячейку одновременно занимает другой поток или она занята другим сообщением - это сообщение пропускается без подсчета
+    if (slotKey != EMPTY_KEY || !slot.key.compare_exchange_strong(slotKey, BUSY_KEY, std::memory_order_acquire))
+    {
+        releaseSlot(slot);
+
+        return nullptr;
+    }
+
+    slot.type = type;
+    slot.text = new QString(msg);
+    slot.windowStart.store(now, std::memory_order_relaxed);
+    slot.count.store(0, std::memory_order_relaxed);
+
+    slot.key.store(key, std::memory_order_release);
+
+    return &slot;
+}
+
+void LogSuppressor::releaseSlot(Slot& slot)
+{
+    slot.users.fetch_sub(1, std::memory_order_release);
+}
@@ -31,14 +31,21 @@ void Common::connectToDB(QSqlDatabase& db, const Common::DBConnectionInfo& conne
     db.setPort(connectionInfo.port);
     db.setHostName(connectionInfo.host);
 
+    //блокировка защищает только список подключений: ожидание ответа недоступной БД не должно задерживать подключения в других потоках
+    connectDBMutexLocker.unlock();
+
     //подключаемся к БД
     if (!db.open())
     {
+        const auto errorString = connectDBErrorString(db);
+
+        connectDBMutexLocker.relock();
+
         QSqlDatabase::removeDatabase(connectionName);
 
         connectDBMutexLocker.unlock();
 
-        throw SQLException(connectDBErrorString(db));
+        throw SQLException(errorString);
     }
 }
 
@@ -63,7 +70,7 @@ void Common::closeDB(QSqlDatabase &db)
     QSqlDatabase::removeDatabase(db.connectionName()); 
 }
 
-void Common::transactionDB(QSqlDatabase &db)
+void Common::transactionDB(QSqlDatabase &db, bool isReconnect /* = true */)
 {
 #ifdef QT_DEBUG
     qDebug() << QString("Start transaction DB %1:%2").arg(db.databaseName()).arg(db.connectionName());
@@ -71,6 +78,11 @@ void Common::transactionDB(QSqlDatabase &db)
 
     if (!db.transaction())
     {
+        if (!isReconnect)
+        {
+            throw SQLException(transactionDBErrorString(db));
+        }
+
         if (db.isOpen())
         {
             db.close();
@@ -104,6 +116,21 @@ void Common::DBQueryExecute(QSqlDatabase& db, const QString &queryText)
     commitDB(db);
 }
 
+void Common::DBQueryExecuteAutoCommit(QSqlDatabase& db, const QString &queryText)
+{
+    Q_ASSERT(db.isOpen());
+
+#ifdef QT_DEBUG
+    qDebug() << QString("Auto-commit query to DB %1:%2: %3").arg(db.databaseName()).arg(db.connectionName()).arg(queryText);
+#endif
+
+    QSqlQuery query(db);
+    if (!query.exec(queryText))
+    {
+        throw SQLException(executeDBErrorString(db, query));
+    }
+}
+
 void Common::DBQueryExecute(QSqlDatabase &db, QSqlQuery &query, const QString &queryText)
 {
     Q_ASSERT(db.isOpen());
@@ -118,6 +145,48 @@ void Common::DBQueryExecute(QSqlDatabase &db, QSqlQuery &query, const QString &q
     }
 }
 
+void Common::DBQueryPrepare(QSqlDatabase& db, QSqlQuery& query, const QString &queryText)
+{
+    Q_ASSERT(db.isOpen());
+
+#ifdef QT_DEBUG
+    qDebug() << QString("Prepare query to DB %1:%2: %3").arg(db.databaseName()).arg(db.connectionName()).arg(queryText);
+#endif
+
+    if (!query.prepare(queryText))
+    {
+        throw SQLException(executeDBErrorString(db, query));
+    }
+}
+
+void Common::DBQueryExecuteBatch(QSqlDatabase& db, QSqlQuery& query)
+{
+    Q_ASSERT(db.isOpen());
+
+#ifdef QT_DEBUG
+    qDebug() << QString("Batch query to DB %1:%2: %3").arg(db.databaseName()).arg(db.connectionName()).arg(query.lastQuery());
+#endif
+
+    if (!query.execBatch())
+    {
+        throw SQLException(executeDBErrorString(db, query));
+    }
+}
+
+void Common::DBQueryExecutePrepared(QSqlDatabase& db, QSqlQuery& query)
+{
+    Q_ASSERT(db.isOpen());
+
+#ifdef QT_DEBUG
+    qDebug() << QString("Prepared query to DB %1:%2: %3").arg(db.databaseName()).arg(db.connectionName()).arg(query.lastQuery());
+#endif
+
+    if (!query.exec())
+    {
+        throw SQLException(executeDBErrorString(db, query));
+    }
+}
+
 void Common::commitDB(QSqlDatabase &db)
 {
     Q_ASSERT(db.isOpen());
@@ -134,6 +203,50 @@ void Common::commitDB(QSqlDatabase &db)
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///     class DBTransaction
+///
+DBTransaction::DBTransaction(QSqlDatabase& db)
+    : _db(db)
+{
+    Q_ASSERT(_db.isOpen());
+
+    transactionDB(_db, false);
+
+    _isActive = true;
+}
+
+DBTransaction::~DBTransaction()
+{
+    rollback();
+}
+
+void DBTransaction::commit()
+{
+    Q_ASSERT(_isActive);
+
+    //при ошибке commitDB(...) сам откатывает транзакцию
+    _isActive = false;
+
+    commitDB(_db);
+}
+
+void DBTransaction::rollback() noexcept
+{
+    if (!_isActive)
+    {
+        return;
+    }
+
+    _isActive = false;
+
+#ifdef QT_DEBUG
+    qDebug() << QString("Rollback DB %1:%2").arg(_db.databaseName()).arg(_db.connectionName());
+#endif
+
+    _db.rollback();
+}
+
 QString Common::executeDBErrorString(const QSqlDatabase& db, const QSqlQuery& query)
 {
     return QString("Cannot execute query. Databese: %1. Connection name: %2. Error: %3 Query: %4")
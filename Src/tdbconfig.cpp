@@ -18,14 +18,22 @@ TDBConfig::TDBConfig(const DBConnectionInfo &DBConnectionInfo, const QString &co
     : QObject{parent}
     , _dbConnectionInfo(DBConnectionInfo)
     , _configDBName(configDBName)
+    , _supervisor(std::make_unique<DBConnectionSupervisor>(DBConnectionInfo, configDBName))
 {
 }
 
 TDBConfig::~TDBConfig()
 {
+    _statements.reset();
+
     closeDB(_db);
 }
 
+DBConnectionSupervisor::State TDBConfig::connectionState() const noexcept
+{
+    return _supervisor->state();
+}
+
 bool TDBConfig::isError() const noexcept
 {
     return !_errorString.isEmpty();
@@ -80,31 +88,22 @@ void TDBConfig::setValue(const QString &key, const QString &value)
         return;
     }
 
+    //параметры запросов в одном порядке (значение, владелец, ключ), текст запроса не зависит от значений и подготавливается один раз
     QString queryText;
     if (_db.driverName() == "QMYSQL")
     {
         if (values_it != _values.end())
         {
             queryText = QString("UPDATE `%1` "
-                                "SET `Value` = '%2' "
-                                "WHERE `Owner` = '%3' AND `Key` = '%4' ")
-                            .arg(_configDBName)
-                            .arg(value.toUtf8().toBase64())
-                            .arg(QCoreApplication::applicationName())
-                            .arg(key);
-
-            values_it->second = value;
+                                "SET `Value` = ? "
+                                "WHERE `Owner` = ? AND `Key` = ?")
+                            .arg(_configDBName);
         }
         else
         {
-            queryText = QString("INSERT INTO `%1` (`Owner`, `Key`, `Value`) "
-                                "VALUES('%2', '%3', '%4') ")
-                            .arg(_configDBName)
-                            .arg(QCoreApplication::applicationName())
-                            .arg(key)
-                            .arg(value.toUtf8().toBase64());
-
-            _values.insert({key, value});
+            queryText = QString("INSERT INTO `%1` (`Value`, `Owner`, `Key`) "
+                                "VALUES(?, ?, ?)")
+                            .arg(_configDBName);
         }
     }
     else
@@ -112,40 +111,47 @@ void TDBConfig::setValue(const QString &key, const QString &value)
         if (values_it != _values.end())
         {
             queryText = QString("UPDATE [%1] "
-                                "SET [Value] = '%2' "
-                                "WHERE [Owner] = '%3' AND [Key] = '%4' ")
-                            .arg(_configDBName)
-                            .arg(value.toUtf8().toBase64())
-                            .arg(QCoreApplication::applicationName())
-                            .arg(key);
-
-            values_it->second = value;
+                                "SET [Value] = ? "
+                                "WHERE [Owner] = ? AND [Key] = ?")
+                            .arg(_configDBName);
         }
         else
         {
-            queryText = QString("INSERT INTO [%1] ([Key], [Value]) "
-                                "VALUES('%2', '%3', '%4') ")
-                            .arg(_configDBName)
-                            .arg(QCoreApplication::applicationName())
-                            .arg(key)
-                            .arg(value.toUtf8().toBase64());
-
-            _values.insert({key, value});
+            queryText = QString("INSERT INTO [%1] ([Value], [Owner], [Key]) "
+                                "VALUES(?, ?, ?)")
+                            .arg(_configDBName);
         }
     }
 
-    qDebug() << QString("Value of parametr %1 set %2").arg(key).arg(value);
+    if (!ensureConnected())
+    {
+        return;
+    }
 
     try
     {
-        DBQueryExecute(_db, queryText);
+        //одиночный запрос выполняется без явной транзакции - за одно обращение к серверу
+        _statements->execute(queryText, QString::fromLatin1(value.toUtf8().toBase64()), QCoreApplication::applicationName(), key);
     }
     catch (const SQLException& err)
     {
-        _errorString = err.what();
+        queryFailed(err.what());
+
+        return;
+    }
+
+    //кеш изменяется только после записи в БД: иначе повторная попытка с тем же значением была бы пропущена,
+    //а новый ключ при следующем изменении записывался бы запросом UPDATE, не изменяющим ни одной строки
+    if (values_it != _values.end())
+    {
+        values_it->second = value;
+    }
+    else
+    {
+        _values.insert({key, value});
+    }
 
-        emit errorOccurred(EXIT_CODE::SQL_EXECUTE_QUERY_ERR, _errorString);
-    } 
+    qDebug() << QString("Value of parametr %1 set %2").arg(key).arg(value);
 }
 
 bool TDBConfig::hasValue(const QString &key)
@@ -166,21 +172,8 @@ bool TDBConfig::hasValue(const QString &key)
 
 void TDBConfig::loadFromDB()
 {
-    if (_isLoaded)
-    {
-        return;
-    }
-
-    try
-    {
-        connectToDB(_db, _dbConnectionInfo, _configDBName);
-    }
-    catch (const SQLException& err)
+    if (_isLoaded || !ensureConnected())
     {
-        _errorString = err.what();
-
-        emit errorOccurred(EXIT_CODE::SQL_NOT_CONNECT, _errorString);
-
         return;
     }
 
@@ -189,17 +182,15 @@ void TDBConfig::loadFromDB()
     {
         queryText = QString("SELECT `Key`, `Value` "
                             "FROM `%1` "
-                            "WHERE `Owner` = '%2'")
-                            .arg(_configDBName)
-                            .arg(QCoreApplication::applicationName());
+                            "WHERE `Owner` = ?")
+                            .arg(_configDBName);
     }
     else
     {
         queryText = QString("SELECT [Key], [Value] "
                             "FROM [%1] "
-                            "WHERE [Owner] = '%2'")
-                            .arg(_configDBName)
-                            .arg(QCoreApplication::applicationName());
+                            "WHERE [Owner] = ?")
+                            .arg(_configDBName);
     }
 
     try
@@ -207,7 +198,7 @@ void TDBConfig::loadFromDB()
         QSqlQuery query(_db);
         query.setForwardOnly(true);
 
-        DBQueryExecute(_db, query, queryText);
+        DBQueryExecute(_db, query, queryText, QCoreApplication::applicationName());
 
         while (query.next())
         {
@@ -219,9 +210,11 @@ void TDBConfig::loadFromDB()
     }
     catch (const SQLException& err)
     {
-        _errorString = err.what();
+        _values.clear();
+
+        queryFailed(err.what());
 
-        emit errorOccurred(EXIT_CODE::SQL_EXECUTE_QUERY_ERR, _errorString);
+        return;
     }
 
     qInfo() << QString("Load config from DB was successfully");
@@ -229,4 +222,55 @@ void TDBConfig::loadFromDB()
     _isLoaded = true;
 }
 
+bool TDBConfig::ensureConnected()
+{
+    if (_db.isOpen())
+    {
+        return true;
+    }
+
+    //пока БД недоступна, вызовы завершаются сразу, не дожидаясь таймаута подключения
+    if (!_supervisor->isAvailable())
+    {
+        _errorString = QString("Config DB %1 is unavailable. Reconnecting in background").arg(_dbConnectionInfo.dbName);
+
+        emit errorOccurred(EXIT_CODE::SQL_NOT_CONNECT, _errorString);
+
+        return false;
+    }
+
+    try
+    {
+        connectToDB(_db, _dbConnectionInfo, _configDBName);
+
+        _statements = std::make_unique<DBStatementCache>(_db);
+    }
+    catch (const SQLException& err)
+    {
+        _errorString = err.what();
+
+        _supervisor->reportFailure(_errorString);
+
+        emit errorOccurred(EXIT_CODE::SQL_NOT_CONNECT, _errorString);
+
+        return false;
+    }
+
+    return true;
+}
+
+void TDBConfig::queryFailed(const QString& errorString)
+{
+    _errorString = errorString;
+
+    _db.rollback();
+
+    _statements.reset();
+    closeDB(_db);
+
+    _supervisor->reportFailure(_errorString);
+
+    emit errorOccurred(EXIT_CODE::SQL_EXECUTE_QUERY_ERR, _errorString);
+}
+
 
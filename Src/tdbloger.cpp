@@ -1,13 +1,14 @@
-//STL
-#include <functional>
-
 //Qt
-#include <QtSql/QSqlError>
-#include <QtSql/QSqlQuery>
 #include <QCoreApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QDateTime>
+#include <QDeadlineTimer>
 
 //My
 #include "Common/common.h"
+#include "Common/log.h"
 #include "Common/sql.h"
 
 #include "Common/tdbloger.h"
@@ -15,10 +16,10 @@
 using namespace Common;
 
 //static
-static TDBLoger *DBLoger_ptr = nullptr;
+static std::atomic<TDBLoger*> DBLoger_ptr = nullptr;
+static QMutex DBLogerMutex;                     ///< Мьютекс создания и удаления логеров
+static QHash<QString, TDBLoger*> namedDBLogers; ///< Именованные логеры. Доступ под DBLogerMutex
 static const qsizetype MAX_MESSAGE_LENGTH = 1024 * 1024; //1MB
-static const qint64 MAX_LOG_SAVE_INTERVAL = 60 * 60 * 24 * 30; //30 days
-static const qsizetype MAX_LOG_MESSAGE_COUNT = 10;
 
 TDBLoger* TDBLoger::DBLoger(const DBConnectionInfo& DBConnectionInfo /* = {} */,
                    const QString& logDBName /* = "Log" */,
@@ -26,19 +27,63 @@ TDBLoger* TDBLoger::DBLoger(const DBConnectionInfo& DBConnectionInfo /* = {} */,
                    const QString& sender,
                    QObject* parent /* = nullptr */)
 {
-    if (!DBLoger_ptr)
+    //после создания логер возвращается без блокировки
+    auto result = DBLoger_ptr.load(std::memory_order_acquire);
+    if (result)
+    {
+        return result;
+    }
+
+    QMutexLocker<QMutex> locker(&DBLogerMutex);
+
+    result = DBLoger_ptr.load(std::memory_order_relaxed);
+    if (!result)
     {
-        DBLoger_ptr = new TDBLoger(DBConnectionInfo, logDBName, debugMode, sender, parent);
+        result = new TDBLoger(DBConnectionInfo, logDBName, debugMode, sender, parent);
+
+        DBLoger_ptr.store(result, std::memory_order_release);
     }
 
-    return DBLoger_ptr;
+    return result;
 }
 
 void TDBLoger::deleteDBLoger()
 {
-    delete DBLoger_ptr;
+    QMutexLocker<QMutex> locker(&DBLogerMutex);
+
+    delete DBLoger_ptr.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+TDBLoger* TDBLoger::namedDBLoger(const QString& name,
+                                 const DBConnectionInfo& DBConnectionInfo /* = {} */,
+                                 const QString& logDBName /* = "Log" */,
+                                 bool debugMode /* = true */,
+                                 const QString& sender,
+                                 QObject* parent /* = nullptr */)
+{
+    QMutexLocker<QMutex> locker(&DBLogerMutex);
+
+    auto& result = namedDBLogers[name];
+    if (!result)
+    {
+        result = new TDBLoger(DBConnectionInfo, logDBName, debugMode, sender, parent);
+    }
+
+    return result;
+}
+
+TDBLoger* TDBLoger::findNamedDBLoger(const QString& name)
+{
+    QMutexLocker<QMutex> locker(&DBLogerMutex);
 
-    DBLoger_ptr = nullptr;
+    return namedDBLogers.value(name, nullptr);
+}
+
+void TDBLoger::deleteNamedDBLoger(const QString& name)
+{
+    QMutexLocker<QMutex> locker(&DBLogerMutex);
+
+    delete namedDBLogers.take(name);
 }
 
 QString TDBLoger::msgCodeToQString(TDBLoger::MSG_CODE code)
@@ -57,6 +102,28 @@ QString TDBLoger::msgCodeToQString(TDBLoger::MSG_CODE code)
     return "UNDEFINE";
 }
 
+/*!
+    Преобразует код сообщения логера в тип сообщения Qt
+    @param code - код сообщения
+    @return тип сообщения Qt
+*/
+static QtMsgType msgCodeToQtMsgType(TDBLoger::MSG_CODE code)
+{
+    switch (code)
+    {
+    case TDBLoger::MSG_CODE::DEBUG_CODE: return QtDebugMsg;
+    case TDBLoger::MSG_CODE::INFORMATION_CODE: return QtInfoMsg;
+    case TDBLoger::MSG_CODE::WARNING_CODE: return QtWarningMsg;
+    case TDBLoger::MSG_CODE::CRITICAL_CODE: return QtCriticalMsg;
+    //FATAL_CODE не должен завершать процесс, поэтому передается как критическая ошибка
+    case TDBLoger::MSG_CODE::FATAL_CODE: return QtCriticalMsg;
+    default:
+        Q_ASSERT(false);
+    };
+
+    return QtCriticalMsg;
+}
+
 //class
 TDBLoger::TDBLoger(const DBConnectionInfo& DBConnectionInfo,
                    const QString& logDBName,
@@ -75,14 +142,15 @@ TDBLoger::TDBLoger(const DBConnectionInfo& DBConnectionInfo,
 
 TDBLoger::~TDBLoger()
 {
-    if (!_isStarted)
+    Q_ASSERT_X(_handleCount.load() == 0, "TDBLoger::~TDBLoger()", "Logger deleted while DBLogHandle objects still refer to it");
+
+    if (!_isStarted.exchange(false))
     {
         return;
     }
 
-    saveToDB();
-
-    closeDB(_db);
+    _sink->stop(QDeadlineTimer(_stopTimeout));
+    _sink.reset();
 
     const auto msg = QString("Logger to DB stopped successfully");
 
@@ -91,6 +159,76 @@ TDBLoger::~TDBLoger()
     qInfo() << msg;
 }
 
+void TDBLoger::setStopTimeout(qint64 msec) noexcept
+{
+    _stopTimeout = msec;
+}
+
+void TDBLoger::setFlushParams(const DBFlushController::Params& params)
+{
+    _flushParams = params;
+}
+
+void TDBLoger::setSpoolParams(const DBLogSpool::Params& params)
+{
+    _spoolParams = params;
+}
+
+void TDBLoger::setBulkParams(const DBBulkLoader::Params& params)
+{
+    _bulkParams = params;
+}
+
+void TDBLoger::setRetentionParams(const DBLogRetention::Params& params)
+{
+    _retentionParams = params;
+}
+
+void TDBLoger::setSchemaType(DBLogSchema::Type type)
+{
+    _schemaType = type;
+}
+
+void TDBLoger::setLocalStoreParams(const DBLogLocalStore::Params& params)
+{
+    _localStoreParams = params;
+}
+
+void TDBLoger::setStatsParams(const DBLogStats::Params& params)
+{
+    _statsParams = params;
+}
+
+DBConnectionSupervisor::State TDBLoger::connectionState() const
+{
+    if (!_isStarted.load(std::memory_order_acquire))
+    {
+        return DBConnectionSupervisor::State::DEGRADED;
+    }
+
+    return _sink->connectionState();
+}
+
+DBFlushController::State TDBLoger::flushState() const
+{
+    if (!_isStarted.load(std::memory_order_acquire))
+    {
+        return DBFlushController::State();
+    }
+
+    return _sink->flushState();
+}
+
+DBLogStats::Snapshot TDBLoger::stats() const
+{
+    if (!_isStarted.load(std::memory_order_acquire))
+    {
+        return DBLogStats::Snapshot();
+    }
+
+    return _sink->stats();
+}
+
 bool TDBLoger::isError() const noexcept
 {
     return !_errorString.isEmpty();
@@ -104,150 +242,188 @@ QString TDBLoger::errorString()
     return result;
 }
 
+bool TDBLoger::isMsgEnabled(Common::TDBLoger::MSG_CODE category) const noexcept
+{
+    return category != MSG_CODE::DEBUG_CODE || _debugMode;
+}
+
 void TDBLoger::start()
 {
-    try
+    if (_isStarted)
     {
-        connectToDB(_db, _dbConnectionInfo, _logDBName);
+        return;
+    }
+
+    _sink = std::make_unique<DBLogSink>(_dbConnectionInfo, _logDBName, _sender);
+    _sink->setFlushParams(_flushParams);
+    _sink->setSpoolParams(_spoolParams);
+    _sink->setBulkParams(_bulkParams);
+    _sink->setRetentionParams(_retentionParams);
+    _sink->setSchemaType(_schemaType);
+    _sink->setLocalStoreParams(_localStoreParams);
+    _sink->setStatsParams(_statsParams);
+
+    //ошибка записи возникает в потоке записи, поэтому передается в поток логера через очередь событий
+    _sink->setErrorHandler([this](const QString& errorString)
+        {
+            QMetaObject::invokeMethod(this, [this, errorString]()
+                {
+                    _errorString = errorString;
 
-        const auto msg = QString("Logger to DB started successfully. Database: %1. Table: %2").arg(_db.databaseName()).arg(_logDBName);
+                    emit errorOccurred(EXIT_CODE::SQL_EXECUTE_QUERY_ERR, _errorString);
+                }, Qt::QueuedConnection);
+        });
 
-        writeLogFile("LOGER", msg);
+    auto connectResult = _sink->connectResult();
+    _sink->start();
 
-        qInfo() << msg;
+    //недоступность БД при старте не останавливает логер: сообщения копятся в дисковой очереди до восстановления подключения
+    const auto connectErrorString = connectResult.get();
+    if (!connectErrorString.isEmpty())
+    {
+        const auto msg = QString("Logger to DB started in degraded mode. Database: %1. Table: %2. Error: %3")
+                             .arg(_dbConnectionInfo.dbName).arg(_logDBName).arg(connectErrorString);
 
-        clearOldLog();
+        writeLogFile("LOGER", msg);
 
-        _isStarted = true;
+        qWarning() << msg;
     }
-    catch (const SQLException& err)
+    else
     {
-        _errorString = err.what();
+        const auto msg = QString("Logger to DB started successfully. Database: %1. Table: %2").arg(_dbConnectionInfo.dbName).arg(_logDBName);
+
+        writeLogFile("LOGER", msg);
 
-        emit errorOccurred(EXIT_CODE::SQL_NOT_CONNECT, _errorString);
+        qInfo() << msg;
     }
+
+    _isStarted = true;
 }
 
 void TDBLoger::sendLogMsg(Common::TDBLoger::MSG_CODE category, const QString& msg)
 {
-    Q_ASSERT(_db.isOpen());
     Q_ASSERT(_isStarted);
 
-    QString shortMsg = msg.size() >= MAX_MESSAGE_LENGTH ? msg.left(MAX_MESSAGE_LENGTH - 1) : msg;
-    shortMsg.replace(QChar(0x27), '`');
+    LogRecord record;
+    if (!makeRecord(category, msg, record))
+    {
+        return;
+    }
+
+    _sink->post(std::make_shared<LogRecord>(std::move(record)));
+}
+
+void TDBLoger::appendLogMsg(Common::TDBLoger::MSG_CODE category, const QString& msg)
+{
+    Q_ASSERT(_isStarted);
 
-    switch (category)
+    LogRecord record;
+    if (!makeRecord(category, msg, record))
     {
-    case MSG_CODE::DEBUG_CODE:
-        if (_debugMode)
-        {
-            qDebug() << msg;
-        }
-        break;
-    case MSG_CODE::INFORMATION_CODE:
-        qInfo() << msg;
-        break;
-    case MSG_CODE::WARNING_CODE:
-        qWarning() << msg;
-        break;
-    case MSG_CODE::CRITICAL_CODE:
-        qCritical() << msg;
-        break;
-    case MSG_CODE::FATAL_CODE:
-        qCritical() << msg;
-        break;
-    default:
-        Q_ASSERT(false);
+        return;
+    }
+
+    _sink->append(std::move(record));
+}
+
+bool TDBLoger::makeRecord(Common::TDBLoger::MSG_CODE category, const QString& msg, LogRecord& record)
+{
+    if (!isMsgEnabled(category))
+    {
+        return false;
+    }
+
+    //сообщение один раз передается в конвейер логирования (консоль, файл и т.д.). Порог уровней сборки (см. log.h)
+    //относится только к этому выводу: в БД отладочные сообщения сохраняются в режиме отладки и в release сборке
+    if (category != MSG_CODE::DEBUG_CODE || isLogLevelEnabled<LogLevel::DBG>())
+    {
+        writeLogMessage(msgCodeToQtMsgType(category), msg);
+    }
+
+    if (!_isStarted.load(std::memory_order_acquire))
+    {
+        return false;
     }
 
+    record.dateTime = QDateTime::currentMSecsSinceEpoch();
+    record.targets = LogSink::TARGET_DB;
+    record.level = static_cast<LogLevel>(category);
+
     if (msg.size() >= MAX_MESSAGE_LENGTH)
     {
         const auto saveMsg = QString("%1 %2").arg(msgCodeToQString(category)).arg(msg);
 
         writeLogFile("MESSAGE_TO_LONG", saveMsg);
 
+        _sink->addTruncated();
+
         qWarning() << QString("Message too long for save to DB. Message: %1").arg(msg);
-    }
 
-    QString queryText;
-    if (_db.driverName() == "QMYSQL")
-    {
-        queryText = QString("INSERT DELAYED INTO `%1` (`DateTime`, `Category`, `Sender`, `Msg`) VALUES (CAST('%2' AS DATETIME), %3, '%4', '%5')")
-                        .arg(_logDBName)
-                        .arg(QDateTime::currentDateTime().toString(DATETIME_FORMAT))
-                        .arg(QString::number(static_cast<int>(category)))
-                        .arg(_sender)
-                        .arg(shortMsg);
+        record.msg = msg.left(MAX_MESSAGE_LENGTH - 1);
     }
     else
     {
-        queryText = QString("INSERT INTO [%1] ([DateTime], [Category], [Sender], [Msg]) VALUES (CAST('%2' AS DATETIME2), %3, '%4', '%5')")
-                        .arg(_logDBName)
-                        .arg(QDateTime::currentDateTime().toString(DATETIME_FORMAT))
-                        .arg(QString::number(static_cast<int>(category)))
-                        .arg(_sender)
-                        .arg(shortMsg);
+        record.msg = msg;
     }
 
-     _queueMessages.emplace(std::move(queryText));
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class DBLogHandle
+///
+DBLogHandle::DBLogHandle()
+{
+    //не DBLoger(): вызов без параметров создал бы логер с пустой конфигурацией
+    const auto loger = DBLoger_ptr.load(std::memory_order_acquire);
+    Q_ASSERT_X(loger, "DBLogHandle::DBLogHandle()", "Logger must be created before the handle");
 
-     if (_queueMessages.size() >= MAX_LOG_MESSAGE_COUNT)
-     {
-         saveToDB();
-     }
+    attach(loger);
 }
 
-void TDBLoger::clearOldLog()
+DBLogHandle::DBLogHandle(const QString& name)
 {
-    Q_ASSERT(_db.isOpen());
+    const auto loger = TDBLoger::findNamedDBLoger(name);
+    Q_ASSERT_X(loger, "DBLogHandle::DBLogHandle(const QString&)", "Named logger must be created before the handle");
+
+    attach(loger);
+}
 
-    const auto lastLog = QDateTime::currentDateTime().addSecs(-MAX_LOG_SAVE_INTERVAL);
+DBLogHandle::DBLogHandle(const DBLogHandle& other) noexcept
+{
+    attach(other._loger);
+}
 
-    QString queryText;
-    if (_db.driverName() == "QMYSQL")
-    {
-        queryText = QString("DELETE FROM `%1` "
-                            "WHERE `DateTime` < CAST('%2' AS DATETIME)")
-                        .arg(_logDBName)
-                        .arg(lastLog.toString(DATETIME_FORMAT));
-    }
-    else
+DBLogHandle& DBLogHandle::operator=(const DBLogHandle& other) noexcept
+{
+    if (_loger != other._loger)
     {
-        queryText = QString("DELETE FROM [%1] "
-                            "WHERE [DateTime] < CAST('%2' AS DATETIME2)")
-                        .arg(_logDBName)
-                        .arg(lastLog.toString(DATETIME_FORMAT));
+        detach();
+        attach(other._loger);
     }
 
-    DBQueryExecute(_db, queryText);
+    return *this;
+}
 
-    qDebug() << QString("Cleared logs before: %1").arg(lastLog.toString(SIMPLY_DATETIME_FORMAT));
+DBLogHandle::~DBLogHandle()
+{
+    detach();
 }
 
-void TDBLoger::saveToDB()
+void DBLogHandle::attach(TDBLoger* loger) noexcept
 {
-    try
+    _loger = loger;
+    if (_loger)
     {
-        transactionDB(_db);
-        QSqlQuery query(_db);
-
-        while (!_queueMessages.empty())
-        {
-            const auto& queryText = _queueMessages.front();
-            DBQueryExecute(_db, query, queryText);
-            _queueMessages.pop();
-        }
-
-        commitDB(_db);
+        _loger->_handleCount.fetch_add(1, std::memory_order_relaxed);
     }
-    catch (const SQLException& err)
-    {
-        _errorString = err.what();
-        writeLogFile("ERROR_SAVE_TO_LOG_DB", _errorString);
-
-        qCritical() << QString("Error save to log DB. Message: %1").arg(_errorString);
+}
 
-        emit errorOccurred(EXIT_CODE::SQL_EXECUTE_QUERY_ERR,  _errorString);
+void DBLogHandle::detach() noexcept
+{
+    if (_loger)
+    {
+        _loger->_handleCount.fetch_sub(1, std::memory_order_release);
+        _loger = nullptr;
     }
 }
-
@@ -3,6 +3,7 @@
 
 //My
 #include "Common/common.h"
+#include "Common/log.h"
 
 #include "Common/thttpquery.h"
 
@@ -67,7 +68,7 @@ void THTTPQuery::send(const QByteArray& data)
 
     QNetworkReply* resp = _manager->post(request, data);
 
-    writeDebugLogFile("HTTP request:", QString(data));
+    LOG_DBG_FILE("HTTP request:", QString(data));
 
     if (!resp)
     {
@@ -88,7 +89,7 @@ void THTTPQuery::replyFinished(QNetworkReply *resp)
 
     if (resp->error() == QNetworkReply::NoError)
     {
-        writeDebugLogFile("HTTP answer:", QString(answer));
+        LOG_DBG_FILE("HTTP answer:", QString(answer));
 
         emit getAnswer(answer);
     }
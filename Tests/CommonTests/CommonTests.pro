@@ -0,0 +1,17 @@
+QT = core sql network concurrent testlib
+
+CONFIG += c++17 cmdline testcase
+
+TARGET = CommonTests
+
+include(../../Common.pri)
+
+INCLUDEPATH += \
+    ../../Tools/LogSearch
+
+HEADERS += \
+    ../../Tools/LogSearch/logsearch.h
+
+SOURCES += \
+    ../../Tools/LogSearch/logsearch.cpp \
+    tst_common.cpp
@@ -0,0 +1,417 @@
+//STL
+#include <limits>
+#include <memory>
+#include <vector>
+
+//Qt
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QDate>
+#include <QThread>
+#include <QDeadlineTimer>
+
+//My
+#include "Common/mpscqueue.h"
+#include "Common/dblogspool.h"
+#include "Common/dbflushcontroller.h"
+#include "Common/dblogstats.h"
+#include "logsearch.h"
+
+using namespace Common;
+
+///////////////////////////////////////////////////////////////////////////////
+///     The CommonTests class - тесты частей библиотеки, не требующих подключения к БД
+///
+class CommonTests final
+    : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void mpscQueueOrder();
+    void mpscQueueProducers();
+
+    void spoolReplay();
+    void spoolCorruptedTail();
+
+    void flushControllerTriggers();
+    void flushControllerReset();
+    void flushControllerBatchSize();
+
+    void histogramPercentile();
+
+    void parseLineDateTime();
+
+private:
+    /*!
+        Формирует сообщение лога для дисковой очереди
+        @param dateTime - время сообщения
+        @param msg - текст
+        @return сообщение
+    */
+    static LogRecord makeRecord(qint64 dateTime, const QString& msg);
+
+    /*!
+        Возвращает параметры дисковой очереди в папке dirName
+        @param dirName - папка очереди
+        @return параметры
+    */
+    static DBLogSpool::Params makeSpoolParams(const QString& dirName);
+
+};
+
+LogRecord CommonTests::makeRecord(qint64 dateTime, const QString& msg)
+{
+    LogRecord result;
+    result.dateTime = dateTime;
+    result.level = LogLevel::INF;
+    result.msg = msg;
+
+    return result;
+}
+
+DBLogSpool::Params CommonTests::makeSpoolParams(const QString& dirName)
+{
+    DBLogSpool::Params result;
+    result.dirName = dirName;
+    result.syncPolicy = DBLogSpool::SyncPolicy::NONE;
+
+    return result;
+}
+
+void CommonTests::mpscQueueOrder()
+{
+    MPSCQueue<qint64> queue;
+
+    qint64 value = 0;
+    QVERIFY(!queue.pop(value));
+
+    for (qint64 i = 0; i < 100; ++i)
+    {
+        queue.push(qint64(i));
+    }
+
+    for (qint64 i = 0; i < 100; ++i)
+    {
+        QVERIFY(queue.pop(value));
+        QCOMPARE(value, i);
+    }
+
+    QVERIFY(!queue.pop(value));
+}
+
+void CommonTests::mpscQueueProducers()
+{
+    static const qint64 PRODUCER_COUNT = 4;
+    static const qint64 VALUE_COUNT = 100000;
+
+    MPSCQueue<qint64> queue;
+
+    std::vector<std::unique_ptr<QThread>> producers;
+    for (qint64 producer = 0; producer < PRODUCER_COUNT; ++producer)
+    {
+        producers.emplace_back(QThread::create([&queue, producer]()
+            {
+                for (qint64 i = 0; i < VALUE_COUNT; ++i)
+                {
+                    queue.push(producer * VALUE_COUNT + i);
+                }
+            }));
+        producers.back()->start();
+    }
+
+    //значения каждого писателя должны извлекаться в порядке их добавления. Проверка выполняется после
+    //завершения писателей, чтобы не удалять работающие потоки при ошибке
+    std::vector<qint64> nextValues(PRODUCER_COUNT, 0);
+    bool isOrdered = true;
+    qint64 count = 0;
+    QDeadlineTimer deadline(30 * 1000);
+    while (isOrdered && count < PRODUCER_COUNT * VALUE_COUNT && !deadline.hasExpired())
+    {
+        qint64 value = 0;
+        if (!queue.pop(value))
+        {
+            QThread::yieldCurrentThread();
+
+            continue;
+        }
+
+        const auto producer = value / VALUE_COUNT;
+        isOrdered = producer >= 0 && producer < PRODUCER_COUNT && value % VALUE_COUNT == nextValues[producer];
+        if (isOrdered)
+        {
+            ++nextValues[producer];
+            ++count;
+        }
+    }
+
+    for (auto& producer: producers)
+    {
+        producer->wait();
+    }
+
+    QVERIFY(isOrdered);
+    QCOMPARE(count, PRODUCER_COUNT * VALUE_COUNT);
+
+    qint64 value = 0;
+    QVERIFY(!queue.pop(value));
+}
+
+void CommonTests::spoolReplay()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    {
+        DBLogSpool spool(makeSpoolParams(dir.path()));
+        QVERIFY(spool.open());
+        QVERIFY(spool.isEmpty());
+
+        for (qint64 i = 1; i <= 5; ++i)
+        {
+            QVERIFY(spool.append(makeRecord(i, QString("Message %1 ✓").arg(i))));
+        }
+        QVERIFY(spool.flush());
+        QVERIFY(!spool.isEmpty());
+
+        std::vector<LogRecord> records;
+        QVERIFY(spool.read(records, 2));
+        QCOMPARE(records.size(), size_t(2));
+        QCOMPARE(records[0].dateTime, qint64(1));
+        QCOMPARE(records[1].msg, QString("Message 2 ✓"));
+
+        spool.commitRead();
+    }
+
+    //после перезапуска чтение продолжается с подтвержденной позиции
+    DBLogSpool spool(makeSpoolParams(dir.path()));
+    QVERIFY(spool.open());
+    QVERIFY(!spool.isEmpty());
+
+    std::vector<LogRecord> records;
+    QVERIFY(spool.read(records, 100));
+    QCOMPARE(records.size(), size_t(3));
+    for (qint64 i = 0; i < 3; ++i)
+    {
+        QCOMPARE(records[i].dateTime, i + 3);
+        QVERIFY(records[i].level == LogLevel::INF);
+        QCOMPARE(records[i].msg, QString("Message %1 ✓").arg(i + 3));
+    }
+
+    spool.commitRead();
+
+    records.clear();
+    QVERIFY(!spool.read(records, 100));
+    QVERIFY(spool.isEmpty());
+}
+
+void CommonTests::spoolCorruptedTail()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    {
+        DBLogSpool spool(makeSpoolParams(dir.path()));
+        QVERIFY(spool.open());
+
+        for (qint64 i = 1; i <= 3; ++i)
+        {
+            QVERIFY(spool.append(makeRecord(i, QString("Message %1").arg(i))));
+        }
+        QVERIFY(spool.flush());
+    }
+
+    //последний байт сегмента - текст последней записи: ее CRC перестает совпадать
+    const auto segments = QDir(dir.path()).entryList({QString("*%1").arg(DB_LOG_SPOOL_SEGMENT_SUFFIX)}, QDir::Files);
+    QCOMPARE(segments.size(), qsizetype(1));
+
+    QFile segment(QDir(dir.path()).absoluteFilePath(segments.first()));
+    QVERIFY(segment.open(QFile::ReadWrite));
+    QVERIFY(segment.seek(segment.size() - 1));
+    char lastByte = 0;
+    QVERIFY(segment.getChar(&lastByte));
+    QVERIFY(segment.seek(segment.size() - 1));
+    QVERIFY(segment.putChar(static_cast<char>(lastByte ^ 0x5A)));
+    segment.close();
+
+    DBLogSpool spool(makeSpoolParams(dir.path()));
+    QVERIFY(spool.open());
+
+    std::vector<LogRecord> records;
+    QVERIFY(spool.read(records, 100));
+    QCOMPARE(records.size(), size_t(2));
+    QCOMPARE(records[1].msg, QString("Message 2"));
+
+    spool.commitRead();
+
+    //поврежденная запись пропускается
+    records.clear();
+    QVERIFY(!spool.read(records, 100));
+    QVERIFY(records.empty());
+}
+
+void CommonTests::flushControllerTriggers()
+{
+    DBFlushController::Params params;
+    params.maxLatency = 1000;
+    params.maxBytes = 1000;
+    params.minBatchSize = 10;
+    params.maxBatchSize = 100;
+
+    DBFlushController controller;
+    controller.setParams(params);
+
+    QVERIFY(!controller.isFlushNeeded(0));
+
+    //по количеству строк
+    for (qint64 i = 0; i < 9; ++i)
+    {
+        controller.add(1, 0);
+    }
+    QVERIFY(!controller.isFlushNeeded(0));
+    controller.add(1, 0);
+    QVERIFY(controller.isFlushNeeded(0));
+    controller.flushed(1, true);
+    QVERIFY(!controller.isFlushNeeded(0));
+
+    //по задержке самого старого сообщения
+    controller.add(1, 100);
+    controller.add(1, 900);
+    QVERIFY(!controller.isFlushNeeded(1099));
+    QVERIFY(controller.isFlushNeeded(1100));
+    controller.flushed(1, true);
+
+    //по объему
+    controller.add(999, 0);
+    QVERIFY(!controller.isFlushNeeded(0));
+    controller.add(1, 0);
+    QVERIFY(controller.isFlushNeeded(0));
+    controller.flushed(1, false);
+
+    const auto state = controller.state();
+    QCOMPARE(state.commitCount, qint64(2));
+    QCOMPARE(state.rowCount, qint64(12));
+    QCOMPARE(state.failCount, qint64(1));
+    QCOMPARE(state.pendingRows, qint64(0));
+}
+
+void CommonTests::flushControllerReset()
+{
+    DBFlushController controller;
+
+    controller.add(100, 0);
+    controller.add(100, 0);
+    controller.reset();
+
+    //сброшенная пачка не вызывает записи и не учитывается в статистике
+    QVERIFY(!controller.isFlushNeeded(std::numeric_limits<qint64>::max() / 2));
+
+    auto state = controller.state();
+    QCOMPARE(state.pendingRows, qint64(0));
+    QCOMPARE(state.pendingBytes, qint64(0));
+    QCOMPARE(state.commitCount, qint64(0));
+    QCOMPARE(state.rowCount, qint64(0));
+
+    //время первого сообщения следующей пачки отсчитывается заново
+    controller.add(1, 5000);
+    QVERIFY(!controller.isFlushNeeded(5000));
+    QVERIFY(controller.isFlushNeeded(5000 + controller.params().maxLatency));
+}
+
+void CommonTests::flushControllerBatchSize()
+{
+    DBFlushController::Params params;
+    params.minBatchSize = 10;
+    params.maxBatchSize = 40;
+    params.targetCommitTime = 50;
+
+    DBFlushController controller;
+    controller.setParams(params);
+
+    const auto flushBatch = [&controller](qint64 rows, qint64 commitTime)
+    {
+        for (qint64 i = 0; i < rows; ++i)
+        {
+            controller.add(1, 0);
+        }
+        controller.flushed(commitTime, true);
+    };
+
+    //неполная пачка не меняет целевой размер
+    flushBatch(5, 200);
+    QCOMPARE(controller.state().batchSize, qint64(10));
+
+    //медленная БД - размер растет до максимума
+    flushBatch(10, 200);
+    QCOMPARE(controller.state().batchSize, qint64(20));
+    flushBatch(20, 200);
+    QCOMPARE(controller.state().batchSize, qint64(40));
+    flushBatch(40, 200);
+    QCOMPARE(controller.state().batchSize, qint64(40));
+
+    //быстрая БД - размер уменьшается после того, как сглаженное время коммита опустится ниже половины целевого
+    for (qint64 i = 0; i < 20; ++i)
+    {
+        flushBatch(controller.state().batchSize, 1);
+    }
+    QCOMPARE(controller.state().batchSize, qint64(10));
+}
+
+void CommonTests::histogramPercentile()
+{
+    DBLogLatencyHistogram histogram;
+    QCOMPARE(histogram.snapshot().percentile(50), qint64(0));
+    QCOMPARE(histogram.snapshot().average(), qint64(0));
+
+    for (qint64 i = 0; i < 99; ++i)
+    {
+        histogram.add(100);
+    }
+    histogram.add(5000);
+
+    const auto snapshot = histogram.snapshot();
+    QCOMPARE(snapshot.count, qint64(100));
+    QCOMPARE(snapshot.max, qint64(5000));
+    QCOMPARE(snapshot.average(), qint64((99 * 100 + 5000) / 100));
+
+    //100 мкс попадает в корзину (64, 128]
+    QCOMPARE(snapshot.percentile(0), qint64(128));
+    QCOMPARE(snapshot.percentile(50), qint64(128));
+    QCOMPARE(snapshot.percentile(99), qint64(128));
+
+    //верхняя граница корзины 5000 мкс (8192) ограничивается максимумом
+    QCOMPARE(snapshot.percentile(99.5), qint64(5000));
+    QCOMPARE(snapshot.percentile(100), qint64(5000));
+    QCOMPARE(snapshot.percentile(150), qint64(5000));
+
+    DBLogLatencyHistogram zeroHistogram;
+    zeroHistogram.add(0);
+    zeroHistogram.add(-10);
+    QCOMPARE(zeroHistogram.snapshot().percentile(100), qint64(0));
+}
+
+void CommonTests::parseLineDateTime()
+{
+    const auto parse = [](const QByteArray& line) { return LogSearch::parseLineDateTime(line.constData(), line.size()); };
+
+    const auto days = QDate(2024, 2, 29).toJulianDay() - QDate(1970, 1, 1).toJulianDay();
+    const auto expected = days * 24 * 60 * 60 * 1000 + ((23 * 60 + 59) * 60 + 58) * 1000 + 987;
+
+    QCOMPARE(parse("2024-02-29 23:59:58.987 INF Message"), expected);
+    QCOMPARE(parse("1970-01-01 00:00:00.000"), qint64(0));
+    QCOMPARE(parse("1970-01-02 00:00:00.001 DBG"), qint64(24 * 60 * 60 * 1000 + 1));
+
+    QCOMPARE(parse(""), LogSearch::NO_DATETIME);
+    QCOMPARE(parse("2024-02-29 23:59:58"), LogSearch::NO_DATETIME);
+    QCOMPARE(parse("    continuation of a multiline message"), LogSearch::NO_DATETIME);
+    QCOMPARE(parse("2024/02/29 23:59:58.987 INF"), LogSearch::NO_DATETIME);
+    QCOMPARE(parse("2024-13-01 00:00:00.000 INF"), LogSearch::NO_DATETIME);
+    QCOMPARE(parse("2024-01-01 24:00:00.000 INF"), LogSearch::NO_DATETIME);
+    QCOMPARE(parse("2024-01-01 00:00:00.0x0 INF"), LogSearch::NO_DATETIME);
+}
+
+QTEST_GUILESS_MAIN(CommonTests)
+
+#include "tst_common.moc"
@@ -0,0 +1,10 @@
+QT = core sql network
+
+CONFIG += c++17 cmdline
+
+TARGET = LogDecoder
+
+include(../../Common.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,117 @@
+//STL
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+//Qt
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QDateTime>
+
+//My
+#include "Common/common.h"
+#include "Common/logfilereader.h"
+
+using namespace Common;
+
+/*!
+    Разбирает время из параметра командной строки в формате DATETIME_FORMAT или SIMPLY_DATETIME_FORMAT
+    @param text - текст параметра
+    @param dateTime - сюда будет помещено время (мс от начала эпохи)
+    @return true - в случае успеха
+*/
+static bool parseDateTime(const QString& text, qint64& dateTime)
+{
+    auto result = QDateTime::fromString(text, DATETIME_FORMAT);
+    if (!result.isValid())
+    {
+        result = QDateTime::fromString(text, SIMPLY_DATETIME_FORMAT);
+    }
+
+    if (!result.isValid())
+    {
+        return false;
+    }
+
+    dateTime = result.toMSecsSinceEpoch();
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCoreApplication::setApplicationName("LogDecoder");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Prints log files (text or binary, plain or compressed) in text format to stdout");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "Log files", "<file> [<file> ...]");
+
+    const QCommandLineOption fromOption("from", "Print only messages since <datetime> (\"yyyy-MM-dd hh:mm:ss[.zzz]\"). "
+                                                "Uses the .idx sidecar index to skip straight to this time", "datetime");
+    const QCommandLineOption toOption("to", "Print only messages up to <datetime> (\"yyyy-MM-dd hh:mm:ss[.zzz]\")", "datetime");
+    parser.addOption(fromOption);
+    parser.addOption(toOption);
+
+    parser.process(a);
+
+    const bool isTimeRange = parser.isSet(fromOption) || parser.isSet(toOption);
+    qint64 from = std::numeric_limits<qint64>::min() / 2;
+    qint64 to = std::numeric_limits<qint64>::max() / 2;
+    if ((parser.isSet(fromOption) && !parseDateTime(parser.value(fromOption), from))
+        || (parser.isSet(toOption) && !parseDateTime(parser.value(toOption), to)))
+    {
+        QTextStream(stderr) << "Invalid date/time. Expected format: yyyy-MM-dd hh:mm:ss[.zzz]\n";
+
+        return EXIT_FAILURE;
+    }
+
+    const auto fileNames = parser.positionalArguments();
+    if (fileNames.isEmpty())
+    {
+        parser.showHelp(EXIT_FAILURE);
+    }
+
+    int result = EXIT_SUCCESS;
+    for (const auto& fileName: fileNames)
+    {
+        LogFileReader reader(fileName);
+        if (!reader.open())
+        {
+            QTextStream(stderr) << reader.errorString() << "\n";
+            result = EXIT_FAILURE;
+
+            continue;
+        }
+
+        if (isTimeRange)
+        {
+            reader.setTimeRange(from, to);
+        }
+
+        while (!reader.atEnd())
+        {
+            auto line = reader.readLine();
+            if (reader.isError() || (line.isEmpty() && reader.atEnd()))
+            {
+                break;
+            }
+
+            line += '\n';
+            std::fwrite(line.constData(), 1, line.size(), stdout);
+        }
+
+        if (reader.isError())
+        {
+            QTextStream(stderr) << reader.errorString() << "\n";
+            result = EXIT_FAILURE;
+        }
+    }
+
+    std::fflush(stdout);
+
+    return result;
+}
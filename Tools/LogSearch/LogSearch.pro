@@ -0,0 +1,14 @@
+QT = core sql network concurrent
+
+CONFIG += c++17 cmdline
+
+TARGET = LogSearch
+
+include(../../Common.pri)
+
+HEADERS += \
+    logsearch.h
+
+SOURCES += \
+    logsearch.cpp \
+    main.cpp
@@ -0,0 +1,498 @@
+//STL
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+//Qt
+#include <QFile>
+#include <QDate>
+#include <QTime>
+#include <QDateTime>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+//My
+#include "Common/common.h"
+#include "Common/logfilereader.h"
+
+#include "logsearch.h"
+
+using namespace LogSearch;
+
+static const qint64 MIN_CHUNK_SIZE = 4 * 1024 * 1024;   ///< 4MB минимальный размер блока файла для одной задачи
+static const qint64 MAX_TIME_DISORDER = 1000;           ///< 1с максимальное отклонение порядка сообщений в файле от порядка их времени
+static const qint64 MAX_LOOKBACK = 1024 * 1024;         ///< 1MB максимальное расстояние поиска начала многострочного сообщения
+static const qsizetype DATETIME_SIZE = 23;              ///< Длина метки времени "yyyy-MM-dd hh:mm:ss.zzz"
+static const qint64 MSECS_PER_DAY = 24 * 60 * 60 * 1000;
+
+///////////////////////////////////////////////////////////////////////////////
+///     Контекст строки: время и префикс сообщения, к которому она относится
+///
+struct LineContext
+{
+    qint64 dateTime = NO_DATETIME;  ///< Время сообщения
+    QByteArrayView prefix;          ///< Префикс сообщения
+};
+
+/*!
+    Возвращает количество дней от 1970-01-01 до даты
+*/
+static qint64 daysFromCivil(qint64 year, qint64 month, qint64 day) noexcept
+{
+    year -= month <= 2 ? 1 : 0;
+    const qint64 era = (year >= 0 ? year : year - 399) / 400;
+    const qint64 yearOfEra = year - era * 400;
+    const qint64 dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const qint64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+    return era * 146097 + dayOfEra - 719468;
+}
+
+/*!
+    Разбирает число из count десятичных цифр
+    @return число или -1 если встречен не цифровой символ
+*/
+static int parseDigits(const char* data, int count) noexcept
+{
+    int result = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const auto ch = data[i];
+        if (ch < '0' || ch > '9')
+        {
+            return -1;
+        }
+
+        result = result * 10 + (ch - '0');
+    }
+
+    return result;
+}
+
+/*!
+    Преобразует время parseLineDateTime(...) в мс от начала эпохи с учетом локального часового пояса
+    @param dateTime - время
+    @return мс от начала эпохи
+*/
+static qint64 toMSecsSinceEpoch(qint64 dateTime)
+{
+    const auto days = dateTime >= 0 ? dateTime / MSECS_PER_DAY : (dateTime - MSECS_PER_DAY + 1) / MSECS_PER_DAY;
+    const auto msOfDay = static_cast<int>(dateTime - days * MSECS_PER_DAY);
+
+    return QDateTime(QDate(1970, 1, 1).addDays(days), QTime::fromMSecsSinceStartOfDay(msOfDay)).toMSecsSinceEpoch();
+}
+
+/*!
+    Возвращает префикс сообщения - слово, следующее за меткой времени
+    @param line - строка
+    @param size - длина строки
+    @return префикс
+*/
+static QByteArrayView linePrefix(const char* line, qsizetype size) noexcept
+{
+    if (size <= DATETIME_SIZE + 1)
+    {
+        return {};
+    }
+
+    const auto begin = line + DATETIME_SIZE + 1;
+    const auto end = static_cast<const char*>(std::memchr(begin, ' ', size - DATETIME_SIZE - 1));
+
+    return QByteArrayView(begin, end ? end - begin : line + size - begin);
+}
+
+/*!
+    Возвращает длину строки без символа '\r' в конце
+*/
+static qsizetype trimmedLineSize(const char* line, qsizetype size) noexcept
+{
+    return size > 0 && line[size - 1] == '\r' ? size - 1 : size;
+}
+
+/*!
+    Ищет начало строки, содержащей позицию pos
+    @param data - данные файла
+    @param lowerBound - граница поиска
+    @param pos - позиция
+    @return начало строки
+*/
+static qint64 findLineStart(const char* data, qint64 lowerBound, qint64 pos) noexcept
+{
+    while (pos > lowerBound && data[pos - 1] != '\n')
+    {
+        --pos;
+    }
+
+    return pos;
+}
+
+/*!
+    Определяет контекст строки. Если строка не содержит метку времени (продолжение многострочного сообщения) -
+        контекст берется из ближайшей предыдущей строки с меткой времени
+    @param data - данные файла
+    @param lineStart - начало строки
+    @param end - конец данных
+    @return контекст
+*/
+static LineContext lineContext(const char* data, qint64 lineStart, qint64 end) noexcept
+{
+    const auto lowerBound = std::max<qint64>(0, lineStart - MAX_LOOKBACK);
+    while (true)
+    {
+        const auto lineEndPtr = static_cast<const char*>(std::memchr(data + lineStart, '\n', end - lineStart));
+        const auto size = trimmedLineSize(data + lineStart, lineEndPtr ? lineEndPtr - (data + lineStart) : end - lineStart);
+
+        const auto dateTime = parseLineDateTime(data + lineStart, size);
+        if (dateTime != NO_DATETIME)
+        {
+            return {dateTime, linePrefix(data + lineStart, size)};
+        }
+
+        if (lineStart <= lowerBound)
+        {
+            return {};
+        }
+
+        end = lineStart - 1;
+        lineStart = findLineStart(data, lowerBound, end);
+    }
+}
+
+qint64 LogSearch::parseLineDateTime(const char* data, qsizetype size) noexcept
+{
+    if (size < DATETIME_SIZE || data[4] != '-' || data[7] != '-' || data[10] != ' ' || data[13] != ':' || data[16] != ':' || data[19] != '.')
+    {
+        return NO_DATETIME;
+    }
+
+    const auto year = parseDigits(data, 4);
+    const auto month = parseDigits(data + 5, 2);
+    const auto day = parseDigits(data + 8, 2);
+    const auto hour = parseDigits(data + 11, 2);
+    const auto minute = parseDigits(data + 14, 2);
+    const auto second = parseDigits(data + 17, 2);
+    const auto msec = parseDigits(data + 20, 3);
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23
+        || minute < 0 || minute > 59 || second < 0 || second > 60 || msec < 0)
+    {
+        return NO_DATETIME;
+    }
+
+    return daysFromCivil(year, month, day) * MSECS_PER_DAY + ((hour * 60 + minute) * 60 + second) * 1000 + msec;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///     class LogSearcher
+///
+LogSearcher::LogSearcher(const SearchParams& params)
+    : _params(params)
+    , _matcher(params.substring)
+{
+    //регулярное выражение компилируется заранее, до использования в нескольких потоках
+    if (_params.regex)
+    {
+        _params.regex->optimize();
+    }
+}
+
+std::vector<SearchMatch> LogSearcher::search(const QStringList& fileNames)
+{
+    _errorString.clear();
+
+    std::vector<std::unique_ptr<QFile>> files;
+    QList<Task> tasks;
+
+    const auto chunkCount = std::max(1, QThread::idealThreadCount() * 4);
+    for (qsizetype fileIndex = 0; fileIndex < fileNames.size(); ++fileIndex)
+    {
+        const auto& fileName = fileNames.at(fileIndex);
+
+        //сжатые и двоичные файлы читаются последовательно
+        {
+            LogFileReader reader(fileName);
+            if (!reader.open())
+            {
+                _errorString += reader.errorString() + "\n";
+
+                continue;
+            }
+
+            if (reader.isCompressed() || reader.isBinary())
+            {
+                tasks.push_back({fileIndex, fileName, nullptr, 0, 0});
+
+                continue;
+            }
+        }
+
+        auto file = std::make_unique<QFile>(fileName);
+        if (!file->open(QFile::ReadOnly))
+        {
+            _errorString += QString("Cannot open log file: %1. %2\n").arg(fileName).arg(Common::fileErrorToString(file->error()));
+
+            continue;
+        }
+
+        const auto size = file->size();
+        if (size == 0)
+        {
+            continue;
+        }
+
+        const auto data = reinterpret_cast<const char*>(file->map(0, size));
+        if (!data)
+        {
+            tasks.push_back({fileIndex, fileName, nullptr, 0, 0});
+
+            continue;
+        }
+
+        //блоки выравниваются по границам строк
+        const auto chunkSize = std::max(MIN_CHUNK_SIZE, size / chunkCount);
+        qint64 begin = 0;
+        while (begin < size)
+        {
+            qint64 end = std::min(size, begin + chunkSize);
+            if (end < size)
+            {
+                const auto lineEnd = static_cast<const char*>(std::memchr(data + end, '\n', size - end));
+                end = lineEnd ? lineEnd - data + 1 : size;
+            }
+
+            tasks.push_back({fileIndex, fileName, data, begin, end});
+
+            begin = end;
+        }
+
+        files.emplace_back(std::move(file));
+    }
+
+    const auto results = QtConcurrent::blockingMapped<QList<TaskResult>>(tasks,
+        [this](const Task& task)
+        {
+            return task.data ? searchChunk(task) : searchFile(task);
+        });
+
+    std::vector<SearchMatch> matches;
+    for (const auto& result: results)
+    {
+        if (!result.errorString.isEmpty())
+        {
+            _errorString += result.errorString + "\n";
+        }
+
+        matches.insert(matches.end(), result.matches.begin(), result.matches.end());
+    }
+
+    std::stable_sort(matches.begin(), matches.end(),
+        [](const SearchMatch& left, const SearchMatch& right)
+        {
+            if (left.dateTime != right.dateTime)
+            {
+                return left.dateTime < right.dateTime;
+            }
+
+            if (left.fileIndex != right.fileIndex)
+            {
+                return left.fileIndex < right.fileIndex;
+            }
+
+            return left.offset < right.offset;
+        });
+
+    return matches;
+}
+
+bool LogSearcher::isError() const noexcept
+{
+    return !_errorString.isEmpty();
+}
+
+QString LogSearcher::errorString()
+{
+    const QString result(_errorString);
+    _errorString.clear();
+
+    return result;
+}
+
+LogSearcher::TaskResult LogSearcher::searchChunk(const Task& task) const
+{
+    TaskResult result;
+
+    const auto data = task.data;
+    const auto isTimeRange = _params.from != NO_DATETIME || _params.to != NO_DATETIME;
+
+    //блок целиком вне интервала времени пропускается без просмотра
+    if (isTimeRange)
+    {
+        const auto first = lineContext(data, task.begin, task.end).dateTime;
+        const auto last = lineContext(data, findLineStart(data, task.begin, task.end - 1), task.end).dateTime;
+        if (first != NO_DATETIME && last != NO_DATETIME && !isTimeIntersects(first, last))
+        {
+            return result;
+        }
+    }
+
+    const auto maxDateTime = _params.to != NO_DATETIME ? _params.to + MAX_TIME_DISORDER : std::numeric_limits<qint64>::max();
+
+    //строки отбираются поиском подстроки по всему блоку, разбирается только строка с найденной подстрокой
+    if (!_params.substring.isEmpty())
+    {
+        qint64 pos = task.begin;
+        while (pos < task.end)
+        {
+            const auto found = _matcher.indexIn(data + pos, task.end - pos);
+            if (found < 0)
+            {
+                break;
+            }
+
+            const auto lineStart = findLineStart(data, task.begin, pos + found);
+            const auto lineEndPtr = static_cast<const char*>(std::memchr(data + pos + found, '\n', task.end - pos - found));
+            const auto lineEnd = lineEndPtr ? lineEndPtr - data : task.end;
+            const auto size = trimmedLineSize(data + lineStart, lineEnd - lineStart);
+
+            const auto context = lineContext(data, lineStart, task.end);
+            if (context.dateTime != NO_DATETIME && context.dateTime > maxDateTime)
+            {
+                break;
+            }
+
+            if (isMatch(data + lineStart, size, context.dateTime, context.prefix, true))
+            {
+                result.matches.push_back({context.dateTime, task.fileIndex, lineStart, QByteArray(data + lineStart, size)});
+            }
+
+            pos = lineEnd + 1;
+        }
+
+        return result;
+    }
+
+    auto context = lineContext(data, task.begin, task.end);
+    qint64 lineStart = task.begin;
+    while (lineStart < task.end)
+    {
+        const auto lineEndPtr = static_cast<const char*>(std::memchr(data + lineStart, '\n', task.end - lineStart));
+        const auto lineEnd = lineEndPtr ? lineEndPtr - data : task.end;
+        const auto size = trimmedLineSize(data + lineStart, lineEnd - lineStart);
+
+        const auto dateTime = parseLineDateTime(data + lineStart, size);
+        if (dateTime != NO_DATETIME)
+        {
+            if (dateTime > maxDateTime)
+            {
+                break;
+            }
+
+            context = {dateTime, linePrefix(data + lineStart, size)};
+        }
+
+        if (isMatch(data + lineStart, size, context.dateTime, context.prefix, false))
+        {
+            result.matches.push_back({context.dateTime, task.fileIndex, lineStart, QByteArray(data + lineStart, size)});
+        }
+
+        lineStart = lineEnd + 1;
+    }
+
+    return result;
+}
+
+LogSearcher::TaskResult LogSearcher::searchFile(const Task& task) const
+{
+    TaskResult result;
+
+    Common::LogFileReader reader(task.fileName);
+    if (!reader.open())
+    {
+        result.errorString = reader.errorString();
+
+        return result;
+    }
+
+    if (_params.from != NO_DATETIME || _params.to != NO_DATETIME)
+    {
+        reader.setTimeRange(_params.from != NO_DATETIME ? toMSecsSinceEpoch(_params.from) : std::numeric_limits<qint64>::min() / 2,
+                            _params.to != NO_DATETIME ? toMSecsSinceEpoch(_params.to) : std::numeric_limits<qint64>::max() / 2);
+    }
+
+    LineContext context;
+    QByteArray contextLine;     ///< Строка, на которую ссылается context.prefix
+    qint64 lineNumber = 0;
+    while (!reader.atEnd())
+    {
+        auto line = reader.readLine();
+        if (reader.isError() || (line.isEmpty() && reader.atEnd()))
+        {
+            break;
+        }
+
+        ++lineNumber;
+
+        const auto dateTime = parseLineDateTime(line.constData(), line.size());
+        if (dateTime != NO_DATETIME)
+        {
+            contextLine = line;
+            context = {dateTime, linePrefix(contextLine.constData(), contextLine.size())};
+        }
+
+        if (isMatch(line.constData(), line.size(), context.dateTime, context.prefix, false))
+        {
+            result.matches.push_back({context.dateTime, task.fileIndex, lineNumber, line});
+        }
+    }
+
+    if (reader.isError())
+    {
+        result.errorString = reader.errorString();
+    }
+
+    return result;
+}
+
+bool LogSearcher::isMatch(const char* line, qsizetype size, qint64 dateTime, QByteArrayView prefix, bool isSubstringChecked) const
+{
+    if (_params.from != NO_DATETIME || _params.to != NO_DATETIME)
+    {
+        if (dateTime == NO_DATETIME
+            || (_params.from != NO_DATETIME && dateTime < _params.from)
+            || (_params.to != NO_DATETIME && dateTime > _params.to))
+        {
+            return false;
+        }
+    }
+
+    if (!_params.prefixes.isEmpty() && !_params.prefixes.contains(QByteArray::fromRawData(prefix.data(), prefix.size())))
+    {
+        return false;
+    }
+
+    if (!isSubstringChecked && !_params.substring.isEmpty() && _matcher.indexIn(line, size) < 0)
+    {
+        return false;
+    }
+
+    if (_params.regex && !_params.regex->match(QString::fromUtf8(line, size)).hasMatch())
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool LogSearcher::isTimeIntersects(qint64 first, qint64 last) const noexcept
+{
+    if (_params.from != NO_DATETIME && last < _params.from - MAX_TIME_DISORDER)
+    {
+        return false;
+    }
+
+    if (_params.to != NO_DATETIME && first > _params.to + MAX_TIME_DISORDER)
+    {
+        return false;
+    }
+
+    return true;
+}
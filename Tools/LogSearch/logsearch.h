@@ -0,0 +1,162 @@
+#pragma once
+
+//STL
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+//Qt
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QByteArrayMatcher>
+#include <QRegularExpression>
+#include <QList>
+#include <QSet>
+
+namespace LogSearch
+{
+
+static const qint64 NO_DATETIME = std::numeric_limits<qint64>::min();  ///< Строка не содержит метку времени
+
+/*!
+    Разбирает метку времени в начале строки лога в формате DATETIME_FORMAT ("yyyy-MM-dd hh:mm:ss.zzz")
+    @param data - начало строки
+    @param size - длина строки
+    @return локальное время в мс от 1970-01-01 без учета часового пояса или NO_DATETIME если строка не начинается с метки времени
+*/
+qint64 parseLineDateTime(const char* data, qsizetype size) noexcept;
+
+///////////////////////////////////////////////////////////////////////////////
+///     Параметры поиска
+///
+struct SearchParams
+{
+    QByteArray substring;                       ///< Искомая подстрока. Пустая - не используется
+    std::optional<QRegularExpression> regex;    ///< Регулярное выражение. Применяется к строкам, содержащим substring
+    qint64 from = NO_DATETIME;                  ///< Начало интервала времени (см. parseLineDateTime(...)). NO_DATETIME - не ограничено
+    qint64 to = NO_DATETIME;                    ///< Конец интервала времени включительно. NO_DATETIME - не ограничено
+    QSet<QByteArray> prefixes;                  ///< Допустимые префиксы сообщений (DBG, INF, WAR, CRY, FAT и т.п.). Пустой - любые
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     Найденная строка
+///
+struct SearchMatch
+{
+    qint64 dateTime = NO_DATETIME;  ///< Время сообщения (см. parseLineDateTime(...)). Для продолжения многострочного сообщения - время самого сообщения
+    qsizetype fileIndex = 0;        ///< Номер файла в списке файлов поиска
+    qint64 offset = 0;              ///< Смещение строки в файле (для сжатых и двоичных файлов - номер строки)
+    QByteArray line;                ///< Строка без символа конца строки
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///     The LogSearcher class - параллельный поиск по файлам лога. Несжатые текстовые файлы отображаются в память
+///         и делятся на блоки по границам строк, блоки просматриваются во всех потоках пула. Строки отбираются
+///         поиском подстроки по всему блоку (без разбора каждой строки), после чего проверяются время, префикс
+///         и регулярное выражение. Блоки, целиком лежащие вне интервала времени, пропускаются. Сжатые
+///         и двоичные файлы читаются через LogFileReader, по одной задаче на файл. Результаты упорядочиваются по времени
+///
+class LogSearcher final
+{
+public:
+    /*!
+        Конструктор. Планируется использовать только этот конструтор
+        @param params - параметры поиска
+    */
+    explicit LogSearcher(const SearchParams& params);
+
+    /*!
+        Деструктор
+    */
+    ~LogSearcher() = default;
+
+    /*!
+        Выполняет поиск
+        @param fileNames - список файлов лога
+        @return найденные строки, упорядоченные по времени, номеру файла и положению в файле
+    */
+    std::vector<SearchMatch> search(const QStringList& fileNames);
+
+    /*!
+        Возвращает true если при выполнении последнего поиска произошла ошибка (при этом поиск по остальным файлам выполняется)
+        @return true - если есть ошибка
+     */
+    bool isError() const noexcept;
+
+    /*!
+        Возвращает тектовое описание ошибки и сбразывает ее
+        @return - текст ошибки
+    */
+    [[nodiscard]] QString errorString();
+
+private:
+    // Удаляем неиспользуемые конструторы
+    LogSearcher() = delete;
+    Q_DISABLE_COPY_MOVE(LogSearcher);
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Задача поиска: блок отображенного в память файла или файл целиком
+    ///
+    struct Task
+    {
+        qsizetype fileIndex = 0;        ///< Номер файла
+        QString fileName;               ///< Имя файла
+        const char* data = nullptr;     ///< Данные отображенного файла. nullptr - файл читается через LogFileReader
+        qint64 begin = 0;               ///< Начало блока
+        qint64 end = 0;                 ///< Конец блока (не включительно)
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    ///     Результат задачи поиска
+    ///
+    struct TaskResult
+    {
+        std::vector<SearchMatch> matches;   ///< Найденные строки
+        QString errorString;                ///< Текст ошибки
+    };
+
+    /*!
+        Ищет строки в блоке отображенного в память файла
+        @param task - задача
+        @return результат
+    */
+    TaskResult searchChunk(const Task& task) const;
+
+    /*!
+        Ищет строки в файле, читая его через LogFileReader
+        @param task - задача
+        @return результат
+    */
+    TaskResult searchFile(const Task& task) const;
+
+    /*!
+        Проверяет строку на соответствие параметрам поиска
+        @param line - строка
+        @param size - длина строки
+        @param dateTime - время сообщения
+        @param prefix - префикс сообщения
+        @param isSubstringChecked - true - строка уже содержит искомую подстроку
+        @return true - если строка соответствует
+    */
+    bool isMatch(const char* line, qsizetype size, qint64 dateTime, QByteArrayView prefix, bool isSubstringChecked) const;
+
+    /*!
+        Проверяет пересекается ли интервал времени [first, last] с интервалом поиска с учетом возможного нарушения порядка сообщений
+        @param first - время первого сообщения
+        @param last - время последнего сообщения
+        @return true - если интервалы пересекаются
+    */
+    bool isTimeIntersects(qint64 first, qint64 last) const noexcept;
+
+private:
+    const SearchParams _params;         ///< Параметры поиска
+    const QByteArrayMatcher _matcher;   ///< Поиск подстроки (алгоритм Бойера-Мура)
+
+    QString _errorString;               ///< Текст последней ошибки
+
+};
+
+} //namespace LogSearch
@@ -0,0 +1,150 @@
+//STL
+#include <cstdio>
+#include <cstdlib>
+
+//Qt
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QDir>
+
+//My
+#include "Common/logfilereader.h"
+#include "logsearch.h"
+
+using namespace LogSearch;
+
+/*!
+    Разбирает время из параметра командной строки в формате "yyyy-MM-dd hh:mm:ss[.zzz]"
+    @param text - текст параметра
+    @param defaultMsec - миллисекунды, если они не указаны
+    @param dateTime - сюда будет помещено время (см. parseLineDateTime(...))
+    @return true - в случае успеха
+*/
+static bool parseDateTime(const QString& text, const QString& defaultMsec, qint64& dateTime)
+{
+    const auto data = (text.size() == 19 ? text + "." + defaultMsec : text).toLatin1();
+
+    dateTime = parseLineDateTime(data.constData(), data.size());
+
+    return dateTime != NO_DATETIME;
+}
+
+/*!
+    Формирует список файлов поиска. Папки заменяются на все файлы лога в них (без файлов индекса)
+    @param paths - файлы и папки
+    @return список файлов
+*/
+static QStringList expandFileNames(const QStringList& paths)
+{
+    QStringList result;
+    for (const auto& path: paths)
+    {
+        const QFileInfo fileInfo(path);
+        if (!fileInfo.isDir())
+        {
+            result.push_back(path);
+
+            continue;
+        }
+
+        const QDir dir(path);
+        for (const auto& fileName: dir.entryList(QDir::Files, QDir::Name))
+        {
+            if (!fileName.endsWith(Common::LOG_INDEX_SUFFIX))
+            {
+                result.push_back(dir.absoluteFilePath(fileName));
+            }
+        }
+    }
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCoreApplication::setApplicationName("LogSearch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Searches log files (text or binary, plain or compressed) in parallel and prints matching lines in time order");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "Log files or directories", "<path> [<path> ...]");
+
+    const QCommandLineOption substringOption(QStringList{"s", "substring"}, "Print only lines containing <text>", "text");
+    const QCommandLineOption regexOption(QStringList{"e", "regex"}, "Print only lines matching <pattern>. Combine with --substring "
+                                                                   "to prefilter lines with a fast literal search", "pattern");
+    const QCommandLineOption fromOption("from", "Print only messages since <datetime> (\"yyyy-MM-dd hh:mm:ss[.zzz]\")", "datetime");
+    const QCommandLineOption toOption("to", "Print only messages up to <datetime> (\"yyyy-MM-dd hh:mm:ss[.zzz]\")", "datetime");
+    const QCommandLineOption prefixOption(QStringList{"p", "prefix"}, "Print only messages with one of comma separated <prefixes> "
+                                                                     "(DBG, INF, WAR, CRY, FAT, ...)", "prefixes");
+    const QCommandLineOption fileNameOption(QStringList{"H", "with-filename"}, "Print the file name for each match");
+    parser.addOptions({substringOption, regexOption, fromOption, toOption, prefixOption, fileNameOption});
+
+    parser.process(a);
+
+    const auto fileNames = expandFileNames(parser.positionalArguments());
+    if (fileNames.isEmpty())
+    {
+        parser.showHelp(EXIT_FAILURE);
+    }
+
+    SearchParams params;
+    params.substring = parser.value(substringOption).toUtf8();
+
+    if (parser.isSet(regexOption))
+    {
+        QRegularExpression regex(parser.value(regexOption));
+        if (!regex.isValid())
+        {
+            QTextStream(stderr) << "Invalid regular expression: " << regex.errorString() << "\n";
+
+            return EXIT_FAILURE;
+        }
+
+        params.regex = regex;
+    }
+
+    if ((parser.isSet(fromOption) && !parseDateTime(parser.value(fromOption), "000", params.from))
+        || (parser.isSet(toOption) && !parseDateTime(parser.value(toOption), "999", params.to)))
+    {
+        QTextStream(stderr) << "Invalid date/time. Expected format: yyyy-MM-dd hh:mm:ss[.zzz]\n";
+
+        return EXIT_FAILURE;
+    }
+
+    for (const auto& prefix: parser.value(prefixOption).split(',', Qt::SkipEmptyParts))
+    {
+        params.prefixes.insert(prefix.trimmed().toUtf8());
+    }
+
+    LogSearcher searcher(params);
+    const auto matches = searcher.search(fileNames);
+
+    const bool isPrintFileName = parser.isSet(fileNameOption);
+    for (const auto& match: matches)
+    {
+        if (isPrintFileName)
+        {
+            const auto fileName = fileNames.at(match.fileIndex).toLocal8Bit();
+            std::fwrite(fileName.constData(), 1, fileName.size(), stdout);
+            std::fputc(':', stdout);
+        }
+
+        std::fwrite(match.line.constData(), 1, match.line.size(), stdout);
+        std::fputc('\n', stdout);
+    }
+
+    std::fflush(stdout);
+
+    if (searcher.isError())
+    {
+        QTextStream(stderr) << searcher.errorString();
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}